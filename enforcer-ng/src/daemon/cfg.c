@@ -115,7 +115,11 @@ engine_config(allocator_type* allocator, const char* cfgfile,
 		ecfg->db_password = parse_conf_db_password(allocator,cfgfile);
         ecfg->use_syslog = parse_conf_use_syslog(cfgfile);
         ecfg->num_worker_threads = parse_conf_worker_threads(cfgfile);
+        ecfg->num_security_module_threads =
+            parse_conf_security_module_threads(cfgfile);
         ecfg->manual_keygen = parse_conf_manual_keygen(cfgfile);
+        ecfg->enforce_batch_size = parse_conf_enforce_batch_size(cfgfile);
+        ecfg->parallel_enforce = parse_conf_parallel_enforce(cfgfile);
         /* If any verbosity has been specified at cmd line we will use that */
         if (cmdline_verbosity > 0) {
         	ecfg->verbosity = cmdline_verbosity;
@@ -124,6 +128,11 @@ engine_config(allocator_type* allocator, const char* cfgfile,
         	ecfg->verbosity = parse_conf_verbosity(cfgfile);
         }
 		ecfg->db_port = parse_conf_db_port(cfgfile);
+		ecfg->sqlite_journal = parse_conf_sqlite_journal(allocator, cfgfile);
+		ecfg->sqlite_synchronous =
+			parse_conf_sqlite_synchronous(allocator, cfgfile);
+		ecfg->sqlite_cache_size = parse_conf_sqlite_cache_size(cfgfile);
+		ecfg->sqlite_mmap_size = parse_conf_sqlite_mmap_size(cfgfile);
 		ecfg->automatic_keygen_duration =
 			parse_conf_automatic_keygen_period(cfgfile);
 
@@ -239,9 +248,16 @@ engine_config_print(FILE* out, engineconfig_type* config)
             config->working_dir);
         fprintf(out, "\t\t<WorkerThreads>%i</WorkerThreads>\n",
             config->num_worker_threads);
+        fprintf(out, "\t\t<SecurityModuleThreads>%i</SecurityModuleThreads>\n",
+            config->num_security_module_threads);
         if (config->manual_keygen) {
             fprintf(out, "\t\t<ManualKeyGeneration/>\n");
         }
+        fprintf(out, "\t\t<EnforceBatchSize>%i</EnforceBatchSize>\n",
+            config->enforce_batch_size);
+        if (config->parallel_enforce) {
+            fprintf(out, "\t\t<ParallelEnforce/>\n");
+        }
         if (config->delegation_signer_submit_command) {
             fprintf(out, "\t\t<DelegationSignerSubmitCommand>%s</DelegationSignerSubmitCommand>\n",
                 config->delegation_signer_submit_command);
@@ -292,6 +308,8 @@ engine_config_cleanup(engineconfig_type* config)
 	allocator_deallocate(allocator, (void*) config->db_host);
 	allocator_deallocate(allocator, (void*)	config->db_username);
 	allocator_deallocate(allocator, (void*)	config->db_password);
+	allocator_deallocate(allocator, (void*) config->sqlite_journal);
+	allocator_deallocate(allocator, (void*) config->sqlite_synchronous);
     allocator_deallocate(allocator, (void*) config);
     return;
 }
@@ -71,9 +71,16 @@ struct engineconfig_struct {
 	const char* db_password; /* Datastore/MySQL/Password */
     int use_syslog;
     int num_worker_threads;
+    int num_security_module_threads;
     int manual_keygen;
+    int enforce_batch_size;
+    int parallel_enforce;
     int verbosity;
 	int db_port; /* Datastore/MySQL/Host/@Port */
+	const char* sqlite_journal; /* Datastore/SQLite/@journal */
+	const char* sqlite_synchronous; /* Datastore/SQLite/@synchronous */
+	int sqlite_cache_size; /* Datastore/SQLite/@cachesize in KiB */
+	int sqlite_mmap_size; /* Datastore/SQLite/@mmapsize in MiB */
 	time_t automatic_keygen_duration;
 };
 
@@ -38,10 +38,118 @@
 #include "orm.h"
 #include "shared/log.h"
 #include "shared/file.h"
+#include "shared/locks.h"
 #include "protobuf-orm/pb-orm.h"
 
+#include <map>
+#include <vector>
+
 static const char *module_str = "orm";
 
+// Maximum number of idle connections kept open in the pool.
+#define ODS_ORM_POOL_MAX_IDLE 16
+
+// Connections are pooled per datastore, identified by a key built from the
+// connection parameters. The generation is bumped by ods_orm_pool_clear so
+// connections checked out before it are not pooled again.
+struct OdsOrmPooled {
+	std::string key;
+	unsigned int generation;
+};
+
+static bool pool_enabled = false;
+static unsigned int pool_generation = 0;
+static std::multimap<std::string,OrmConn> pool_idle;
+static std::map<OrmConn,OdsOrmPooled> pool_busy;
+#if defined(HAVE_PTHREAD)
+static lock_basic_type pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static lock_basic_type pool_lock = 0;
+#endif
+
+// Take over a connection that is returned to the pool. Returns false when
+// the connection should be closed instead.
+static bool
+ods_orm_pool_release(OrmConn conn, bool reusable)
+{
+	bool pooled = false;
+	lock_basic_lock(&pool_lock);
+	std::map<OrmConn,OdsOrmPooled>::iterator it = pool_busy.find(conn);
+	if (it != pool_busy.end()) {
+		if (reusable && pool_enabled && it->second.generation == pool_generation
+			&& pool_idle.size() < ODS_ORM_POOL_MAX_IDLE)
+		{
+			pool_idle.insert(std::make_pair(it->second.key, conn));
+			pooled = true;
+		}
+		pool_busy.erase(it);
+	}
+	lock_basic_unlock(&pool_lock);
+	return pooled;
+}
+
+// Hand out a healthy idle connection for the datastore, if there is one.
+static bool
+ods_orm_pool_checkout(const std::string &key, OrmConn *conn)
+{
+	for (;;) {
+		OrmConn idle = NULL;
+		lock_basic_lock(&pool_lock);
+		std::multimap<std::string,OrmConn>::iterator it = pool_idle.find(key);
+		if (it != pool_idle.end()) {
+			idle = it->second;
+			pool_idle.erase(it);
+			OdsOrmPooled &pooled = pool_busy[idle];
+			pooled.key = key;
+			pooled.generation = pool_generation;
+		}
+		lock_basic_unlock(&pool_lock);
+		if (!idle)
+			return false;
+
+		if (OrmConnPing(idle)) {
+			*conn = idle;
+			return true;
+		}
+		
+		// The connection went stale while it was idle, e.g. the MySQL 
+		// server closed it, so get rid of it and try the next one.
+		ods_log_debug("[%s] closing stale pooled connection", module_str);
+		lock_basic_lock(&pool_lock);
+		pool_busy.erase(idle);
+		lock_basic_unlock(&pool_lock);
+		OrmConnClose(idle);
+	}
+}
+
+// Track a new connection so it is pooled when the caller closes it.
+static void
+ods_orm_pool_checkin(const std::string &key, OrmConn conn)
+{
+	lock_basic_lock(&pool_lock);
+	OdsOrmPooled &pooled = pool_busy[conn];
+	pooled.key = key;
+	pooled.generation = pool_generation;
+	lock_basic_unlock(&pool_lock);
+}
+
+void
+ods_orm_pool_clear()
+{
+	std::vector<OrmConn> idle;
+	lock_basic_lock(&pool_lock);
+	++pool_generation;
+	std::multimap<std::string,OrmConn>::iterator it;
+	for (it = pool_idle.begin(); it != pool_idle.end(); ++it)
+		idle.push_back(it->second);
+	pool_idle.clear();
+	lock_basic_unlock(&pool_lock);
+
+	// Not in pool_busy, so these really get closed.
+	for (size_t c=0; c<idle.size(); ++c)
+		OrmConnClose(idle[c]);
+}
+
 // The ap parameter has already been started with va_start.
 // This handler only has to pass this on to a vprintf function
 // to actually print it.
@@ -57,13 +165,19 @@ ods_orm_initialize()
 {
 	if (!OrmInitialize()) 
 		ods_log_error("[%s] ORM initialization failed",module_str);
-	else
+	else {
 		OrmSetLogErrorHandler(ods_orm_log_error);
+		OrmSetConnCloseHandler(ods_orm_pool_release);
+		pool_enabled = true;
+	}
 }
 
 void
 ods_orm_shutdown()
 {
+	pool_enabled = false;
+	ods_orm_pool_clear();
+	OrmSetConnCloseHandler(NULL);
 	OrmSetLogErrorHandler(NULL);
 	OrmShutdown();
 }
@@ -116,7 +230,15 @@ ods_orm_connect_sqlite3(int sockfd, engineconfig_type *config, OrmConn *conn)
 	dbname = dbdir.substr(slashpos);
 	dbdir.erase(slashpos);
 	
-	if (!OrmConnectSQLite3(dbdir, dbname, *conn)) {
+	OrmSQLite3Options options;
+	if (config->sqlite_journal)
+		options.journal_mode = config->sqlite_journal;
+	if (config->sqlite_synchronous)
+		options.synchronous = config->sqlite_synchronous;
+	options.cache_size_kb = config->sqlite_cache_size;
+	options.mmap_size_mb = config->sqlite_mmap_size;
+
+	if (!OrmConnectSQLite3(dbdir, dbname, options, *conn)) {
 		ods_log_error_and_printf(sockfd,
 								 module_str,
 								 "failed to open datastore \"%s\"",
@@ -131,8 +253,27 @@ ods_orm_connect_sqlite3(int sockfd, engineconfig_type *config, OrmConn *conn)
 int
 ods_orm_connect(int sockfd, engineconfig_type *config, OrmConn *conn)
 {
+	std::string key;
 	if (config->db_username)
-		return ods_orm_connect_mysql(sockfd,config,conn);
+		OrmFormat(key, "mysql:%s:%d:%s:%s:%s",
+				  config->db_host ? config->db_host : "", config->db_port,
+				  config->db_username,
+				  config->db_password ? config->db_password : "",
+				  config->datastore ? config->datastore : "");
 	else
-		return ods_orm_connect_sqlite3(sockfd,config,conn);
+		OrmFormat(key, "sqlite3:%s",
+				  config->datastore ? config->datastore : "");
+
+	if (pool_enabled && ods_orm_pool_checkout(key, conn))
+		return 1;
+
+	int ok;
+	if (config->db_username)
+		ok = ods_orm_connect_mysql(sockfd,config,conn);
+	else
+		ok = ods_orm_connect_sqlite3(sockfd,config,conn);
+
+	if (ok && pool_enabled)
+		ods_orm_pool_checkin(key, *conn);
+	return ok;
 }
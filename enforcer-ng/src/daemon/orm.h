@@ -49,8 +49,19 @@ void ods_orm_initialize();
 	
 void ods_orm_shutdown();
 
+/**
+ * Check out a connection to the datastore of config. Connections closed by
+ * the caller go back to a pool shared by all workers, and are checked for
+ * health before being handed out again.
+ */
 int ods_orm_connect(int sockfd, engineconfig_type *config, OrmConn *conn);
 
+/**
+ * Close all pooled connections, e.g. because the datastore is recreated.
+ * Connections that are checked out are closed when they are returned.
+ */
+void ods_orm_pool_clear();
+
 #ifdef __cplusplus
 }
 #endif
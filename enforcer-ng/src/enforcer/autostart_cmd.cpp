@@ -36,6 +36,7 @@
 #include "enforcer/autostart_cmd.h"
 
 #include "enforcer/enforce_task.h"
+#include "enforcer/setup_cmd.h"
 #include "policy/policy_resalt_task.h"
 
 #include "shared/duration.h"
@@ -67,6 +68,7 @@ void
 autostart(engine_type* engine)
 {
     ods_log_debug("[%s] autostart", module_str);
+    perform_upgrade_database(-1, engine->config);
     schedule_task(engine, policy_resalt_task(engine->config), "resalt");
     schedule_task(engine, enforce_task(engine), "enforce");
 }
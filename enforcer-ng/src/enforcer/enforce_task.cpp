@@ -35,6 +35,8 @@
 #include <memory>
 #include <fcntl.h>
 #include <map>
+#include <vector>
+#include <algorithm>
 
 #include "policy/kasp.pb.h"
 #include "keystate/keystate.pb.h"
@@ -88,16 +90,18 @@ private:
     int _sockfd;
     engine_type *_engine;
     bool _bShouldLaunchKeyGen;
+    lock_basic_type _lock; // the key factories of all enforce threads call us
 public:
     
     HsmKeyFactoryCallbacks(int sockfd, engine_type *engine)
     : _sockfd(sockfd),_engine(engine), _bShouldLaunchKeyGen(false)
     {
-        
+        lock_basic_init(&_lock);
     }
     
     ~HsmKeyFactoryCallbacks()
     {
+        lock_basic_destroy(&_lock);
         if (_bShouldLaunchKeyGen) {
 			// Keys were given out by the key factory during the last enforce.
 			// We need to schedule the "hsm key gen" task to create additional
@@ -111,14 +115,18 @@ public:
                               const std::string &policy, int algorithm,
                               KeyRole role)
     {
+        lock_basic_lock(&_lock);
         _bShouldLaunchKeyGen = true;
+        lock_basic_unlock(&_lock);
     }
     
     virtual void OnKeyShortage(int bits, const std::string &repository,
                                const std::string &policy, int algorithm,
                                KeyRole role)
     {
+        lock_basic_lock(&_lock);
         _bShouldLaunchKeyGen = true;
+        lock_basic_unlock(&_lock);
     }
 };
 
@@ -157,76 +165,70 @@ reschedule_enforce(task_type *task, time_t t_when, const char *z_when)
     return task->when;
 }
 
-time_t perform_enforce(int sockfd, engine_type *engine, int bForceUpdate,
-                       task_type* task)
-{
-	#define LOG_AND_RESCHEDULE(errmsg)\
-		do {\
-			ods_log_error_and_printf(sockfd,module_str,errmsg);\
-			ods_log_error("[%s] retrying in 30 minutes", module_str);\
-			return reschedule_enforce(task,t_now + 30*60, "next zone");\
-		} while (0)
+// Shared state of the threads enforcing batches of due zones.
+struct EnforceWork {
+	int sockfd;
+	engine_type *engine;
+	time_t t_now;
+	std::vector<std::string> batches; // comma separated zone ids
+	size_t next_batch;
+	const char *error;
+	lock_basic_type lock;
 
-	#define LOG_AND_RESCHEDULE_15SECS(errmsg)\
-		do {\
-			ods_log_error_and_printf(sockfd,module_str,errmsg);\
-			ods_log_error("[%s] retrying in 15 seconds", module_str);\
-			return reschedule_enforce(task,t_now + 15, "next zone");\
-		} while (0)
-	
-	#define LOG_AND_RESCHEDULE_1(errmsg,param)\
-		do {\
-			ods_log_error_and_printf(sockfd,module_str,errmsg,param);\
-			ods_log_error("[%s] retrying in 30 minutes", module_str);\
-			return reschedule_enforce(task,t_now + 30*60, "next zone");\
-		} while (0)
-	
-	GOOGLE_PROTOBUF_VERIFY_VERSION;
-	
-    time_t t_now = time_now();
+	// Shared by the key factories of all batches.
+	HsmKeyFactoryDelegatePB *callbacks;
+	HsmKeyClaims *claims;
 
-	OrmConnRef conn;
-	if (!ods_orm_connect(sockfd, engine->config, conn)) {
-		ods_log_error("[%s] retrying in 30 minutes", module_str);
-		return reschedule_enforce(task, t_now + 30*60, "next zone");
-	}
+	// Flags that indicate tasks to be scheduled after zones have been enforced.
+	bool bSignerConfNeedsWriting;
+	bool bSubmitToParent;
+	bool bRetractFromParent;
+};
 
-	std::auto_ptr< HsmKeyFactoryCallbacks > hsmKeyFactoryCallbacks(
-									new HsmKeyFactoryCallbacks(sockfd,engine));
-    // Hook the key factory up with the database
-    HsmKeyFactoryPB keyfactory(conn,hsmKeyFactoryCallbacks.get());
+// Enforce the zones of a single batch and commit them in one transaction.
+// Returns NULL on success or a message describing the failure.
+static const char *
+enforce_batch(EnforceWork &work, OrmConn conn, const std::string &ids)
+{
+	int sockfd = work.sockfd;
+	time_t t_now = work.t_now;
 
-	// Flags that indicate tasks to be scheduled after zones have been enforced.
-    bool bSignerConfNeedsWriting = false;
-    bool bSubmitToParent = false;
-    bool bRetractFromParent = false;
+	// Hook the key factory up with the database. The keys it hands out stay
+	// claimed until all batches are done, other batches may still see them
+	// as unused after this one committed.
+	HsmKeyFactoryPB keyfactory(conn,work.callbacks,work.claims);
+
+	bool bSignerConfNeedsWriting = false;
+	bool bSubmitToParent = false;
+	bool bRetractFromParent = false;
 
 	{	OrmTransactionRW transaction(conn);
 		if (!transaction.started())
-			LOG_AND_RESCHEDULE_15SECS("transaction not started");
-		
+			return "transaction not started";
+
 		{	OrmResultRef rows;
 			::ods::keystate::EnforcerZone enfzone;
-			
-			bool ok;
-			if (bForceUpdate)
-				ok = OrmMessageEnum(conn,enfzone.descriptor(),rows);
-			else {
-				const char *where = "next_change IS NULL OR next_change <= %d";
-				ok = OrmMessageEnumWhere(conn,enfzone.descriptor(),rows,where,t_now);
-			}
-			if (!ok)
-				LOG_AND_RESCHEDULE_15SECS("zone enumeration failed");
-			
-			// Go through all the zones that need handling and call enforcer
-			// update for the zone when its schedule time is earlier or
-			// identical to time_now.
-			int batchcountdown = 5; // enforce 5 zones per transaction
-			for (bool next=OrmFirst(rows); next && batchcountdown; next = OrmNext(rows)) {
 
-				OrmContextRef context;
-				if (!OrmGetMessage(rows, enfzone, /*zones + keys*/true, context))
-					LOG_AND_RESCHEDULE_15SECS("retrieving zone from database failed");
+			if (!OrmMessageEnumWhere(conn,enfzone.descriptor(),rows,
+									 "id IN (%s)",ids.c_str()))
+				return "zone enumeration failed";
+
+			// Load all zones of the batch together with their keys.
+			OrmMessageList zones;
+			bool next = OrmFirst(rows);
+			if (next && !OrmGetMessages(rows, enfzone, /*zones + keys*/true,
+										0, zones, true, next))
+				return "retrieving zone from database failed";
+
+			// we no longer need the query result, so release it.
+			rows.release();
+
+			// Call enforcer update for every zone in the batch.
+			for (size_t z=0; z<zones.size(); ++z) {
+
+				::ods::keystate::EnforcerZone &enfzone =
+					zones.message< ::ods::keystate::EnforcerZone >(z);
+				OrmContext context = zones.context(z);
 
 				::ods::kasp::Policy policy;
 				if (!load_kasp_policy(conn, enfzone.policy(), policy)) {
@@ -277,24 +279,206 @@ time_t perform_enforce(int sockfd, engine_type *engine, int bForceUpdate,
 				}
 
 				if (!OrmMessageUpdate(context))
-					LOG_AND_RESCHEDULE_15SECS("updating zone in the database failed");
-				
-				// Perform a limited number of zone updates per transaction.
-				--batchcountdown;
+					return "updating zone in the database failed";
 			}
 			
-			// we no longer need the query result, so release it.
-			rows.release();
-			
 			if (!transaction.commit())
-				LOG_AND_RESCHEDULE_15SECS("committing updated zones to the database failed");
+				return "committing updated zones to the database failed";
+		}
+	}
+
+	// Only report the flags of batches that actually made it to the database.
+	lock_basic_lock(&work.lock);
+	work.bSignerConfNeedsWriting |= bSignerConfNeedsWriting;
+	work.bSubmitToParent |= bSubmitToParent;
+	work.bRetractFromParent |= bRetractFromParent;
+	lock_basic_unlock(&work.lock);
+	return NULL;
+}
+
+// Take batches from the shared work until they run out or one of them fails.
+static void
+enforce_batches(EnforceWork &work, OrmConn conn)
+{
+	for (;;) {
+		lock_basic_lock(&work.lock);
+		bool done = work.error || work.next_batch >= work.batches.size();
+		size_t b = work.next_batch++;
+		lock_basic_unlock(&work.lock);
+		if (done)
+			break;
+
+		const char *error = enforce_batch(work, conn, work.batches[b]);
+		if (error) {
+			lock_basic_lock(&work.lock);
+			if (!work.error)
+				work.error = error;
+			lock_basic_unlock(&work.lock);
+			break;
+		}
+	}
+}
+
+#if defined(HAVE_PTHREAD)
+static void *
+enforce_batches_thread(void *arg)
+{
+	EnforceWork &work = *(EnforceWork *)arg;
+
+	OrmConnRef conn;
+	if (!ods_orm_connect(work.sockfd, work.engine->config, conn)) {
+		lock_basic_lock(&work.lock);
+		if (!work.error)
+			work.error = "connecting to the database failed";
+		lock_basic_unlock(&work.lock);
+		return NULL;
+	}
+	enforce_batches(work, conn);
+	return NULL;
+}
+#endif
+
+time_t perform_enforce(int sockfd, engine_type *engine, int bForceUpdate,
+                       task_type* task)
+{
+	#define LOG_AND_RESCHEDULE(errmsg)\
+		do {\
+			ods_log_error_and_printf(sockfd,module_str,errmsg);\
+			ods_log_error("[%s] retrying in 30 minutes", module_str);\
+			return reschedule_enforce(task,t_now + 30*60, "next zone");\
+		} while (0)
+
+	#define LOG_AND_RESCHEDULE_15SECS(errmsg)\
+		do {\
+			ods_log_error_and_printf(sockfd,module_str,errmsg);\
+			ods_log_error("[%s] retrying in 15 seconds", module_str);\
+			return reschedule_enforce(task,t_now + 15, "next zone");\
+		} while (0)
+	
+	#define LOG_AND_RESCHEDULE_1(errmsg,param)\
+		do {\
+			ods_log_error_and_printf(sockfd,module_str,errmsg,param);\
+			ods_log_error("[%s] retrying in 30 minutes", module_str);\
+			return reschedule_enforce(task,t_now + 30*60, "next zone");\
+		} while (0)
+	
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+	
+    time_t t_now = time_now();
+
+	OrmConnRef conn;
+	if (!ods_orm_connect(sockfd, engine->config, conn)) {
+		ods_log_error("[%s] retrying in 30 minutes", module_str);
+		return reschedule_enforce(task, t_now + 30*60, "next zone");
+	}
+
+	// Launches key pre-generation on destruction when we ran out of keys 
+	// during the enforcement.
+	HsmKeyFactoryCallbacks callbacks(sockfd,engine);
+
+	// Releases the keys handed out on destruction, after all threads joined.
+	HsmKeyClaims claims;
+
+	EnforceWork work;
+	work.sockfd = sockfd;
+	work.engine = engine;
+	work.t_now = t_now;
+	work.next_batch = 0;
+	work.error = NULL;
+	work.callbacks = &callbacks;
+	work.claims = &claims;
+	work.bSignerConfNeedsWriting = false;
+	work.bSubmitToParent = false;
+	work.bRetractFromParent = false;
+
+	// Collect the ids of all zones that need handling and split them in 
+	// batches, every batch is enforced and committed in its own transaction.
+	{	OrmTransaction transaction(conn);
+		if (!transaction.started())
+			LOG_AND_RESCHEDULE_15SECS("transaction not started");
+
+		OrmResultRef rows;
+		::ods::keystate::EnforcerZone enfzone;
+
+		bool ok;
+		if (bForceUpdate)
+			ok = OrmMessageEnum(conn,enfzone.descriptor(),rows);
+		else {
+			const char *where = "next_change IS NULL OR next_change <= %d";
+			ok = OrmMessageEnumWhere(conn,enfzone.descriptor(),rows,where,t_now);
+		}
+		if (!ok)
+			LOG_AND_RESCHEDULE_15SECS("zone enumeration failed");
+
+		int batch_size = engine->config->enforce_batch_size;
+		int count = batch_size;
+		for (bool next=OrmFirst(rows); next; next=OrmNext(rows)) {
+			pb::uint64 id;
+			if (!OrmGetId(rows, id))
+				LOG_AND_RESCHEDULE_15SECS("retrieving zone from database failed");
+			if (count == batch_size) {
+				work.batches.push_back(std::string());
+				count = 0;
+			}
+			std::string zoneid;
+			OrmFormat(zoneid, "%llu", (unsigned long long)id);
+			OrmChain(work.batches.back(), zoneid, ',');
+			++count;
 		}
 	}
 
-    // Delete the call backs and launch key pre-generation when we ran out 
-    // of keys during the enforcement
-    hsmKeyFactoryCallbacks.reset();
+	int nthreads = 1;
+#if defined(HAVE_PTHREAD)
+	if (engine->config->parallel_enforce)
+		nthreads = std::min((size_t)std::max(engine->config->num_worker_threads,1),
+							work.batches.size());
+#endif
+
+	lock_basic_init(&work.lock);
+	if (nthreads > 1) {
+#if defined(HAVE_PTHREAD)
+		// Every thread uses its own database connection. Note that SQLite
+		// serializes writers, so this mainly pays off with MySQL.
+		std::vector<ods_thread_type> threads(nthreads);
+		for (int t=0; t<nthreads; ++t)
+			ods_thread_create(&threads[t], enforce_batches_thread, &work);
+		for (int t=0; t<nthreads; ++t)
+			ods_thread_join(threads[t]);
+#endif
+	} else
+		enforce_batches(work, conn);
+	lock_basic_destroy(&work.lock);
 
+    // Launch signer configuration writer task when one of the 
+    // zones indicated that it needs to be written.
+    if (work.bSignerConfNeedsWriting) {
+        task_type *signconf =
+            signconf_task(engine->config, "signconf", "signer configurations");
+        schedule_task(sockfd,engine,signconf,"signconf");
+    }
+
+    // Launch ds-submit task when one of the updated key states has the
+    // DS_SUBMIT flag set.
+    if (work.bSubmitToParent) {
+        task_type *submit =
+            keystate_ds_submit_task(engine->config,
+                                    "ds-submit","KSK keys with submit flag set");
+        schedule_task(sockfd,engine,submit,"ds-submit");
+    }
+
+    // Launch ds-retract task when one of the updated key states has the
+    // DS_RETRACT flag set.
+    if (work.bRetractFromParent) {
+        task_type *retract =
+            keystate_ds_retract_task(engine->config,
+                                "ds-retract","KSK keys with retract flag set");
+        schedule_task(sockfd,engine,retract,"ds-retract");
+    }
+
+	// The batches that were committed before the failure are scheduled 
+	// above, the remaining zones are still due when we retry.
+	if (work.error)
+		LOG_AND_RESCHEDULE_15SECS(work.error);
 
 	// when to reschedule next zone for enforcement
     time_t t_when = t_now + 1 * 365 * 24 * 60 * 60; // now + 1 year
@@ -335,32 +519,6 @@ time_t perform_enforce(int sockfd, engine_type *engine, int bForceUpdate,
 		}
 	}
 
-    // Launch signer configuration writer task when one of the 
-    // zones indicated that it needs to be written.
-    if (bSignerConfNeedsWriting) {
-        task_type *signconf =
-            signconf_task(engine->config, "signconf", "signer configurations");
-        schedule_task(sockfd,engine,signconf,"signconf");
-    }
-
-    // Launch ds-submit task when one of the updated key states has the
-    // DS_SUBMIT flag set.
-    if (bSubmitToParent) {
-        task_type *submit =
-            keystate_ds_submit_task(engine->config,
-                                    "ds-submit","KSK keys with submit flag set");
-        schedule_task(sockfd,engine,submit,"ds-submit");
-    }
-
-    // Launch ds-retract task when one of the updated key states has the
-    // DS_RETRACT flag set.
-    if (bRetractFromParent) {
-        task_type *retract =
-            keystate_ds_retract_task(engine->config,
-                                "ds-retract","KSK keys with retract flag set");
-        schedule_task(sockfd,engine,retract,"ds-retract");
-    }
-
     return reschedule_enforce(task,t_when,z_when.c_str());
 }
 
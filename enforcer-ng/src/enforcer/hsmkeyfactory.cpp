@@ -33,9 +33,62 @@
 
 #include "shared/duration.h"
 #include "shared/log.h"
+#include "shared/locks.h"
 
 static const char * const module_str = "hsmkeyfactory";
 
+// Locators of keys handed out by a factory whose transaction has not ended
+// yet, or whose enforce run has not ended yet. Zones enforced in parallel on
+// other connections may not see the inception of such a key, not even after
+// it was committed, so they have to skip it explicitly.
+static std::set<std::string> claimed_keys;
+#if defined(HAVE_PTHREAD)
+static lock_basic_type claimed_keys_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static lock_basic_type claimed_keys_lock = 0;
+#endif
+
+static bool
+claim_key(const std::string &locator)
+{
+	lock_basic_lock(&claimed_keys_lock);
+	bool claimed = claimed_keys.insert(locator).second;
+	lock_basic_unlock(&claimed_keys_lock);
+	return claimed;
+}
+
+static void
+release_keys(const std::set<std::string> &locators)
+{
+	lock_basic_lock(&claimed_keys_lock);
+	std::set<std::string>::const_iterator it;
+	for (it = locators.begin(); it != locators.end(); ++it)
+		claimed_keys.erase(*it);
+	lock_basic_unlock(&claimed_keys_lock);
+}
+
+//////////////////////////////
+// HsmKeyClaims
+//////////////////////////////
+
+HsmKeyClaims::HsmKeyClaims()
+{
+	lock_basic_init(&_lock);
+}
+
+HsmKeyClaims::~HsmKeyClaims()
+{
+	release_keys(_locators);
+	lock_basic_destroy(&_lock);
+}
+
+void HsmKeyClaims::add(const std::set<std::string> &locators)
+{
+	lock_basic_lock(&_lock);
+	_locators.insert(locators.begin(), locators.end());
+	lock_basic_unlock(&_lock);
+}
+
 //////////////////////////////
 // HsmKeyPB
 //////////////////////////////
@@ -206,9 +259,87 @@ const std::string &HsmKeyPB::repository()
 //////////////////////////////
 
 HsmKeyFactoryPB::HsmKeyFactoryPB(OrmConn conn,
-                                 HsmKeyFactoryDelegatePB *delegate)
-: _conn(conn), _delegate(delegate)
+                                 HsmKeyFactoryDelegatePB *delegate,
+                                 HsmKeyClaims *claims)
+: _conn(conn), _delegate(delegate), _claims(claims)
+{
+}
+
+HsmKeyFactoryPB::~HsmKeyFactoryPB()
 {
+	if (_claims)
+		_claims->add(_claimed);
+	else
+		release_keys(_claimed);
+}
+
+// Number of unused key ids read at once into a free key list.
+#define FREE_KEYS_CHUNK 64
+
+// Append "column=value" to the where clause.
+static void
+pool_condition(std::string &where, const char *column,
+			   const std::string &value)
+{
+	if (!where.empty())
+		where += " AND ";
+	where += std::string(column) + "=" + value;
+}
+
+// Build the where clause selecting keys with the given parameters. Keys are
+// stored with all of these columns filled in (see perform_upgrade_database),
+// so plain equality lets HsmKey_pool_index serve the query.
+static bool
+pool_where(OrmConn conn, int bits, const std::string &repository,
+		   const std::string &policy, int algorithm, KeyRole role,
+		   std::string &where)
+{
+	std::string value;
+
+	if (!OrmQuoteStringValue(conn, policy, value))
+		return false;
+	pool_condition(where, "policy", value);
+
+	OrmFormat(value, "%d", algorithm);
+	pool_condition(where, "algorithm", value);
+
+	OrmFormat(value, "%d", bits);
+	pool_condition(where, "bits", value);
+
+	::ods::hsmkey::keyrole pbrole = (::ods::hsmkey::keyrole)role;
+	if (!OrmQuoteStringValue(conn, ::ods::hsmkey::keyrole_Name(pbrole), value))
+		return false;
+	pool_condition(where, "role", value);
+
+	if (!OrmQuoteStringValue(conn, repository, value))
+		return false;
+	pool_condition(where, "repository", value);
+	return true;
+}
+
+// Read the ids of the next chunk of unused keys of the pool.
+bool HsmKeyFactoryPB::FillFreeKeyList(FreeKeyList &pool,
+									  const std::string &where)
+{
+	OrmResultRef rows;
+	if (!OrmMessageEnumWhere(_conn, ::ods::hsmkey::HsmKey::descriptor(), rows,
+							 "inception IS NULL AND %s AND id > %llu "
+							 "ORDER BY id LIMIT %d",
+							 where.c_str(),
+							 (unsigned long long)pool.last_id,
+							 FREE_KEYS_CHUNK))
+		return false;
+
+	for (bool next=OrmFirst(rows); next; next=OrmNext(rows)) {
+		pb::uint64 id;
+		if (!OrmGetId(rows, id))
+			return false;
+		pool.ids.push_back(id);
+		pool.last_id = id;
+	}
+	if (pool.ids.size() < FREE_KEYS_CHUNK)
+		pool.exhausted = true;
+	return true;
 }
 
 /* Create a new key with the specified number of bits (or retrieve it 
@@ -218,75 +349,63 @@ bool HsmKeyFactoryPB::CreateNewKey(int bits, const std::string &repository,
                                    KeyRole role,
                                    HsmKey **ppKey)
 {
-#if 0
-	// perform retrieval and update of a hsm key inside a single transaction.
-	OrmTransactionRW transaction(_conn);
-	if (!transaction.started())
+	std::string where;
+	if (!pool_where(_conn, bits, repository, policy, algorithm, role, where))
 		return false;
-#endif
-	
-    // Find keys that are available and match exactly with the given parameters.
-	{	OrmResultRef rows;
-		if (!OrmMessageEnumWhere(_conn, ::ods::hsmkey::HsmKey::descriptor(),
-								 rows, "inception IS NULL"))
-			return false;
+	FreeKeyList &pool = _freekeys[where];
+
+	for (;;) {
+		if (pool.ids.empty()) {
+			if (pool.exhausted)
+				break;
+			if (!FillFreeKeyList(pool, where))
+				return false;
+			if (pool.ids.empty())
+				break;
+		}
+		pb::uint64 id = pool.ids.front();
+		pool.ids.pop_front();
 
 		::ods::hsmkey::HsmKey *pbkey = new ::ods::hsmkey::HsmKey;
-		
-		for (bool next=OrmFirst(rows); next; next=OrmNext(rows)) {
-			OrmContextRef context;
-			if (OrmGetMessage(rows, *pbkey, true, context)) {
-				if (!pbkey->has_inception() 
-					&& pbkey->bits() == bits
-					&& pbkey->repository() == repository
-					&& pbkey->policy() == policy
-					&& pbkey->algorithm() == algorithm
-					&& pbkey->role() == (::ods::hsmkey::keyrole)role
-					)
-				{
-					// found a candidate, so we no longer need the rows
-					rows.release();
-
-					pbkey->set_inception(time_now());
-					HsmKeyPB pbkey_ref(pbkey);
-					
-					// Fixate unset attributes that returned their default value.
-					// Otherwise when we list the keys those values will show 
-					// up as 'not set'
-					if (!pbkey->has_policy())
-						pbkey_ref.setPolicy(policy);
-					if (!pbkey->has_algorithm())
-						pbkey_ref.setAlgorithm(algorithm);
-					if (!pbkey->has_role())
-						pbkey_ref.setKeyRole(role);
-					
-					pbkey = NULL;
+		OrmContextRef context;
+		if (!OrmMessageRead(_conn, *pbkey, id, true, context)) {
+			delete pbkey;
+			return false;
+		}
 
-					// We have modified the key and need to update it.
-					if (!OrmMessageUpdate(context)) 
-						return false;
-#if 0
-					if (!transaction.commit())
-						return false;
-#endif
-					std::pair<std::map<std::string,HsmKeyPB>::iterator,bool> ret;
-					ret = _keys.insert(std::pair<std::string,HsmKeyPB>(
-										pbkey_ref.locator(),pbkey_ref));
-					*ppKey = &ret.first->second;
-					return true;
-				}
-			}
+		// The key may have been handed out on another connection since we
+		// read its id.
+		if (pbkey->has_inception() || !claim_key(pbkey->locator())) {
+			delete pbkey;
+			continue;
 		}
+		_claimed.insert(pbkey->locator());
 
-		delete pbkey;
-    }
+		pbkey->set_inception(time_now());
+		HsmKeyPB pbkey_ref(pbkey);
+		
+		// Fixate unset attributes that returned their default value.
+		// Otherwise when we list the keys those values will show 
+		// up as 'not set'
+		if (!pbkey->has_policy())
+			pbkey_ref.setPolicy(policy);
+		if (!pbkey->has_algorithm())
+			pbkey_ref.setAlgorithm(algorithm);
+		if (!pbkey->has_role())
+			pbkey_ref.setKeyRole(role);
+		
+		pbkey = NULL;
 
-#if 0
-	// explicit rollback not strictly needed as it's the default action.
-	// but we want to be sure to leave the transaction before we start calling 
-	// callbacks on our delegate.
-	transaction.rollback(); 
-#endif
+		// We have modified the key and need to update it.
+		if (!OrmMessageUpdate(context)) 
+			return false;
+
+		std::pair<std::map<std::string,HsmKeyPB>::iterator,bool> ret;
+		ret = _keys.insert(std::pair<std::string,HsmKeyPB>(
+							pbkey_ref.locator(),pbkey_ref));
+		*ppKey = &ret.first->second;
+		return true;
+	}
 	
     // We were not able to find any suitable key, give up.
     if (_delegate)
@@ -38,7 +38,10 @@
  */
 
 #include <map>
+#include <set>
+#include <deque>
 #include "shared/log.h"
+#include "shared/locks.h"
 #include "enforcer/enforcerdata.h"
 #include "hsmkey/hsmkey.pb.h"
 #include "protobuf-orm/pb-orm.h"
@@ -108,15 +111,59 @@ public:
                                KeyRole role) = 0;
 };
 
+/**
+ * Keys claimed by the key factories of one enforce run. Factories that
+ * commit in parallel hand their claims over on destruction, they are only
+ * released when this object goes away. Until then no other factory hands
+ * out those keys, whatever its transaction still sees.
+ */
+class HsmKeyClaims {
+private:
+    std::set<std::string> _locators;
+    lock_basic_type _lock;
+
+public:
+    HsmKeyClaims();
+    ~HsmKeyClaims();
+
+    void add(const std::set<std::string> &locators);
+
+private:
+    HsmKeyClaims(const HsmKeyClaims &);
+    void operator=(const HsmKeyClaims &);
+};
+
 class HsmKeyFactoryPB : public HsmKeyFactory {
 private:
+    // Ids of unused keys with the same parameters, read from the database
+    // in chunks ordered by id and handed out front to back.
+    struct FreeKeyList {
+        FreeKeyList() : last_id(0), exhausted(false) {}
+        std::deque<pb::uint64> ids;
+        pb::uint64 last_id;
+        bool exhausted;
+    };
+
     OrmConn _conn;
     std::map<std::string,HsmKeyPB> _keys;
+    std::set<std::string> _claimed;
+    std::map<std::string,FreeKeyList> _freekeys; // by pool where clause
     HsmKeyFactoryDelegatePB *_delegate;
+    HsmKeyClaims *_claims;
+
+    bool FillFreeKeyList(FreeKeyList &pool, const std::string &where);
     
 public:
     HsmKeyFactoryPB(OrmConn conn,
-                    HsmKeyFactoryDelegatePB *delegate);
+                    HsmKeyFactoryDelegatePB *delegate,
+                    HsmKeyClaims *claims = NULL);
+
+    /**
+     * Releases the keys claimed by this factory, or hands them over to
+     * the claims passed on construction. Keep the factory alive until the
+     * transaction that stores the claimed keys has ended.
+     */
+    virtual ~HsmKeyFactoryPB();
     
     virtual bool CreateNewKey(int bits, const std::string &repository,
                               const std::string &policy, int algorithm,
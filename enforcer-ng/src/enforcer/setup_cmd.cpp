@@ -93,7 +93,110 @@ create_database_tables(int sockfd, OrmConn conn)
 }
 
 static bool
-drop_database_tables(int sockfd, OrmConn conn, engineconfig_type* config)
+create_database_indexes(int sockfd, OrmConn conn)
+{
+	bool ok = true;
+	if (!OrmCreateIndexes(conn, ods::hsmkey::HsmKey::descriptor() )) {
+		ods_log_error_and_printf(sockfd, module_str,
+								 "creating HsmKey indexes failed");
+		ok = false;
+	}
+	
+	if (!OrmCreateIndexes(conn, ods::kasp::Policy::descriptor())) {
+		ods_log_error_and_printf(sockfd,module_str,
+								 "creating Policy indexes failed");
+		ok = false;
+	}
+
+	if (!OrmCreateIndexes(conn, ods::keystate::EnforcerZone::descriptor())) {
+		ods_log_error_and_printf(sockfd,module_str,
+								 "creating EnforcerZone indexes failed");
+		ok = false;
+	}
+	return ok;
+}
+
+// Set a column that is NULL to the given value for every HsmKey.
+static bool
+fill_hsmkey_column(int sockfd, OrmConn conn, const char *column,
+				   const std::string &value)
+{
+	std::string statement;
+	OrmFormat(statement, "UPDATE %s SET %s=%s WHERE %s IS NULL",
+			  ods::hsmkey::HsmKey::descriptor()->name().c_str(),
+			  column, value.c_str(), column);
+	OrmResultRef result;
+	if (!OrmConnQuery(conn, statement, result)) {
+		ods_log_error_and_printf(sockfd, module_str,
+								 "filling in HsmKey column %s failed",
+								 column);
+		return false;
+	}
+	return true;
+}
+
+// Keys stored by older versions may have NULL in the columns the key
+// factory looks up unused keys on. Give them the value of the field
+// default, so the lookup can use plain equality and the pool index.
+static bool
+fill_hsmkey_pool_columns(int sockfd, OrmConn conn)
+{
+	if (!OrmTableExists(conn, ods::hsmkey::HsmKey::descriptor()))
+		return true;
+
+	const ods::hsmkey::HsmKey &defaults =
+		ods::hsmkey::HsmKey::default_instance();
+	std::string policy, algorithm, bits, role, repository;
+	if (!OrmQuoteStringValue(conn, defaults.policy(), policy)
+		|| !OrmQuoteStringValue(conn,
+								ods::hsmkey::keyrole_Name(defaults.role()),
+								role)
+		|| !OrmQuoteStringValue(conn, defaults.repository(), repository))
+		return false;
+	OrmFormat(algorithm, "%u", defaults.algorithm());
+	OrmFormat(bits, "%u", defaults.bits());
+
+	OrmTransactionRW transaction(conn);
+	if (!transaction.started()) {
+		ods_log_error_and_printf(sockfd, module_str,
+								 "transaction not started");
+		return false;
+	}
+	if (!fill_hsmkey_column(sockfd, conn, "policy", policy)
+		|| !fill_hsmkey_column(sockfd, conn, "algorithm", algorithm)
+		|| !fill_hsmkey_column(sockfd, conn, "bits", bits)
+		|| !fill_hsmkey_column(sockfd, conn, "role", role)
+		|| !fill_hsmkey_column(sockfd, conn, "repository", repository))
+		return false;
+	if (!transaction.commit()) {
+		ods_log_error_and_printf(sockfd, module_str,
+								 "committing HsmKey columns failed");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Add indexes that are missing from a datastore created by an older
+ * version and fill in the HsmKey pool columns it left NULL. Tables that do
+ * not exist yet are left to the 'setup' command.
+ *
+ */
+void
+perform_upgrade_database(int sockfd, engineconfig_type *config)
+{
+	OrmConnRef conn;
+	if (!ods_orm_connect(sockfd, config, conn))
+		return; // errors have already been reported.
+
+	if (create_database_indexes(sockfd, conn))
+		ods_log_debug("[%s] datastore indexes up to date", module_str);
+	if (fill_hsmkey_pool_columns(sockfd, conn))
+		ods_log_debug("[%s] HsmKey pool columns filled in", module_str);
+}
+
+static bool
+drop_database_tables(int sockfd, OrmConn conn)
 {
 	bool ok = true;
 	if  (!OrmDropTable(conn,  ods::hsmkey::HsmKey::descriptor())) {
@@ -111,15 +214,26 @@ drop_database_tables(int sockfd, OrmConn conn, engineconfig_type* config)
 								 "dropping EnforcerZone tables failed");
 		ok = false;
 	}
-	
-	if (!config->db_host && config->datastore) {
-		// SQLite because 'db_host' is not assigned a value, but 'datastore' is.
+	return ok;
+}
+
+// Remove the SQLite database file together with its write-ahead log and
+// shared memory index. No connection to it may be open anymore.
+static bool
+remove_datastore_files(int sockfd, engineconfig_type* config)
+{
+	static const char * const suffixes[] = { "", "-wal", "-shm" };
+	bool ok = true;
 
-		// Try to remove the SQLite database file too.
-		if (unlink(config->datastore)==-1 && errno!=ENOENT) {
+	if (config->db_host || !config->datastore)
+		return ok; // MySQL because 'db_host' is assigned a value.
+
+	for (size_t s=0; s<sizeof(suffixes)/sizeof(suffixes[0]); ++s) {
+		std::string path = std::string(config->datastore) + suffixes[s];
+		if (unlink(path.c_str())==-1 && errno!=ENOENT) {
 			ods_log_error_and_printf(sockfd, module_str,
 									 "unlink of \"%s\" failed: %s (%d)",
-									 config->datastore,strerror(errno),errno);
+									 path.c_str(),strerror(errno),errno);
 			ok = false;
 		}
 	}
@@ -167,7 +281,14 @@ int handled_setup_cmd(int sockfd, engine_type* engine, const char *cmd,
 		if (!ods_orm_connect(sockfd, engine->config, conn))
 			return 1; // errors have already been reported.
 		
-		if (!drop_database_tables(sockfd,conn,engine->config))
+		bool ok = drop_database_tables(sockfd,conn);
+
+		// Pooled connections still refer to the dropped datastore. Clearing
+		// the pool first makes sure this connection is really closed too.
+		ods_orm_pool_clear();
+		conn.release();
+
+		if (!remove_datastore_files(sockfd,engine->config) || !ok)
 			return 1; // errors have already been reported.
 	}
 
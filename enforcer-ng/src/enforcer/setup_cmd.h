@@ -43,6 +43,8 @@ void help_setup_cmd(int sockfd);
 int handled_setup_cmd(int sockfd, engine_type* engine, const char *cmd,
 					  ssize_t n);
 
+void perform_upgrade_database(int sockfd, engineconfig_type *config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #include "hsmkey/hsmkey_gen_task.h"
 #include "shared/file.h"
 #include "shared/duration.h"
+#include "shared/locks.h"
 #include "libhsm.h"
 
 #include <google/protobuf/descriptor.h>
@@ -47,6 +48,8 @@
 #include <string.h>
 #include <memory>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
 #include "protobuf-orm/pb-orm.h"
 #include "daemon/orm.h"
@@ -55,23 +58,12 @@ static const char *module_str = "hsmkey_gen_task";
 
 static bool
 generate_keypair(int sockfd,
+				 hsm_ctx_t *ctx,
 				 const char *repository,
 				 unsigned int keysize,
 				 std::string &locator)
 {
     hsm_key_t *key = NULL;
-    hsm_ctx_t *ctx = hsm_create_context();
-    if (!ctx) {
-		ods_log_error_and_printf(sockfd,module_str,"could not connect to HSM");
-        return false;
-    }
-    
-    /* Check for repository before starting using it */
-    if (hsm_token_attached(ctx, repository) == 0) {
-        hsm_print_error(ctx);
-        hsm_destroy_context(ctx);
-        return false;
-    }
     
     ods_log_debug("[%s] Generating %d bit RSA key in repository: %s",
                   module_str,keysize,repository);
@@ -95,16 +87,124 @@ generate_keypair(int sockfd,
         hsm_key_free(key);
     } else {
         ods_log_error_and_printf(sockfd, module_str, "key generation failed");
-        hsm_destroy_context(ctx);
         return false;
     }
-    hsm_destroy_context(ctx);
     return true;
 }
 
+// Shared state of the threads generating keys for generate_keypairs.
+struct KeyGenWork {
+	int sockfd;
+	const char *repository;
+	unsigned int keysize;
+	int ntodo; // keys no thread started generating yet
+	int nrunning; // threads that are still generating keys
+	bool failed;
+	std::vector<std::string> locators; // generated but not stored yet
+	lock_basic_type lock;
+	cond_basic_type cond;
+};
+
+// Generate keys until there are no more keys to do or one of the threads
+// failed. Every thread uses its own HSM context and thus its own sessions.
+static void *
+generate_keypairs_thread(void *arg)
+{
+	KeyGenWork &work = *(KeyGenWork *)arg;
+
+    hsm_ctx_t *ctx = hsm_create_context();
+    if (!ctx)
+		ods_log_error_and_printf(work.sockfd,module_str,
+								 "could not connect to HSM");
+    else if (hsm_token_attached(ctx, work.repository) == 0) {
+        /* Check for repository before starting using it */
+        hsm_print_error(ctx);
+        hsm_destroy_context(ctx);
+        ctx = NULL;
+    }
+
+	bool ok = ctx != NULL;
+	for (;;) {
+		lock_basic_lock(&work.lock);
+		if (!ok)
+			work.failed = true;
+		bool done = work.failed || work.ntodo <= 0;
+		if (!done)
+			--work.ntodo;
+		lock_basic_unlock(&work.lock);
+		if (done)
+			break;
+
+		std::string locator;
+		ok = generate_keypair(work.sockfd, ctx, work.repository,
+							  work.keysize, locator);
+		if (ok) {
+			lock_basic_lock(&work.lock);
+			work.locators.push_back(locator);
+			lock_basic_alarm(&work.cond);
+			lock_basic_unlock(&work.lock);
+		}
+	}
+
+	if (ctx)
+		hsm_destroy_context(ctx);
+
+	lock_basic_lock(&work.lock);
+	--work.nrunning;
+	lock_basic_alarm(&work.cond);
+	lock_basic_unlock(&work.lock);
+	return NULL;
+}
+
+// Insert the generated keys into the database in a single transaction.
+static bool
+store_keypairs(int sockfd,
+			   OrmConn conn,
+			   const std::vector<std::string> &locators,
+			   int nbits,
+			   const char *repository,
+			   const char *policy_name,
+			   ::google::protobuf::uint32 algorithm,
+			   ::ods::hsmkey::keyrole role)
+{
+	// We do insertion of the generated keys into the database here
+	// after generating of the keys.
+	// Key generation can take a long time so we accept the risk of 
+	// creating orphaned keys in the hsm that are not registered in
+	// the database because the transaction to insert them failed.
+	OrmTransactionRW transaction(conn);
+	const char *errmsg = NULL;
+	if (!transaction.started())
+		errmsg = "error starting transaction for storing "
+				 "generated hsm keys in the database.";
+	for (size_t k=0; !errmsg && k<locators.size(); ++k) {
+		// initialize the db hsm key with info from the generated hsm key.
+		::ods::hsmkey::HsmKey key;
+		key.set_locator(locators[k]);
+		key.set_bits(nbits);
+		key.set_repository(repository);
+		key.set_policy(policy_name);
+		key.set_algorithm(algorithm);
+		key.set_role(role);
+		key.set_key_type("RSA");
+
+		pb::uint64 keyid;
+		if (!OrmMessageInsert(conn, key, keyid)) 
+			errmsg = "error inserting generated hsm key into the database.";
+	}
+	if (!errmsg && !transaction.commit())
+		errmsg = "error commiting generated hsm keys to the database.";
+	if (errmsg) {
+		ods_log_error_and_printf(sockfd, module_str, errmsg);
+		return false;
+	}
+	return true;
+}
+
 static bool
 generate_keypairs(int sockfd,
 				  OrmConn conn,
+				  int nthreads,
 				  int ngen,
 				  int nbits,
 				  const char *repository,
@@ -128,64 +228,85 @@ generate_keypairs(int sockfd,
 			   ngen,
 			   ::ods::hsmkey::keyrole_Name(role).c_str(),
 			   nbits, policy_name);
-    
-    // Generate additional keys until certain minimum number is 
-    // available.
-    for ( ;ngen>0; --ngen) {
-        std::string locator;
-        if (!generate_keypair(sockfd,repository,nbits,locator)) {
-            // perhaps this HSM can't generate keys of this size.
-            ods_log_error_and_printf(sockfd,
-									 module_str,
-									 "unable to generate a %s of %d bits",
-									 ::ods::hsmkey::keyrole_Name(role).c_str(),
-									 nbits);
-            break;
-		} else {
-			
-			// initialize the db hsm key with info from the generated hsm key.
-            ::ods::hsmkey::HsmKey key;
-            key.set_locator(locator);
-            key.set_bits(nbits);
-            key.set_repository(repository);
-            key.set_policy(policy_name);
-            key.set_algorithm(algorithm);
-            key.set_role(role);
-            key.set_key_type("RSA");
 
-			{
-				// We do insertion of the generated key into the database here
-				// after generating of the key.
-				// Key generation can take a long time so we accept the risk of 
-				// creating orphaned keys in the hsm that are not registered in
-				// the database because the transaction to insert them failed.
-				OrmTransactionRW transaction(conn);
-				const char *errmsg = NULL;
-				if (!transaction.started())
-					errmsg = "error starting transaction for storing "
-							 "generated hsm key in the database.";
-				else {
-					pb::uint64 keyid;
-					if (!OrmMessageInsert(conn, key, keyid)) 
-						errmsg = "error inserting generated hsm key into "
-								 "the database.";
-					else {
-						if (!transaction.commit())
-							errmsg = "error commiting generated hsm key to "
-									 "the database.";
-						else
-							bkeysgenerated_and_stored = true;
-					}
-				}
-				if (errmsg) {
-					ods_log_error_and_printf(sockfd, module_str, errmsg);
-					break;
-				}
-			}
-        }
+	KeyGenWork work;
+	work.sockfd = sockfd;
+	work.repository = repository;
+	work.keysize = nbits;
+	work.ntodo = ngen;
+	work.failed = false;
+	lock_basic_init(&work.lock);
+	lock_basic_set(&work.cond);
+
+	time_t t_start = time_now();
+	int nstored = 0;
+	bool bstorefailed = false;
+
+#if defined(HAVE_PTHREAD)
+	// Keep several key generations in flight, while the generated keys are 
+	// stored from this thread in a transaction per bunch of finished keys.
+	int nthreads_used = std::max(1,std::min(nthreads,ngen));
+	work.nrunning = nthreads_used;
+	std::vector<ods_thread_type> threads(nthreads_used);
+	for (size_t t=0; t<threads.size(); ++t)
+		ods_thread_create(&threads[t], generate_keypairs_thread, &work);
+#else
+	int nthreads_used = 1;
+	work.nrunning = 1;
+	generate_keypairs_thread(&work);
+#endif
+
+	for (;;) {
+		std::vector<std::string> locators;
+		lock_basic_lock(&work.lock);
+		while (work.locators.empty() && work.nrunning > 0)
+			lock_basic_sleep(&work.cond, &work.lock, 0);
+		locators.swap(work.locators);
+		bool done = work.nrunning <= 0 && locators.empty();
+		if (bstorefailed)
+			work.failed = true;
+		lock_basic_unlock(&work.lock);
+		if (done)
+			break;
+		if (bstorefailed)
+			continue; // wait for the generators to notice and stop.
+
+		if (store_keypairs(sockfd, conn, locators, nbits, repository,
+						   policy_name, algorithm, role))
+		{
+			nstored += locators.size();
+			bkeysgenerated_and_stored = true;
+		} else
+			bstorefailed = true;
+	}
+
+#if defined(HAVE_PTHREAD)
+	for (size_t t=0; t<threads.size(); ++t)
+		ods_thread_join(threads[t]);
+#endif
+	lock_basic_off(&work.cond);
+	lock_basic_destroy(&work.lock);
+
+    if (work.failed && !bstorefailed) {
+        // perhaps this HSM can't generate keys of this size.
+        ods_log_error_and_printf(sockfd,
+								 module_str,
+								 "unable to generate a %s of %d bits",
+								 ::ods::hsmkey::keyrole_Name(role).c_str(),
+								 nbits);
     }
-    
-    if (ngen<=0) {
+
+	time_t t_spent = std::max(time_now() - t_start, (time_t)1);
+	ods_log_info("[%s] stored %d %ss of %d bits in %ld seconds "
+				 "(%.2f keys/s) using %d thread(s)", module_str,
+				 nstored, ::ods::hsmkey::keyrole_Name(role).c_str(), nbits,
+				 (long)t_spent, (double)nstored/t_spent, nthreads_used);
+	ods_printf(sockfd,
+			   "stored %d %ss of %d bits in %ld seconds (%.2f keys/s) "
+			   "using %d thread(s).\n",
+			   nstored, ::ods::hsmkey::keyrole_Name(role).c_str(), nbits,
+			   (long)t_spent, (double)nstored/t_spent, nthreads_used);
+    if (nstored == ngen) {
         ods_printf(sockfd,
 				   "finished generating %d bit %ss.\n",
 				   nbits,
@@ -242,7 +363,8 @@ count_unused_hsmkeys(OrmConn conn,
 }
 
 static void
-generate_ksks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
+generate_ksks(int sockfd, OrmConn conn, int nthreads,
+			  const ::ods::kasp::Policy &policy,
 			  time_t duration, pb::uint64 nzones)
 {
 	::ods::hsmkey::keyrole key_role = ::ods::hsmkey::KSK;
@@ -263,6 +385,7 @@ generate_ksks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
 			int key_pregen = (int)ceil((double)duration/(double)key.lifetime());
 			if (!generate_keypairs(sockfd,
 								   conn,
+								   nthreads,
 								   (nzones*key_pregen)-nunusedkeys,
 								   key.bits(),
 								   key.repository().c_str(),
@@ -278,7 +401,8 @@ generate_ksks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
 }
 
 static void
-generate_zsks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
+generate_zsks(int sockfd, OrmConn conn, int nthreads,
+			  const ::ods::kasp::Policy &policy,
 			  time_t duration, pb::uint64 nzones)
 {
 	::ods::hsmkey::keyrole key_role = ::ods::hsmkey::ZSK;
@@ -299,6 +423,7 @@ generate_zsks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
 			int key_pregen = (int)ceil((double)duration/(double)key.lifetime());
 			if (!generate_keypairs(sockfd,
 								   conn,
+								   nthreads,
 								   (nzones*key_pregen)-nunusedkeys,
 								   key.bits(),
 								   key.repository().c_str(),
@@ -314,7 +439,8 @@ generate_zsks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
 }
 
 static void
-generate_csks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
+generate_csks(int sockfd, OrmConn conn, int nthreads,
+			  const ::ods::kasp::Policy &policy,
 			  time_t duration, pb::uint64 nzones)
 {
 	::ods::hsmkey::keyrole key_role = ::ods::hsmkey::CSK;
@@ -335,6 +461,7 @@ generate_csks(int sockfd, OrmConn conn, const ::ods::kasp::Policy &policy,
 			int key_pregen = (int)ceil((double)duration/(double)key.lifetime());
 			if (!generate_keypairs(sockfd,
 								   conn,
+								   nthreads,
 								   (nzones*key_pregen)-nunusedkeys,
 								   key.bits(),
 								   key.repository().c_str(),
@@ -455,9 +582,12 @@ perform_hsmkey_gen(int sockfd, engineconfig_type *config, int bManual,
 		 * with the number of zones using this policy. */
 		if (count > 0 && kasp.policies(i).keys().zones_share_keys())
 			count = 1;
-		generate_ksks(sockfd, conn, kasp.policies(i), duration, count);
-		generate_zsks(sockfd, conn, kasp.policies(i), duration, count);
-		generate_csks(sockfd, conn, kasp.policies(i), duration, count);
+		generate_ksks(sockfd, conn, config->num_security_module_threads,
+					  kasp.policies(i), duration, count);
+		generate_zsks(sockfd, conn, config->num_security_module_threads,
+					  kasp.policies(i), duration, count);
+		generate_csks(sockfd, conn, config->num_security_module_threads,
+					  kasp.policies(i), duration, count);
     }
 }
 
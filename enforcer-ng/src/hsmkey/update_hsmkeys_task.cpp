@@ -162,6 +162,12 @@ import_all_keys_from_all_hsms(int sockfd, OrmConn conn)
 			key.set_bits(kinf->keysize);
 			key.set_key_type( kinf->algorithm_name );
 			key.set_repository( k->module->name );
+
+			// Store the pool columns explicitly, the key factory looks up
+			// unused keys on equality of all of them.
+			key.set_policy( key.policy() );
+			key.set_algorithm( key.algorithm() );
+			key.set_role( key.role() );
 			
 			// verify that according to the proto file definition the key is
 			// fully initialized.
@@ -533,6 +533,22 @@ parse_conf_worker_threads(const char* cfgfile)
     return numwt;
 }
 
+int
+parse_conf_security_module_threads(const char* cfgfile)
+{
+    int numhsmt = 1;
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Enforcer/SecurityModuleThreads",
+        0);
+    if (str) {
+        if (strlen(str) > 0) {
+            numhsmt = atoi(str);
+        }
+        free((void*)str);
+    }
+    return numhsmt > 0 ? numhsmt : 1;
+}
+
 int
 parse_conf_manual_keygen(const char* cfgfile)
 {
@@ -546,6 +562,35 @@ parse_conf_manual_keygen(const char* cfgfile)
     return 0;
 }
 
+int
+parse_conf_enforce_batch_size(const char* cfgfile)
+{
+    int batch = ODS_EN_ENFORCEBATCHSIZE;
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Enforcer/EnforceBatchSize",
+        0);
+    if (str) {
+        if (strlen(str) > 0) {
+            batch = atoi(str);
+        }
+        free((void*)str);
+    }
+    return batch > 0 ? batch : ODS_EN_ENFORCEBATCHSIZE;
+}
+
+int
+parse_conf_parallel_enforce(const char* cfgfile)
+{
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Enforcer/ParallelEnforce",
+        0);
+    if (str) {
+        free((void*)str);
+        return 1;
+    }
+    return 0;
+}
+
 int
 parse_conf_db_port(const char* cfgfile)
 {
@@ -562,6 +607,74 @@ parse_conf_db_port(const char* cfgfile)
     return port;
 }
 
+const char*
+parse_conf_sqlite_journal(allocator_type* allocator, const char* cfgfile)
+{
+    const char* dup = NULL;
+    const char* str = parse_conf_string(
+        cfgfile,
+        "//Configuration/Enforcer/Datastore/SQLite/@journal",
+        0);
+
+    if (str) {
+        dup = allocator_strdup(allocator, str);
+        free((void*)str);
+    } else {
+        dup = allocator_strdup(allocator, ODS_EN_SQLITE_JOURNAL);
+    }
+    return dup;
+}
+
+const char*
+parse_conf_sqlite_synchronous(allocator_type* allocator, const char* cfgfile)
+{
+    const char* dup = NULL;
+    const char* str = parse_conf_string(
+        cfgfile,
+        "//Configuration/Enforcer/Datastore/SQLite/@synchronous",
+        0);
+
+    if (str) {
+        dup = allocator_strdup(allocator, str);
+        free((void*)str);
+    } else {
+        dup = allocator_strdup(allocator, ODS_EN_SQLITE_SYNCHRONOUS);
+    }
+    return dup;
+}
+
+int
+parse_conf_sqlite_cache_size(const char* cfgfile)
+{
+    int kb = 0; /* returning 0 (zero) means use the SQLite default */
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Enforcer/Datastore/SQLite/@cachesize",
+        0);
+    if (str) {
+        if (strlen(str) > 0) {
+            kb = atoi(str);
+        }
+        free((void*)str);
+    }
+    return kb > 0 ? kb : 0;
+}
+
+int
+parse_conf_sqlite_mmap_size(const char* cfgfile)
+{
+    int mb = 0; /* returning 0 (zero) means no memory mapping */
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Enforcer/Datastore/SQLite/@mmapsize",
+        0);
+    if (str) {
+        if (strlen(str) > 0) {
+            mb = atoi(str);
+        }
+        free((void*)str);
+    }
+    return mb > 0 ? mb : 0;
+}
+
 time_t
 parse_conf_automatic_keygen_period(const char* cfgfile)
 {
@@ -106,6 +106,10 @@ const char* parse_conf_db_username(allocator_type* allocator,
 	const char* cfgfile);
 const char* parse_conf_db_password(allocator_type* allocator,
 	const char* cfgfile);
+const char* parse_conf_sqlite_journal(allocator_type* allocator,
+	const char* cfgfile);
+const char* parse_conf_sqlite_synchronous(allocator_type* allocator,
+	const char* cfgfile);
 
 /**
  * Parse elements from the configuration file.
@@ -120,8 +124,13 @@ int parse_conf_verbosity(const char* cfgfile);
 
 /** Enforcer specific */
 int parse_conf_worker_threads(const char* cfgfile);
+int parse_conf_security_module_threads(const char* cfgfile);
 int parse_conf_manual_keygen(const char* cfgfile);
+int parse_conf_enforce_batch_size(const char* cfgfile);
+int parse_conf_parallel_enforce(const char* cfgfile);
 int parse_conf_db_port(const char *cfgfile);
+int parse_conf_sqlite_cache_size(const char* cfgfile);
+int parse_conf_sqlite_mmap_size(const char* cfgfile);
 time_t parse_conf_automatic_keygen_period(const char* cfgfile);
 	
 #ifdef __cplusplus
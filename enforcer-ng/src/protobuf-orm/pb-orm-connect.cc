@@ -79,6 +79,14 @@ bool OrmConnectMySQL(const std::string &host,
 bool OrmConnectSQLite3(const std::string &dbdir,
 					   const std::string &dbname,
 					   OrmConn &handle)
+{
+	return OrmConnectSQLite3(dbdir, dbname, OrmSQLite3Options(), handle);
+}
+
+bool OrmConnectSQLite3(const std::string &dbdir,
+					   const std::string &dbname,
+					   const OrmSQLite3Options &options,
+					   OrmConn &handle)
 {
 #if defined(ENFORCER_DATABASE_SQLITE3)
 	DB::OrmConnT *conn = DB::SQLite3::NewOrmConnT();
@@ -96,6 +104,15 @@ bool OrmConnectSQLite3(const std::string &dbdir,
 	// allow busy timeout of transactions of 15 seconds.
 	conn->set_option("timeout_ms", 15000);
 
+	if (options.journal_mode.size() > 0)
+		conn->set_option("journal_mode", options.journal_mode);
+	if (options.synchronous.size() > 0)
+		conn->set_option("synchronous", options.synchronous);
+	if (options.cache_size_kb > 0)
+		conn->set_option("cache_size_kb", options.cache_size_kb);
+	if (options.mmap_size_mb > 0)
+		conn->set_option("mmap_size_mb", options.mmap_size_mb);
+
 	if (!conn->connect()) {
 		delete conn;
 		return false;
@@ -107,7 +124,24 @@ bool OrmConnectSQLite3(const std::string &dbdir,
 #endif
 }
 
+static OrmConnCloseHandler static_OrmConnCloseHandler = NULL;
+
 void OrmConnClose(OrmConn handle)
 {
-	delete ((DB::OrmConnT *)handle);
+	DB::OrmConnT *conn = (DB::OrmConnT *)handle;
+	if (conn && static_OrmConnCloseHandler
+		&& static_OrmConnCloseHandler(handle, !conn->in_transaction()))
+		return;
+	delete conn;
+}
+
+void OrmSetConnCloseHandler(OrmConnCloseHandler handler)
+{
+	static_OrmConnCloseHandler = handler;
+}
+
+bool OrmConnPing(OrmConn handle)
+{
+	DB::OrmResultT r( ((DB::OrmConnT *)handle)->queryf("SELECT 1") );
+	return r.assigned();
 }
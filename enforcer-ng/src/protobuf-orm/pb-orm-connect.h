@@ -58,8 +58,49 @@ bool OrmConnectSQLite3(const std::string &dbdir,
 					   const std::string &dbname,
 					   OrmConn &conn);
 
+/**
+ * Tuning applied to a SQLite3 connection when it is opened. Empty strings
+ * and zero sizes leave the SQLite default in place.
+ */
+struct OrmSQLite3Options {
+	std::string journal_mode;	// e.g. "WAL" or "DELETE"
+	std::string synchronous;	// "OFF", "NORMAL", "FULL" or "EXTRA"
+	int cache_size_kb;			// page cache size per connection in KiB
+	int mmap_size_mb;			// memory mapped part of the database in MiB
+	OrmSQLite3Options() : cache_size_kb(0), mmap_size_mb(0) {}
+};
+
+/**
+ * Establish an ORM connection with a SQLite3 database and apply options.
+ * \param[in] dbdir directory containing the database file
+ * \param[in] dbname name of the database file
+ * \param[in] options pragmas to apply to the connection
+ * \return bool returns whether the connection was successfully established.
+ */
+bool OrmConnectSQLite3(const std::string &dbdir,
+					   const std::string &dbname,
+					   const OrmSQLite3Options &options,
+					   OrmConn &conn);
+
 void OrmConnClose(OrmConn conn);
 
+// Called by OrmConnClose before closing a connection. When the handler
+// returns true it took over the connection, e.g. to keep it open in a pool,
+// and the connection is not closed. A connection that still has a
+// transaction open is passed as not reusable and must not be taken over.
+typedef bool (*OrmConnCloseHandler)(OrmConn conn, bool reusable);
+
+// Set the handler consulted by OrmConnClose, set to NULL to always close.
+void OrmSetConnCloseHandler(OrmConnCloseHandler handler);
+
+/**
+ * Check whether a connection that has been idle is still usable.
+ * \param[in] conn connection to check
+ * \return bool returns whether a trivial query succeeded.
+ *
+ */
+bool OrmConnPing(OrmConn conn);
+
 
 class OrmConnRef {
 public:
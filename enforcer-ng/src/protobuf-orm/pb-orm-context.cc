@@ -30,8 +30,10 @@
 //
 
 #include "pb-orm-context.h"
+#include "pb-orm-value.h"
 
-OrmContextT::OrmContextT() : conn(0), id(0), message(NULL)
+OrmContextT::OrmContextT()
+	: conn(0), id(0), message(NULL), snapshot_valid(false)
 {
 }
 
@@ -46,3 +48,44 @@ OrmContextT::~OrmContextT()
 		}
 	}
 }
+
+bool OrmContextT::snapshot()
+{
+	if (!message)
+		return false;
+	
+	values.clear();
+	const pb::Descriptor *descriptor = message->GetDescriptor();
+	for (int f=0; f<descriptor->field_count(); ++f) {
+		const pb::FieldDescriptor *field = descriptor->field(f);
+		std::map<pb::uint64,OrmContext> &fc = fields[field->number()];
+		if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
+			std::map<pb::uint64,OrmContext>::iterator cit;
+			for (cit=fc.begin(); cit!=fc.end(); ++cit) {
+				OrmContextT *fcontext = (OrmContextT *)cit->second;
+				if (fcontext && !fcontext->snapshot_valid
+					&& !fcontext->snapshot())
+					return false;
+			}
+		} else if (field->is_repeated()) {
+			// repeated values are mapped by their index in the field.
+			int fieldsize = message->GetReflection()->FieldSize(*message, field);
+			std::map<pb::uint64,OrmContext>::iterator cit;
+			for (cit=fc.begin(); cit!=fc.end(); ++cit) {
+				OrmContextT *fcontext = (OrmContextT *)cit->second;
+				if (!fcontext || (int)cit->first >= fieldsize)
+					continue;
+				if (!pb_field_snapshot_value(message, field, (int)cit->first,
+											 fcontext->value))
+					return false;
+				fcontext->snapshot_valid = true;
+			}
+		} else {
+			if (!pb_field_snapshot_value(message, field, -1,
+										 values[field->number()]))
+				return false;
+		}
+	}
+	snapshot_valid = true;
+	return true;
+}
@@ -45,8 +45,20 @@ public:
 	// maps field tag number to record id for a message or repeated value
 	std::map< int, std::map<pb::uint64,OrmContext> > fields;
 	
+	// Values as they were read from the db, used by OrmMessageUpdate to only
+	// write what changed. For a message the values of the columns in its
+	// table are mapped by field tag number, for a repeated value the
+	// element value is kept in value.
+	bool snapshot_valid;
+	std::map<int, std::string> values;
+	std::string value;
+	
 	OrmContextT();
 	~OrmContextT();
+	
+	// Record the current values of message and its repeated values, recurses
+	// into aggregated messages that have no snapshot yet.
+	bool snapshot();
 private:
 	OrmContextT(const OrmContextT&);
 	
@@ -246,12 +246,93 @@ pb_field_to_orm_type(OrmConn conn,
 	return true;
 }
 
+static bool
+orm_create_index(OrmConn conn,
+				 const std::string &table,
+				 const std::string &name,
+				 const std::string &columns)
+{
+	if (CONN->index_exists(table, name))
+		return true;
+
+	DB::OrmResultT result( CONN->CreateIndex(name, table, columns) );
+	if (!result.assigned()) {
+		OrmLogError("failed to create index: %s",name.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool OrmTableExists(OrmConn conn, const pb::Descriptor* descriptor)
+{
+	return CONN->table_exists(descriptor->name());
+}
+
+bool OrmCreateIndexes(OrmConn conn, const pb::Descriptor* descriptor)
+{
+	// Add the indexes for a protocol buffer message to existing tables.
+	// Tables that do not exist are left alone.
+
+	if (!CONN->table_exists(descriptor->name()))
+		return true;
+
+	if (descriptor->options().HasExtension(orm::index)) {
+		const orm::Index index = descriptor->options().GetExtension(orm::index);
+		if (index.has_spec()) {
+			std::string name;
+			if (index.has_name())
+				name = index.name();
+			else
+				name = descriptor->name() + "_index";
+			if (!orm_create_index(conn, descriptor->name(), name, index.spec()))
+				return false;
+		}
+	}
+
+	for (int f=0; f<descriptor->field_count(); ++f) {
+		const pb::FieldDescriptor *field = descriptor->field(f);
+		if (field->is_repeated()) {
+			// Link tables are looked up by parent_id, and message link
+			// tables also by child_id. The primary key of a message link
+			// table already covers parent_id.
+			std::string orm_name = descriptor->name()+ "_" + field->name();
+			if (CONN->table_exists(orm_name)) {
+				if (field->type() != pb::FieldDescriptor::TYPE_MESSAGE) {
+					if (!orm_create_index(conn, orm_name,
+										  orm_name + "_parent_id_index",
+										  "parent_id"))
+						return false;
+				} else {
+					if (!orm_create_index(conn, orm_name,
+										  orm_name + "_child_id_index",
+										  "child_id"))
+						return false;
+				}
+			}
+		} else if (field->options().HasExtension(orm::column) &&
+				   field->options().GetExtension(orm::column).index())
+		{
+			std::string name;
+			pb_field_name(field,name);
+			if (!orm_create_index(conn, descriptor->name(),
+								  descriptor->name() + "_" + name + "_index",
+								  name))
+				return false;
+		}
+		if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
+			if (!OrmCreateIndexes(conn, field->message_type()))
+				return false;
+		}
+	}
+	return true;
+}
+
 bool OrmCreateTable(OrmConn conn, const pb::Descriptor* descriptor)
 {	
 	// Create a table based on the meta information of a protocol buffer message
 
 	if (CONN->table_exists(descriptor->name()))
-		return true;
+		return OrmCreateIndexes(conn, descriptor);
 
 	std::string fields;
 	for (int f=0; f<descriptor->field_count(); ++f) {
@@ -309,5 +390,5 @@ bool OrmCreateTable(OrmConn conn, const pb::Descriptor* descriptor)
 		OrmLogError("failed to create table: %s",descriptor->name().c_str());
 		return false;
 	}
-	return true;
+	return OrmCreateIndexes(conn, descriptor);
 }
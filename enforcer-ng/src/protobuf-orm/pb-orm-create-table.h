@@ -59,4 +59,21 @@ implementations though when the column is optional
 
 bool OrmCreateTable(OrmConn conn, const pb::Descriptor* descriptor);
 
+/*
+
+Indexes
+-------
+Link tables of repeated fields get an index on the columns they are queried
+on. Columns of fields with the (orm.column).index option and the columns in
+the (orm.index).spec message option are indexed as well. Indexes that are
+missing are added to existing tables, so calling this on a datastore created
+by an older version upgrades it.
+
+ */
+
+bool OrmCreateIndexes(OrmConn conn, const pb::Descriptor* descriptor);
+
+// Whether the table for a protocol buffer message exists.
+bool OrmTableExists(OrmConn conn, const pb::Descriptor* descriptor);
+
 #endif
@@ -63,6 +63,35 @@ pb_insert_names_and_values_into_table(OrmConn conn,
 	return true;
 }
 
+static bool
+pb_insert_params_into_table(OrmConn conn,
+							const std::string &key,
+							const std::string &table,
+							const std::string &names,
+							const std::string &placeholders,
+							const DB::OrmParamsT &params)
+{
+	DB::OrmResultT result;
+	if (names.size() > 0) {
+		result = CONN->query_prepared(key,
+									  params,
+									  "INSERT INTO %s (%s) VALUES (%s)",
+									  table.c_str(),
+									  names.c_str(),
+									  placeholders.c_str());
+	} else {
+		result = CONN->query_prepared(key,
+									  params,
+									  "INSERT INTO %s (id) VALUES (NULL)",
+									  table.c_str());
+	}
+	if (!result.assigned()) {
+		OrmLogError("failed to insert values into table: %s",table.c_str());
+		return false; // valid id is never 0
+	}
+	return true;
+}
+
 static bool
 pb_field_add_repeated_message(OrmConn conn,
 							  pb::uint64 id,
@@ -71,16 +100,13 @@ pb_field_add_repeated_message(OrmConn conn,
 {
 	// insert new parent_id,child_id pair into the repeated field table.
 	std::string table = field->containing_type()->name() + "_" + field->name();
-	std::string names("parent_id,child_id");
-	std::string values;
-	if (!pb_field_uint64_value(id,values))
-		return false;
-	std::string childidstr;
-	if (!pb_field_uint64_value(childid,childidstr))
-		return false;
-	OrmChain(values,childidstr,',');
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+	params.add_ulonglong(childid);
 	
-	return pb_insert_names_and_values_into_table(conn, table, names, values);
+	return pb_insert_params_into_table(conn, field->full_name()+":insert",
+									   table, "parent_id,child_id", "?,?",
+									   params);
 }
 
 static bool
@@ -131,7 +157,8 @@ pb_field_type_valid(const pb::FieldDescriptor *field)
 bool OrmMessageInsert(OrmConn conn, const pb::Message &message, pb::uint64 &id)
 {
 	std::string names;
-	std::string values;
+	std::string placeholders;
+	DB::OrmParamsT params;
 	const pb::Descriptor *descriptor = message.GetDescriptor();
 	const pb::Reflection *reflection = message.GetReflection();
 	
@@ -147,8 +174,6 @@ bool OrmMessageInsert(OrmConn conn, const pb::Message &message, pb::uint64 &id)
 	std::vector<const pb::FieldDescriptor*> fields;
 	reflection->ListFields(message,&fields);
 	
-	names.clear();
-	values.clear();
 	for (int fi=0; fi<fields.size(); ++fi) {
 		
 		// we don't handle repeated fields during this stage of an insert.
@@ -161,31 +186,29 @@ bool OrmMessageInsert(OrmConn conn, const pb::Message &message, pb::uint64 &id)
 		std::string name;
 		pb_field_name(fields[fi],name);
 		OrmChain(names,name,',');
+		OrmChain(placeholders,"?",',');
 		
-		std::string value;
 		if (fields[fi]->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
 			// Handle MESSAGE value
 			pb::uint64 fieldid;
 			if (!OrmMessageInsert(conn,reflection->GetMessage(message, fields[fi]),fieldid))
 				return false; // failed to insert aggregated message, don't continue.
-			
-			// failed to format field, don't continue.
-			if (!pb_field_uint64_value(fieldid,value))
-				return false;
+			params.add_ulonglong(fieldid);
 		} else {
 			// Handle other types of values.
-			if (!pb_field_value(conn,&message,fields[fi],value))
+			if (!pb_field_param(conn,&message,fields[fi],params))
 				return false;
 		}
-		
-		OrmChain(values,value,',');
-		
 	}
 	
-	if (!pb_insert_names_and_values_into_table(conn,
-											   message.GetDescriptor()->name(),
-											   names,
-											   values)
+	// The set of fields present differs between messages of the same type,
+	// so the columns are part of the key for the prepared statement.
+	if (!pb_insert_params_into_table(conn,
+									 descriptor->full_name()+":insert:"+names,
+									 descriptor->name(),
+									 names,
+									 placeholders,
+									 params)
 		)
 		return false;
 
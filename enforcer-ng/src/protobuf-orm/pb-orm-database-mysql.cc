@@ -37,6 +37,7 @@
 #include <time.h>
 #include <map>
 #include <utility>
+#include <vector>
 #include <mysql/mysql.h>
 #include <cstdio>
 
@@ -562,7 +563,16 @@ namespace DB {
 			
 			virtual OrmResultT query(const char *statement, int len);
 			
+			virtual bool is_prepared(const std::string &key);
+			virtual bool prepare(const std::string &key,
+								 const char *statement, int len);
+			virtual OrmResultT execute_prepared(const std::string &key,
+												const OrmParamsT &params);
+			virtual void clear_prepared();
+			
 			virtual bool table_exists(const std::string &name);
+			virtual bool index_exists(const std::string &table,
+									  const std::string &name);
 			virtual bool quote_string(const std::string &value, std::string &dest);
 			virtual bool quote_binary(const std::string &value, std::string &dest);
 			
@@ -573,12 +583,23 @@ namespace DB {
 			virtual OrmResultT CreateTableRelation(const std::string &name);
 			virtual OrmResultT CreateTableRepeatedValue(const std::string &name,
 														  const std::string &type);
+			virtual OrmResultT CreateIndex(const std::string &name,
+										   const std::string &table,
+										   const std::string &columns);
 			
 		protected:
 			unsigned int _transaction_level;
 			std::map< std::string, std::string >_options;
 			std::map< std::string, int>_numoptions;
 			bool successful(int rv);
+			
+			// Prepared statements split at their '?' placeholders.
+			struct Statement {
+				std::vector<std::string> parts;
+				unsigned long long used;
+			};
+			std::map< std::string, Statement >_statements;
+			unsigned long long _uses;
 		};
 
 	}
@@ -591,7 +612,7 @@ namespace DB {
 	///////////////////////////
 	
 	MySQL::OrmConnT::OrmConnT()
-		: db(NULL), _transaction_level(0)
+		: db(NULL), _transaction_level(0), _uses(0)
 	{
 		_numoptions["timeout_ms"] = 15000; // 15 seconds
 	}
@@ -685,6 +706,7 @@ namespace DB {
 	
 	void MySQL::OrmConnT::close()
 	{
+		clear_prepared();
 		if (db) {
 			mysql_close(db);
 			db = NULL;
@@ -784,6 +806,98 @@ namespace DB {
 		return OrmResultT((OrmConn)this, new MySQL::OrmResultImpl(result));
 	}
 		
+	// The statement is parsed once and kept in the connection, the parameters
+	// are escaped into it on every execution. The MySQL server side prepared
+	// statements return rows through MYSQL_BIND buffers instead of a MYSQL_RES
+	// so they can't be fed to MySQL::OrmResultImpl.
+	bool MySQL::OrmConnT::is_prepared(const std::string &key)
+	{
+		return _statements.find(key) != _statements.end();
+	}
+
+	bool MySQL::OrmConnT::prepare(const std::string &key,
+								  const char *statement, int len)
+	{
+		std::vector<std::string> parts(1);
+		for (int i=0; i<len; ++i) {
+			if (statement[i] == '?')
+				parts.push_back(std::string());
+			else
+				parts.back().push_back(statement[i]);
+		}
+		if (_statements.find(key) == _statements.end()
+			&& _statements.size() >= prepared_max)
+		{
+			// Drop the least recently used statement.
+			std::map< std::string, Statement >::iterator it, lru;
+			lru = _statements.begin();
+			for (it = _statements.begin(); it != _statements.end(); ++it)
+				if (it->second.used < lru->second.used)
+					lru = it;
+			_statements.erase(lru);
+		}
+		Statement &cached = _statements[key];
+		cached.parts.swap(parts);
+		cached.used = ++_uses;
+		return true;
+	}
+
+	OrmResultT MySQL::OrmConnT::execute_prepared(const std::string &key,
+												 const OrmParamsT &params)
+	{
+		std::map< std::string, Statement >::iterator it = _statements.find(key);
+		if (it == _statements.end()) {
+			OrmLogError("no prepared statement for %s", key.c_str());
+			return OrmResultT();
+		}
+		it->second.used = ++_uses;
+		const std::vector<std::string> &parts = it->second.parts;
+		if (parts.size() != params.size()+1) {
+			OrmLogError("expected %d parameters, got %d",
+						(int)parts.size()-1, (int)params.size());
+			return OrmResultT();
+		}
+		
+		std::string statement(parts[0]);
+		for (size_t i=0; i<params.size(); ++i) {
+			const OrmParamsT::Value &value = params[i];
+			std::string literal;
+			bool ok;
+			switch (value.type) {
+				case OrmParamsT::INTEGER:
+					ok = OrmFormat(literal, "%lld", value.integer);
+					break;
+				case OrmParamsT::UNSIGNED:
+					ok = OrmFormat(literal, "%llu",
+								   (unsigned long long)value.integer);
+					break;
+				case OrmParamsT::REAL:
+					ok = OrmFormat(literal, "%.17g", value.real);
+					break;
+				case OrmParamsT::TEXT:
+					ok = quote_string(value.str, literal);
+					break;
+				case OrmParamsT::BLOB:
+					ok = quote_binary(value.str, literal);
+					break;
+				default:
+					literal = "NULL";
+					ok = true;
+					break;
+			}
+			if (!ok)
+				return OrmResultT();
+			statement += literal;
+			statement += parts[i+1];
+		}
+		return query(statement.c_str(), (int)statement.size());
+	}
+
+	void MySQL::OrmConnT::clear_prepared()
+	{
+		_statements.clear();
+	}
+
 	bool MySQL::OrmConnT::table_exists(const std::string &name)
 	{
 		OrmResultT exists = queryf("SHOW TABLES LIKE '%s'", name.c_str());
@@ -794,6 +908,18 @@ namespace DB {
 			return false;
 	}
 	
+	bool MySQL::OrmConnT::index_exists(const std::string &table,
+									   const std::string &name)
+	{
+		OrmResultT exists = queryf("SHOW INDEX FROM %s WHERE Key_name='%s'",
+								   table.c_str(), name.c_str());
+
+		if (exists.assigned())
+			return exists->first_row();
+		else
+			return false;
+	}
+	
 	bool MySQL::OrmConnT::quote_string(const std::string &value,
 										 std::string &dest)
 	{
@@ -894,6 +1020,17 @@ namespace DB {
 					  _options["encoding"].c_str());
 	}
 
+	OrmResultT MySQL::OrmConnT::CreateIndex(const std::string &name,
+											const std::string &table,
+											const std::string &columns)
+	{
+		// MySQL has no CREATE INDEX IF NOT EXISTS, callers check first.
+		return queryf("CREATE INDEX %s ON %s (%s)",
+					  name.c_str(),
+					  table.c_str(),
+					  columns.c_str());
+	}
+
 	///////////////////////////
 	//
 	// MySQL::NewOrmConnT
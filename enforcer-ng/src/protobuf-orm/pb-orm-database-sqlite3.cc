@@ -38,6 +38,8 @@
 #include <map>
 #include <sqlite3.h>
 #include <cstdio>
+#include <ctype.h>
+#include <strings.h>
 
 #include "pb-orm-str.h"
 #include "pb-orm-log.h"
@@ -78,6 +80,7 @@ namespace DB {
 			std::map<std::string, int> fields;
 			
 			OrmResultImpl(sqlite3_stmt * stmt_);
+			OrmResultImpl(sqlite3_stmt * stmt_, bool *inuse_);
 			virtual ~OrmResultImpl();
 			
 			virtual bool assigned();
@@ -117,6 +120,11 @@ namespace DB {
 			
 		protected:
 			void check_and_report_errors();
+			
+		private:
+			// Set when stmt is owned by the prepared statement cache of the
+			// connection, the statement is then reset instead of finalized.
+			bool *_inuse;
 		};
 		
 	}
@@ -129,14 +137,24 @@ namespace DB {
 	///////////////////////////
 	
 	SQLite3::OrmResultImpl::OrmResultImpl(sqlite3_stmt * stmt_)
-	: stmt(stmt_)
+	: stmt(stmt_), _inuse(NULL)
+	{
+	}
+	
+	SQLite3::OrmResultImpl::OrmResultImpl(sqlite3_stmt * stmt_, bool *inuse_)
+	: stmt(stmt_), _inuse(inuse_)
 	{
 	}
 	
 	SQLite3::OrmResultImpl::~OrmResultImpl()
 	{
 		if (stmt) {
-			sqlite3_finalize(stmt);
+			if (_inuse) {
+				sqlite3_reset(stmt);
+				sqlite3_clear_bindings(stmt);
+				*_inuse = false;
+			} else
+				sqlite3_finalize(stmt);
 			stmt = NULL;
 		}
 	}
@@ -544,7 +562,16 @@ namespace DB {
 			
 			virtual OrmResultT query(const char *statement, int len);
 			
+			virtual bool is_prepared(const std::string &key);
+			virtual bool prepare(const std::string &key,
+								 const char *statement, int len);
+			virtual OrmResultT execute_prepared(const std::string &key,
+												const OrmParamsT &params);
+			virtual void clear_prepared();
+			
 			virtual bool table_exists(const std::string &name);
+			virtual bool index_exists(const std::string &table,
+									  const std::string &name);
 			virtual bool quote_string(const std::string &value, std::string &dest);
 			virtual bool quote_binary(const std::string &value, std::string &dest);
 			
@@ -555,11 +582,26 @@ namespace DB {
 			virtual OrmResultT CreateTableRelation(const std::string &name);
 			virtual OrmResultT CreateTableRepeatedValue(const std::string &name,
 														  const std::string &type);
+			virtual OrmResultT CreateIndex(const std::string &name,
+										   const std::string &table,
+										   const std::string &columns);
 			
 		protected:
 			std::map< std::string, std::string >_options;
 			std::map< std::string, int>_numoptions;
 			bool successful(int rv);
+			bool pragma(const char *name, const std::string &value,
+						std::string &result);
+			bool bind(sqlite3_stmt *stmt, const OrmParamsT &params);
+			
+			struct Statement {
+				sqlite3_stmt *stmt;
+				bool inuse;
+				unsigned long long used;
+			};
+			std::map< std::string, Statement >_statements;
+			unsigned long long _uses;
+			bool evict_prepared();
 		};
 
 	}
@@ -571,7 +613,7 @@ namespace DB {
 	//
 	///////////////////////////
 	
-	SQLite3::OrmConnT::OrmConnT() : db(NULL)
+	SQLite3::OrmConnT::OrmConnT() : db(NULL), _uses(0)
 	{
 		_numoptions["timeout_ms"] = 15000; // 15 seconds
 	}
@@ -611,12 +653,92 @@ namespace DB {
 			close();
 			return false;
 		}
+
+		// Apply the tuning pragmas that were set, leaving the SQLite
+		// defaults in place for the ones that were not.
+		std::string result;
+		if (_options.find("journal_mode") != _options.end()) {
+			if (!pragma("journal_mode", _options["journal_mode"], result)) {
+				close();
+				return false;
+			}
+			// The journal mode may be refused, e.g. WAL is not available
+			// for in-memory databases. That is not fatal, SQLite keeps
+			// using the journal mode it reported.
+			if (strcasecmp(result.c_str(),
+						   _options["journal_mode"].c_str()) != 0)
+				OrmLogError("SQLITE3: journal_mode %s requested but %s in use",
+							_options["journal_mode"].c_str(), result.c_str());
+		}
+		if (_options.find("synchronous") != _options.end()) {
+			if (!pragma("synchronous", _options["synchronous"], result)) {
+				close();
+				return false;
+			}
+		}
+		if (_numoptions.find("cache_size_kb") != _numoptions.end()) {
+			// a negative cache_size is interpreted as a size in KiB
+			std::string value;
+			OrmFormat(value, "-%d", _numoptions["cache_size_kb"]);
+			if (!pragma("cache_size", value, result)) {
+				close();
+				return false;
+			}
+		}
+		if (_numoptions.find("mmap_size_mb") != _numoptions.end()) {
+			std::string value;
+			OrmFormat(value, "%lld",
+					  (long long)_numoptions["mmap_size_mb"] * 1024 * 1024);
+			if (!pragma("mmap_size", value, result)) {
+				close();
+				return false;
+			}
+		}
 		
 		return true;
 	}
+
+	bool SQLite3::OrmConnT::pragma(const char *name,
+								   const std::string &value,
+								   std::string &result)
+	{
+		// Pragma values can't be bound as parameters, so only allow plain
+		// keywords and numbers to be pasted into the statement.
+		if (value.empty()) {
+			OrmLogError("SQLITE3: empty value for pragma %s", name);
+			return false;
+		}
+		for (std::string::size_type i=0; i<value.size(); ++i) {
+			if (!isalnum((unsigned char)value[i]) && value[i] != '-') {
+				OrmLogError("SQLITE3: invalid value \"%s\" for pragma %s",
+							value.c_str(), name);
+				return false;
+			}
+		}
+
+		std::string stmt;
+		OrmFormat(stmt, "PRAGMA %s=%s", name, value.c_str());
+		sqlite3_stmt *pstmt = NULL;
+		int rv = sqlite3_prepare_v2(db, stmt.c_str(), stmt.size(), &pstmt,
+									NULL);
+		if (!successful(rv))
+			return false;
+
+		// Some pragmas report the setting that is now in effect.
+		result.clear();
+		rv = sqlite3_step(pstmt);
+		if (rv == SQLITE_ROW) {
+			const unsigned char *text = sqlite3_column_text(pstmt, 0);
+			if (text)
+				result = (const char *)text;
+		}
+		sqlite3_finalize(pstmt);
+		return successful(rv);
+	}
 	
 	void SQLite3::OrmConnT::close()
 	{
+		clear_prepared();
 		if (db) {
 			sqlite3_close(db);
 			db = NULL;
@@ -677,6 +799,179 @@ namespace DB {
 	
 		return OrmResultT((OrmConn)this, new SQLite3::OrmResultImpl(stmt));
 	}
+
+	bool SQLite3::OrmConnT::is_prepared(const std::string &key)
+	{
+		return _statements.find(key) != _statements.end();
+	}
+
+	bool SQLite3::OrmConnT::prepare(const std::string &key,
+									const char *statement, int len)
+	{
+		sqlite3_stmt *stmt = NULL;
+
+		int rv = sqlite3_prepare_v2(db,
+									statement,
+									(len<0) ? (int)-1 : (int)len+1,
+									&stmt,
+									NULL);
+		if (!successful(rv)) {
+			if (stmt)
+				sqlite3_finalize(stmt);
+			return false;
+		}
+		
+		if (!stmt) {
+			OrmLogError("expected sqlite3_prepare_v2 to return a compiled "
+						"statement, got NULL, out of memory ?");
+			return false;
+		}
+
+		if (_statements.find(key) == _statements.end()
+			&& _statements.size() >= prepared_max
+			&& !evict_prepared())
+		{
+			sqlite3_finalize(stmt);
+			return false;
+		}
+
+		Statement &cached = _statements[key];
+		if (cached.stmt) {
+			if (cached.inuse) {
+				OrmLogError("SQLITE3: prepared statement %s still in use",
+							key.c_str());
+				sqlite3_finalize(stmt);
+				return false;
+			}
+			sqlite3_finalize(cached.stmt);
+		}
+		cached.stmt = stmt;
+		cached.inuse = false;
+		cached.used = ++_uses;
+		return true;
+	}
+
+	// Finalize the least recently used statement that is not referenced by
+	// a result.
+	bool SQLite3::OrmConnT::evict_prepared()
+	{
+		std::map< std::string, Statement >::iterator it, lru = _statements.end();
+		for (it = _statements.begin(); it != _statements.end(); ++it) {
+			if (it->second.inuse)
+				continue;
+			if (lru == _statements.end() || it->second.used < lru->second.used)
+				lru = it;
+		}
+		if (lru == _statements.end()) {
+			OrmLogError("SQLITE3: all %u prepared statements in use",
+						(unsigned)_statements.size());
+			return false;
+		}
+		sqlite3_finalize(lru->second.stmt);
+		_statements.erase(lru);
+		return true;
+	}
+
+	OrmResultT SQLite3::OrmConnT::execute_prepared(const std::string &key,
+												   const OrmParamsT &params)
+	{
+		std::map< std::string, Statement >::iterator it = _statements.find(key);
+		if (it == _statements.end()) {
+			OrmLogError("SQLITE3: no prepared statement for %s", key.c_str());
+			return OrmResultT();
+		}
+		
+		// The cached statement is still referenced by a result that is
+		// being iterated (e.g. while reading a recursive message). Leave it
+		// alone and run a private copy of the statement instead.
+		it->second.used = ++_uses;
+		sqlite3_stmt *stmt = it->second.stmt;
+		bool *inuse = &it->second.inuse;
+		if (*inuse) {
+			stmt = NULL;
+			int rv = sqlite3_prepare_v2(db, sqlite3_sql(it->second.stmt), -1,
+										&stmt, NULL);
+			if (!successful(rv) || !stmt) {
+				if (stmt)
+					sqlite3_finalize(stmt);
+				return OrmResultT();
+			}
+			inuse = NULL;
+		}
+		
+		if (!bind(stmt, params)) {
+			if (inuse)
+				sqlite3_clear_bindings(stmt);
+			else
+				sqlite3_finalize(stmt);
+			return OrmResultT();
+		}
+
+		int step = sqlite3_step(stmt);
+		if (!successful(step)) {
+			if (inuse) {
+				sqlite3_reset(stmt);
+				sqlite3_clear_bindings(stmt);
+			} else
+				sqlite3_finalize(stmt);
+			return OrmResultT();
+		}
+		
+		if (inuse)
+			*inuse = true;
+		return OrmResultT((OrmConn)this, new SQLite3::OrmResultImpl(stmt, inuse));
+	}
+
+	void SQLite3::OrmConnT::clear_prepared()
+	{
+		std::map< std::string, Statement >::iterator it;
+		for (it = _statements.begin(); it != _statements.end(); ++it) {
+			if (it->second.inuse)
+				OrmLogError("SQLITE3: prepared statement %s still in use",
+							it->first.c_str());
+			sqlite3_finalize(it->second.stmt);
+		}
+		_statements.clear();
+	}
+
+	bool SQLite3::OrmConnT::bind(sqlite3_stmt *stmt, const OrmParamsT &params)
+	{
+		if ((int)params.size() != sqlite3_bind_parameter_count(stmt)) {
+			OrmLogError("SQLITE3: expected %d parameters, got %d",
+						sqlite3_bind_parameter_count(stmt),
+						(int)params.size());
+			return false;
+		}
+		for (size_t i=0; i<params.size(); ++i) {
+			const OrmParamsT::Value &value = params[i];
+			int rv;
+			switch (value.type) {
+				case OrmParamsT::INTEGER:
+				case OrmParamsT::UNSIGNED:
+					rv = sqlite3_bind_int64(stmt, 1+i, value.integer);
+					break;
+				case OrmParamsT::REAL:
+					rv = sqlite3_bind_double(stmt, 1+i, value.real);
+					break;
+				case OrmParamsT::TEXT:
+					rv = sqlite3_bind_text(stmt, 1+i, value.str.data(),
+										   (int)value.str.size(),
+										   SQLITE_TRANSIENT);
+					break;
+				case OrmParamsT::BLOB:
+					rv = sqlite3_bind_blob(stmt, 1+i, value.str.data(),
+										   (int)value.str.size(),
+										   SQLITE_TRANSIENT);
+					break;
+				default:
+					rv = sqlite3_bind_null(stmt, 1+i);
+					break;
+			}
+			if (!successful(rv))
+				return false;
+		}
+		return true;
+	}
 		
 	bool SQLite3::OrmConnT::table_exists(const std::string &name)
 	{
@@ -689,6 +984,19 @@ namespace DB {
 			return false;
 	}
 	
+	bool SQLite3::OrmConnT::index_exists(const std::string &table,
+										 const std::string &name)
+	{
+		OrmResultT exists = queryf(
+			"SELECT name FROM sqlite_master WHERE type='index' AND "
+			"tbl_name='%s' AND name='%s';",
+			table.c_str(), name.c_str());
+		if (exists.assigned())
+			return exists->first_row();
+		else
+			return false;
+	}
+	
 	bool SQLite3::OrmConnT::quote_string(const std::string &value,
 										 std::string &dest)
 	{
@@ -769,6 +1077,16 @@ namespace DB {
 					  idfield());
 	}
 
+	OrmResultT SQLite3::OrmConnT::CreateIndex(const std::string &name,
+											  const std::string &table,
+											  const std::string &columns)
+	{
+		return queryf("CREATE INDEX IF NOT EXISTS %s ON %s (%s)",
+					  name.c_str(),
+					  table.c_str(),
+					  columns.c_str());
+	}
+
 	bool SQLite3::OrmConnT::successful(int rv)
 	{
 		if (rv == SQLITE_OK || rv == SQLITE_ROW || rv == SQLITE_DONE)
@@ -122,6 +122,56 @@ namespace DB {
 		return _impl && _impl->assigned();
 	}
 
+	///////////////////////////
+	//
+	// OrmParamsT
+	//
+	///////////////////////////
+
+	OrmParamsT::Value &OrmParamsT::add(Type type)
+	{
+		_values.push_back(Value());
+		Value &value = _values.back();
+		value.type = type;
+		value.integer = 0;
+		value.real = 0.0;
+		return value;
+	}
+
+	void OrmParamsT::add_null()
+	{
+		add(NULLVALUE);
+	}
+
+	void OrmParamsT::add_longlong(long long value)
+	{
+		add(INTEGER).integer = value;
+	}
+
+	void OrmParamsT::add_ulonglong(unsigned long long value)
+	{
+		add(UNSIGNED).integer = (long long)value;
+	}
+
+	void OrmParamsT::add_double(double value)
+	{
+		add(REAL).real = value;
+	}
+
+	void OrmParamsT::add_string(const std::string &value)
+	{
+		add(TEXT).str = value;
+	}
+
+	void OrmParamsT::add_binary(const std::string &value)
+	{
+		// encode empty value as a NULL, just like quote_binary does.
+		if (value.size() == 0)
+			add(NULLVALUE);
+		else
+			add(BLOB).str = value;
+	}
+
 	///////////////////////////
 	//
 	// OrmConnT
@@ -170,4 +220,46 @@ namespace DB {
 		return result;
 	}
 
+	OrmResultT OrmConnT::query_prepared(const std::string &key,
+										const OrmParamsT &params,
+										const char *format, ...)
+	{
+		if (is_prepared(key))
+			return execute_prepared(key, params);
+
+		// short form
+		char statement[128];
+		va_list args;
+		va_start(args, format);
+		int cneeded = vsnprintf(statement,sizeof(statement),format,args);
+		va_end(args);
+		if (cneeded<0) {
+			OrmLogError("vsnprintf error");
+			return OrmResultT();
+		}
+		if ((size_t)cneeded<sizeof(statement)) {
+			if (!prepare(key, statement, cneeded))
+				return OrmResultT();
+			return execute_prepared(key, params);
+		}
+		
+		// long form
+		char *pstatement = new char[cneeded+1];
+		if (!pstatement) {
+			OrmLogError("out of memory");
+			return OrmResultT();
+		}
+		va_start(args, format);
+		bool ok = vsnprintf(pstatement,cneeded+1,format,args)==cneeded;
+		va_end(args);
+		if (ok)
+			ok = prepare(key, pstatement, cneeded);
+		else
+			OrmLogError("vsnprintf error");
+		delete[] pstatement;
+		if (!ok)
+			return OrmResultT();
+		return execute_prepared(key, params);
+	}
+
 } // namespace DB
@@ -34,6 +34,8 @@
 
 #include "pb-orm-common.h"
 
+#include <vector>
+
 namespace DB {
 
 	class OrmResultImpl {
@@ -113,6 +115,34 @@ namespace DB {
 		OrmResultImpl *_impl;
 	};
 
+	// Values for the '?' placeholders in a prepared statement, bound in the
+	// order in which they were added.
+	class OrmParamsT {
+	public:
+		enum Type { NULLVALUE, INTEGER, UNSIGNED, REAL, TEXT, BLOB };
+		struct Value {
+			Type type;
+			long long integer;
+			double real;
+			std::string str;
+		};
+
+		void add_null();
+		void add_longlong(long long value);
+		void add_ulonglong(unsigned long long value);
+		void add_double(double value);
+		void add_string(const std::string &value);
+		void add_binary(const std::string &value);
+
+		size_t size() const { return _values.size(); }
+		const Value &operator[](size_t i) const { return _values[i]; }
+		void clear() { _values.clear(); }
+
+	private:
+		std::vector<Value> _values;
+		Value &add(Type type);
+	};
+
 	class OrmConnT {
 	public:
 		OrmConnT();
@@ -134,7 +164,26 @@ namespace DB {
 		virtual OrmResultT query(const char *statement, int len) = 0;
 		OrmResultT queryf(const char *format, ...);
 		
+		// Execute a statement with '?' placeholders bound to params. The
+		// compiled statement is cached in the connection under key, format is
+		// only expanded the first time key is used. So every call passing
+		// the same key must produce the same statement. At most
+		// prepared_max statements are kept, the least recently used one is
+		// dropped to make room for a new one.
+		OrmResultT query_prepared(const std::string &key,
+								  const OrmParamsT &params,
+								  const char *format, ...);
+		virtual bool is_prepared(const std::string &key) = 0;
+		virtual bool prepare(const std::string &key,
+							 const char *statement, int len) = 0;
+		virtual OrmResultT execute_prepared(const std::string &key,
+											const OrmParamsT &params) = 0;
+		virtual void clear_prepared() = 0;
+		static const size_t prepared_max = 256;
+		
 		virtual bool table_exists(const std::string &name) = 0;
+		virtual bool index_exists(const std::string &table,
+								  const std::string &name) = 0;
 		virtual bool quote_string(const std::string &value, std::string &dest) = 0;
 		virtual bool quote_binary(const std::string &value, std::string &dest) = 0;
 
@@ -145,6 +194,9 @@ namespace DB {
 		virtual OrmResultT CreateTableRelation(const std::string &name) = 0;
 		virtual OrmResultT CreateTableRepeatedValue(const std::string &name,
 													const std::string &type) = 0;
+		virtual OrmResultT CreateIndex(const std::string &name,
+									   const std::string &table,
+									   const std::string &columns) = 0;
 	private:
 		// disable evil constructors
 		OrmConnT(const OrmConnT&);
@@ -42,9 +42,62 @@
 #include <stdio.h> 
 #include <stdarg.h>
 
+static bool
+pb_message_delete_fields(OrmConn conn,
+						 const pb::Descriptor *descriptor,
+						 pb::uint64 id)
+{
+	// Go through all fields stored in separate tables and cascade delete them
+	for (int f=0; f<descriptor->field_count(); ++f) {
+		const pb::FieldDescriptor *field = descriptor->field(f);
+		if (field->is_repeated()) {
+			if (!OrmFieldDeleteAllRepeatedValues(conn,id,field))
+				return false;
+		} else {
+			if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
+				if (!OrmFieldDeleteMessage(conn, id, field))
+					return false;
+			} else {
+				// nothing to do for a singular non message field
+				// as it will be deleted along with the message.
+			}
+		}
+	}
+	return true;
+}
+
 bool OrmMessageDelete(OrmConn conn,const pb::Descriptor *descriptor,pb::uint64 id)
 {
-	return OrmMessageDeleteWhere(conn,descriptor,"id=%llu",id);
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+	DB::OrmResultT r( CONN->query_prepared(descriptor->full_name()+":find",
+										   params,
+										   "SELECT id FROM %s WHERE id=?",
+										   descriptor->name().c_str()) );
+	if (!r.assigned()) {
+		OrmLogError("expected to be able to select from table: %s",
+					descriptor->name().c_str());
+		return false;
+	}
+	
+	// Nothing to cascade or delete when the message isn't there.
+	if (!r->first_row())
+		return true;
+	r = DB::OrmResultT();
+
+	if (!pb_message_delete_fields(conn, descriptor, id))
+		return false;
+
+	DB::OrmResultT result( CONN->query_prepared(descriptor->full_name()+":delete",
+												params,
+												"DELETE FROM %s WHERE id=?",
+												descriptor->name().c_str()) );
+	if (!result.assigned()) {
+		OrmLogError("failed to delete message with id: %llu from table: %s",
+					id, descriptor->name().c_str());
+		return false;
+	}
+	return true;
 }
 
 bool OrmMessageDeleteWhere(OrmConn conn,
@@ -82,22 +135,8 @@ bool OrmMessageDeleteWhere(OrmConn conn,
 			return false;
 		}
 		
-		// Go through all fields stored in separate tables and cascade delete them
-		for (int f=0; f<descriptor->field_count(); ++f) {
-			const pb::FieldDescriptor *field = descriptor->field(f);
-			if (field->is_repeated()) {
-				if (!OrmFieldDeleteAllRepeatedValues(conn,id,field))
-					return false;
-			} else {
-				if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
-					if (!OrmFieldDeleteMessage(conn, id, field))
-						return false;
-				} else {
-					// nothing to do for a singular non message field
-					// as it will be deleted along with the message.
-				}
-			}
-		}
+		if (!pb_message_delete_fields(conn, descriptor, id))
+			return false;
 	}
 
 	// Delete the actual messages in one go.
@@ -145,15 +184,18 @@ bool OrmFieldDeleteAllRepeatedValues(OrmConn conn,
 		return false;
 	}
 
+	std::string table = field->containing_type()->name() + "_" + field->name();
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+
 	if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
-		std::string fld = field->containing_type()->name() + "_" + field->name();
-		
-		DB::OrmResultT result( CONN->queryf("SELECT child_id FROM %s WHERE parent_id=%llu",
-											fld.c_str(),
-											id) );
+		DB::OrmResultT result( CONN->query_prepared(field->full_name()+":children",
+													params,
+													"SELECT child_id FROM %s WHERE parent_id=?",
+													table.c_str()) );
 		if (!result.assigned()) {
 			OrmLogError("failed select child ids with parent_id: %llu from table: %s",
-					  id,fld.c_str());
+					  id,table.c_str());
 			return false;
 		}
 		for (bool ok=result->first_row(); ok ;ok=result->next_row()) {
@@ -174,10 +216,10 @@ bool OrmFieldDeleteAllRepeatedValues(OrmConn conn,
 		}
 	}
 	
-	std::string table = field->containing_type()->name() + "_" + field->name();
-	DB::OrmResultT result( CONN->queryf("DELETE FROM %s WHERE parent_id=%llu",
-										table.c_str(),
-										id) );
+	DB::OrmResultT result( CONN->query_prepared(field->full_name()+":deleteall",
+												params,
+												"DELETE FROM %s WHERE parent_id=?",
+												table.c_str()) );
 	if (!result.assigned()) {
 		OrmLogError("failed to delete all records with parent_id: %llu from table: %s",
 				  id,
@@ -200,16 +242,20 @@ bool OrmFieldDeleteRepeatedValue(OrmConn conn,
 
 	// Also delete the referenced message
 	DB::OrmResultT result;
+	DB::OrmParamsT params;
+	params.add_ulonglong(fieldid);
 	if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
 		if (!OrmMessageDelete(conn, field->message_type(), fieldid))
 			return false;
-		result = CONN->queryf("DELETE FROM %s WHERE child_id=%llu",
-							  table.c_str(),
-							  fieldid);
+		result = CONN->query_prepared(field->full_name()+":delete",
+									  params,
+									  "DELETE FROM %s WHERE child_id=?",
+									  table.c_str());
 	} else {
-		result = CONN->queryf("DELETE FROM %s WHERE id=%llu",
-							  table.c_str(),
-							  fieldid);
+		result = CONN->query_prepared(field->full_name()+":delete",
+									  params,
+									  "DELETE FROM %s WHERE id=?",
+									  table.c_str());
 	}
 	if (!result.assigned()) {
 		OrmLogError("failed to delete record with child_id: %llu from table: %s",
@@ -48,9 +48,12 @@ bool OrmMessageFind(OrmConn conn,
 					const pb::Descriptor *descriptor,
 					pb::uint64 id)
 {
-	DB::OrmResultT r( CONN->queryf("SELECT id FROM %s WHERE id=%llu",
-								   descriptor->name().c_str(),
-								   id) );
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+	DB::OrmResultT r( CONN->query_prepared(descriptor->full_name()+":find",
+										   params,
+										   "SELECT id FROM %s WHERE id=?",
+										   descriptor->name().c_str()) );
 	if (!r.assigned()) {
 		OrmLogError("failed select from table: %s",descriptor->name().c_str());
 		return false;
@@ -64,9 +67,12 @@ bool OrmMessageSelect(OrmConn conn,
 					  pb::uint64 id,
 					  OrmResult &result)
 {
-	DB::OrmResultT r( CONN->queryf("SELECT * FROM %s WHERE id=%llu",
-							   descriptor->name().c_str(),
-							   id) );
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+	DB::OrmResultT r( CONN->query_prepared(descriptor->full_name()+":select",
+										   params,
+										   "SELECT * FROM %s WHERE id=?",
+										   descriptor->name().c_str()) );
 	if (!r.assigned()) {
 		OrmLogError("failed select from table: %s",descriptor->name().c_str());
 		return false;
@@ -220,10 +226,13 @@ bool OrmFieldSelectMessage(OrmConn conn,
 	pb_field_name(field,field_name);
 
 	// Single field; containing table stores id for the field's message table
-	DB::OrmResultT r( CONN->queryf("SELECT %s FROM %s WHERE id=%llu",
-							   field_name.c_str(),
-							   field->containing_type()->name().c_str(),
-							   id) );
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
+	DB::OrmResultT r( CONN->query_prepared(field->full_name()+":select",
+										   params,
+										   "SELECT %s FROM %s WHERE id=?",
+										   field_name.c_str(),
+										   field->containing_type()->name().c_str()) );
 	if (!r.assigned()) {
 		OrmLogError("expected to be able to select a message");
 		return false;
@@ -244,9 +253,12 @@ bool OrmFieldSelectMessage(OrmConn conn,
 	if (fieldid==0)
 		return false;
 	
-	r = CONN->queryf("SELECT * FROM %s WHERE id=%llu",
-					 field->message_type()->name().c_str(),
-					 fieldid);
+	params.clear();
+	params.add_ulonglong(fieldid);
+	r = CONN->query_prepared(field->message_type()->full_name()+":select",
+							 params,
+							 "SELECT * FROM %s WHERE id=?",
+							 field->message_type()->name().c_str());
 	if (!r.assigned()) {
 		OrmLogError("expected to be able to select message");
 		return false;
@@ -273,23 +285,28 @@ bool OrmFieldEnumAllRepeatedValues(OrmConn conn,
 	std::string fld = field->containing_type()->name() + "_" + field->name();
 	
 	DB::OrmResultT r;
+	DB::OrmParamsT params;
+	params.add_ulonglong(id);
 	if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE) {
 		std::string msg = field->message_type()->name();
 		// Repeated field; containing table id is stored in child table as parent_id
 		// We need to join the table for the field relation with the table for the
 		// field value message type.
-		r = CONN->queryf("SELECT msg.*"
-						 " FROM %s msg INNER JOIN %s fld ON msg.id=fld.child_id"
-						 " WHERE fld.parent_id=%llu",
-						 msg.c_str(),
-						 fld.c_str(),id);
+		r = CONN->query_prepared(field->full_name()+":enum",
+								 params,
+								 "SELECT msg.*"
+								 " FROM %s msg INNER JOIN %s fld ON msg.id=fld.child_id"
+								 " WHERE fld.parent_id=?",
+								 msg.c_str(),
+								 fld.c_str());
 	} else {
 		// Repeated field; containing table id is stored in child table as parent_id
-		r = CONN->queryf("SELECT fld.*"
-						 " FROM %s fld"
-						 " WHERE fld.parent_id=%llu",
-						 fld.c_str(),
-						 id);
+		r = CONN->query_prepared(field->full_name()+":enum",
+								 params,
+								 "SELECT fld.*"
+								 " FROM %s fld"
+								 " WHERE fld.parent_id=?",
+								 fld.c_str());
 	}
 	if (!r.assigned()) {
 		OrmLogError("expected to be able to enumerate values");
@@ -32,10 +32,15 @@
 #include "pb-orm-read.h"
 #include "pb-orm-enum.h"
 #include "pb-orm-log.h"
+#include "pb-orm-str.h"
+#include "pb-orm-value.h"
 #include "pb-orm-database.h"
 #include "pb-orm-context.h"
 #include "orm.pb.h"
 
+// Maximum number of ids in the IN (...) list of a single bulk query.
+#define ORM_BULK_IDS 500
+
 
 static bool
 pb_reflection_set_datetime(const pb::Reflection *reflection,
@@ -659,6 +664,8 @@ bool OrmGetMessage(OrmResult result,
 	ctx->conn = RESULT.conn;
 	ctx->message = &message;
 	if (OrmGetId(result, ctx->id) && _OrmGetMessage(result, message, recurse, ctx)) {
+		// Without a snapshot the update simply writes all values.
+		ctx->snapshot();
 		context = (OrmContext)ctx;
 		return true;
 	}
@@ -668,6 +675,329 @@ bool OrmGetMessage(OrmResult result,
 	return false;
 }
 
+void OrmMessageList::add(pb::Message *message, OrmContext context)
+{
+	_messages.push_back(message);
+	if (context) {
+		_contexts.resize(_messages.size(), NULL);
+		_contexts.back() = context;
+	}
+}
+
+void OrmMessageList::clear()
+{
+	for (size_t i=0; i<_contexts.size(); ++i) {
+		if (_contexts[i])
+			OrmFreeContext(_contexts[i]);
+	}
+	_contexts.clear();
+	for (size_t i=0; i<_messages.size(); ++i)
+		delete _messages[i];
+	_messages.clear();
+}
+
+// A message read by the bulk loader whose aggregated messages and repeated
+// fields still need to be loaded.
+struct OrmBulkNode {
+	pb::Message *message;
+	pb::uint64 id;
+	OrmContextT *context;
+};
+
+// For every field of a message type, the ids of the aggregated messages
+// mapped to the index of the node that references them.
+typedef std::vector< std::multimap<pb::uint64,size_t> > OrmBulkPending;
+
+static OrmContextT *
+pb_bulk_context(OrmContextT *context, pb::Message *message)
+{
+	if (!context)
+		return NULL;
+	OrmContextT *fcontext = new OrmContextT;
+	if (!fcontext) {
+		OrmLogError("unable to allocate OrmContext");
+		return NULL;
+	}
+	fcontext->conn = context->conn;
+	fcontext->message = message;
+	return fcontext;
+}
+
+// Assign the fields stored in the current row to message, but only note the
+// ids of aggregated messages in pending so they can be loaded in bulk.
+static bool
+pb_bulk_get_row(OrmResult result,
+				pb::Message &message,
+				OrmContextT *context,
+				OrmBulkPending &pending,
+				std::vector<OrmBulkNode> &nodes)
+{
+	OrmBulkNode node;
+	node.message = &message;
+	node.context = context;
+	if (!OrmGetId(result, node.id))
+		return false;
+	if (context)
+		context->id = node.id;
+
+	const pb::Descriptor *descriptor = message.GetDescriptor();
+	for (int f=0; f<descriptor->field_count(); ++f) {
+		const pb::FieldDescriptor *field = descriptor->field(f);
+		if (field->is_repeated())
+			continue;
+		if (field->type() != pb::FieldDescriptor::TYPE_MESSAGE) {
+			if (!pb_assign_field(result, message, field, false, context))
+				return false;
+			continue;
+		}
+		
+		std::string name;
+		pb_field_name(field, name);
+		unsigned int field_idx = RESULT->get_field_idx(name);
+		if (field_idx==0)
+			return false;
+		if (RESULT->field_is_null_idx(field_idx)) {
+			message.GetReflection()->ClearField(&message, field);
+			continue;
+		}
+		pb::uint64 fieldid = RESULT->get_ulonglong_idx(field_idx);
+		if (RESULT->failed())
+			return false;
+		if (fieldid != 0)
+			pending[f].insert(std::make_pair(fieldid, nodes.size()));
+	}
+	nodes.push_back(node);
+	return true;
+}
+
+// Split the distinct ids into comma separated lists for IN (...) clauses.
+static void
+pb_bulk_id_lists(const std::multimap<pb::uint64,size_t> &ids,
+				 std::vector<std::string> &lists)
+{
+	int count = ORM_BULK_IDS;
+	std::multimap<pb::uint64,size_t>::const_iterator it;
+	for (it=ids.begin(); it!=ids.end(); it=ids.upper_bound(it->first)) {
+		if (count == ORM_BULK_IDS) {
+			lists.push_back(std::string());
+			count = 0;
+		}
+		std::string id;
+		pb_field_uint64_value(it->first, id);
+		OrmChain(lists.back(), id, ',');
+		++count;
+	}
+}
+
+static bool
+pb_bulk_load_fields(OrmConn conn,
+					const pb::Descriptor *descriptor,
+					std::vector<OrmBulkNode> &nodes,
+					OrmBulkPending &pending,
+					bool recurse);
+
+static bool
+pb_bulk_load_message(OrmConn conn,
+					 std::vector<OrmBulkNode> &nodes,
+					 const pb::FieldDescriptor *field,
+					 const std::multimap<pb::uint64,size_t> &ids,
+					 bool recurse)
+{
+	const pb::Descriptor *fdescriptor = field->message_type();
+	std::vector<OrmBulkNode> children;
+	OrmBulkPending childpending(fdescriptor->field_count());
+	
+	std::vector<std::string> lists;
+	pb_bulk_id_lists(ids, lists);
+	for (size_t l=0; l<lists.size(); ++l) {
+		OrmResult result;
+		if (!OrmConnQuery(conn,
+						  "SELECT * FROM " + fdescriptor->name() +
+						  " WHERE id IN (" + lists[l] + ")",
+						  result)) {
+			OrmLogError("failed select from table: %s",
+						fdescriptor->name().c_str());
+			return false;
+		}
+		bool ok = true;
+		for (bool row=OrmFirst(result); ok && row; row=OrmNext(result)) {
+			pb::uint64 id;
+			ok = OrmGetId(result, id);
+			std::multimap<pb::uint64,size_t>::const_iterator it;
+			for (it=ids.lower_bound(id); ok && it!=ids.upper_bound(id); ++it) {
+				OrmBulkNode &parent = nodes[it->second];
+				pb::Message *value = parent.message->GetReflection()->
+					MutableMessage(parent.message, field);
+				OrmContextT *fcontext = pb_bulk_context(parent.context, value);
+				if (fcontext)
+					parent.context->fields[field->number()][(pb::uint64)value] =
+						(OrmContext)fcontext;
+				ok = pb_bulk_get_row(result, *value, fcontext, childpending,
+									 children);
+			}
+		}
+		OrmFreeResult(result);
+		if (!ok)
+			return false;
+	}
+	return pb_bulk_load_fields(conn, fdescriptor, children, childpending,
+							   recurse);
+}
+
+static bool
+pb_bulk_load_repeated(OrmConn conn,
+					  std::vector<OrmBulkNode> &nodes,
+					  const std::multimap<pb::uint64,size_t> &parents,
+					  const pb::FieldDescriptor *field,
+					  bool recurse)
+{
+	std::string fld = field->containing_type()->name() + "_" + field->name();
+	bool ismessage = field->type() == pb::FieldDescriptor::TYPE_MESSAGE;
+	const pb::Descriptor *fdescriptor = ismessage ? field->message_type() : NULL;
+	std::vector<OrmBulkNode> children;
+	OrmBulkPending childpending(ismessage ? fdescriptor->field_count() : 0);
+
+	std::vector<std::string> lists;
+	pb_bulk_id_lists(parents, lists);
+	for (size_t l=0; l<lists.size(); ++l) {
+		// Rows are ordered per parent in the order the per message queries
+		// would return them.
+		std::string statement;
+		if (ismessage)
+			statement = "SELECT fld.parent_id AS orm_parent_id,msg.*"
+				" FROM " + fdescriptor->name() + " msg"
+				" INNER JOIN " + fld + " fld ON msg.id=fld.child_id"
+				" WHERE fld.parent_id IN (" + lists[l] + ")"
+				" ORDER BY fld.parent_id,fld.child_id";
+		else
+			statement = "SELECT fld.*,fld.parent_id AS orm_parent_id"
+				" FROM " + fld + " fld"
+				" WHERE fld.parent_id IN (" + lists[l] + ")"
+				" ORDER BY fld.parent_id,fld.id";
+		OrmResult result;
+		if (!OrmConnQuery(conn, statement, result)) {
+			OrmLogError("expected to be able to enumerate values");
+			return false;
+		}
+		bool ok = true;
+		for (bool row=OrmFirst(result); ok && row; row=OrmNext(result)) {
+			pb::uint64 parentid = RESULT->get_ulonglong("orm_parent_id");
+			if (RESULT->failed()) {
+				ok = false;
+				break;
+			}
+			std::multimap<pb::uint64,size_t>::const_iterator it;
+			for (it=parents.lower_bound(parentid);
+				 ok && it!=parents.upper_bound(parentid); ++it)
+			{
+				OrmBulkNode &parent = nodes[it->second];
+				if (!ismessage) {
+					ok = pb_add_repeated_field(result, *parent.message, field,
+											   parent.context);
+					continue;
+				}
+				pb::Message *value = parent.message->GetReflection()->
+					AddMessage(parent.message, field);
+				if (!value) {
+					OrmLogError("Reflection::AddMessage(field) returned NULL");
+					ok = false;
+					break;
+				}
+				OrmContextT *fcontext = pb_bulk_context(parent.context, value);
+				if (fcontext)
+					parent.context->fields[field->number()][(pb::uint64)value] =
+						(OrmContext)fcontext;
+				ok = pb_bulk_get_row(result, *value, fcontext, childpending,
+									 children);
+			}
+		}
+		OrmFreeResult(result);
+		if (!ok)
+			return false;
+	}
+	if (!ismessage)
+		return true;
+	return pb_bulk_load_fields(conn, fdescriptor, children, childpending,
+							   recurse);
+}
+
+// Load the aggregated messages and repeated fields of nodes, which all have
+// the same descriptor, one level at a time.
+static bool
+pb_bulk_load_fields(OrmConn conn,
+					const pb::Descriptor *descriptor,
+					std::vector<OrmBulkNode> &nodes,
+					OrmBulkPending &pending,
+					bool recurse)
+{
+	if (nodes.size() == 0)
+		return true;
+	
+	std::multimap<pb::uint64,size_t> parents;
+	for (size_t n=0; n<nodes.size(); ++n)
+		parents.insert(std::make_pair(nodes[n].id, n));
+
+	for (int f=0; f<descriptor->field_count(); ++f) {
+		const pb::FieldDescriptor *field = descriptor->field(f);
+		if (field->is_repeated()) {
+			if (recurse && !pb_bulk_load_repeated(conn, nodes, parents, field,
+												  recurse))
+				return false;
+		} else if (pending[f].size()) {
+			if (!pb_bulk_load_message(conn, nodes, field, pending[f], recurse))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool OrmGetMessages(OrmResult result,
+					const pb::Message &prototype,
+					bool recurse,
+					size_t max,
+					OrmMessageList &messages,
+					bool context,
+					bool &next)
+{
+	next = false;
+	if (result==NULL || !RESULT.assigned())
+		return false;
+
+	const pb::Descriptor *descriptor = prototype.GetDescriptor();
+	std::vector<OrmBulkNode> nodes;
+	std::vector<OrmContextT *> contexts;
+	OrmBulkPending pending(descriptor->field_count());
+	next = true;
+	for (size_t count=0; next && (max==0 || count<max); ++count) {
+		pb::Message *message = prototype.New();
+		OrmContextT *ctx = NULL;
+		if (context) {
+			ctx = new OrmContextT;
+			if (!ctx) {
+				OrmLogError("unable to allocate OrmContext");
+				delete message;
+				return false;
+			}
+			ctx->conn = RESULT.conn;
+			ctx->message = message;
+			contexts.push_back(ctx);
+		}
+		messages.add(message, (OrmContext)ctx);
+		if (!pb_bulk_get_row(result, *message, ctx, pending, nodes))
+			return false;
+		next = OrmNext(result);
+	}
+	if (!pb_bulk_load_fields(RESULT.conn, descriptor, nodes, pending,
+							 recurse))
+		return false;
+
+	// The messages are complete now, record what was read so updates only
+	// need to write the changes.
+	for (size_t i=0; i<contexts.size(); ++i)
+		contexts[i]->snapshot();
+	return true;
+}
+
 bool OrmGetEnum(OrmResult result, std::string &value)
 {
 	if (result==NULL || !RESULT.assigned())
@@ -34,6 +34,8 @@
 
 #include "pb-orm-common.h"
 
+#include <vector>
+
 
 // Read a message for reading only. 
 bool OrmMessageRead(OrmConn conn,
@@ -74,6 +76,53 @@ bool OrmGetMessage(OrmResult result,
 				   pb::Message &value,
 				   bool recurse,
 				   OrmContext &context);
+// Messages read by OrmGetMessages, together with the contexts for updating
+// them when those were requested. The list owns both.
+class OrmMessageList {
+public:
+	OrmMessageList() {
+	}
+	~OrmMessageList() {
+		clear();
+	}
+	size_t size() const {
+		return _messages.size();
+	}
+	pb::Message &message(size_t i) {
+		return *_messages[i];
+	}
+	template <class T> T &message(size_t i) {
+		return *static_cast<T*>(_messages[i]);
+	}
+	OrmContext context(size_t i) {
+		return i < _contexts.size() ? _contexts[i] : NULL;
+	}
+	void add(pb::Message *message, OrmContext context);
+	void clear();
+protected:
+	std::vector<pb::Message*> _messages;
+	std::vector<OrmContext> _contexts;
+private:
+	// disable evil contructors
+	OrmMessageList(const OrmMessageList&);
+	void operator=(const OrmMessageList&);
+};
+
+// Read the message in the current row of result and the rows following it
+// until max messages were read (0 for no limit) into messages. Afterwards
+// next tells whether result is positioned on a row that was not read yet.
+// Aggregated messages and, when recurse is true, repeated fields are
+// loaded for all messages together with one query per field instead of
+// one per field per message. Set context to also create the contexts that
+// are needed for updating the messages with OrmMessageUpdate.
+bool OrmGetMessages(OrmResult result,
+					const pb::Message &prototype,
+					bool recurse,
+					size_t max,
+					OrmMessageList &messages,
+					bool context,
+					bool &next);
+
 bool OrmGetEnum(OrmResult result, std::string &value);
 bool OrmGetDateTime(OrmResult result, time_t &value);
 bool OrmGetDate(OrmResult result, time_t &value);
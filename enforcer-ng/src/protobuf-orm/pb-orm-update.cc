@@ -119,10 +119,20 @@ pb_field_update_repeated_value(OrmContextT *context,
 		int fieldsize = (db_fieldsize < pb_fieldsize ? db_fieldsize : pb_fieldsize);
 
 		// update first fieldsize number of fields in the db from message field values
+		// skipping the values that are unchanged since they were read.
+		std::string snapshot;
 		for (int i=0; i<fieldsize; ++i) {
 			OrmContextT *fcontext = (OrmContextT*)fc[i];
+			if (fcontext->snapshot_valid) {
+				if (!pb_field_snapshot_value(context->message, field, i, snapshot))
+					return false;
+				if (snapshot == fcontext->value)
+					continue;
+			}
 			if (!OrmFieldSetRepeatedValue(context->conn, context->id, *context->message, field, i, fcontext->id))
 				return false;
+			if (fcontext->snapshot_valid)
+				fcontext->value = snapshot;
 		}
 		
 		if (db_fieldsize < pb_fieldsize) {
@@ -150,7 +160,9 @@ pb_field_update_repeated_value(OrmContextT *context,
 static bool
 pb_field_update_value(OrmContextT *context,
 					  const pb::FieldDescriptor *field,
-					  std::string &assignments)
+					  std::string &assignments,
+					  DB::OrmParamsT &params,
+					  std::map<int, std::string> &changed)
 {
 	const pb::Reflection *reflection = context->message->GetReflection();
 
@@ -181,7 +193,6 @@ pb_field_update_value(OrmContextT *context,
 	std::string name;
 	pb_field_name(field,name);
 	
-	std::string value;
 	if (type == pb::FieldDescriptor::TYPE_MESSAGE) {
 		// Handle MESSAGE value
 		
@@ -222,7 +233,7 @@ pb_field_update_value(OrmContextT *context,
 				// Field is not present in message => Delete existing.
 				if (!OrmMessageDelete(context->conn,field->message_type(),fieldid))
 					return false; // Failed to delete aggregated message, don't continue.
-				value = "NULL";
+				params.add_null();
 			}
 		} else {
 			// The field is currently not present in the table
@@ -234,8 +245,7 @@ pb_field_update_value(OrmContextT *context,
 				if (!OrmMessageInsert(context->conn, reflection->GetMessage(*context->message, field), fieldid))
 					return false;
 				
-				if (!pb_field_uint64_value(fieldid, value))
-					return false;
+				params.add_ulonglong(fieldid);
 				
 			} else {
 				// Field is not present in message => nothing to do
@@ -243,11 +253,20 @@ pb_field_update_value(OrmContextT *context,
 			}
 		}
 	} else {
-		// Handle other types of values.
-		if (!pb_field_value(context->conn,context->message,field,value))
+		// Handle other types of values, leaving out the ones that are
+		// unchanged since the message was read.
+		if (context->snapshot_valid) {
+			std::string snapshot;
+			if (!pb_field_snapshot_value(context->message, field, -1, snapshot))
+				return false;
+			if (snapshot == context->values[field->number()])
+				return true;
+			changed[field->number()] = snapshot;
+		}
+		if (!pb_field_param(context->conn,context->message,field,params))
 			return false;
 	}
-	OrmChain(assignments,name + "=" + value,',');
+	OrmChain(assignments,name + "=?",',');
 	return true;
 }
 
@@ -271,6 +290,8 @@ bool OrmMessageUpdate(OrmContext context)
 	// For values stored in the table associated with the current message create
 	// a string with assignments.
 	std::string assignments;
+	DB::OrmParamsT params;
+	std::map<int, std::string> changed;
 	const pb::Descriptor *descriptor = ctx->message->GetDescriptor();
 	for (int f=0; f<descriptor->field_count(); ++f) {
 		const pb::FieldDescriptor*field = descriptor->field(f);
@@ -278,7 +299,7 @@ bool OrmMessageUpdate(OrmContext context)
 			if (!pb_field_update_repeated_value(ctx,field))
 				return false;
 		} else {
-			if (!pb_field_update_value(ctx,field,assignments))
+			if (!pb_field_update_value(ctx,field,assignments,params,changed))
 				return false;
 		}
 	}
@@ -286,12 +307,22 @@ bool OrmMessageUpdate(OrmContext context)
 	if (assignments.size() > 0) {
 		OrmConn conn = ctx->conn;
 		
-		DB::OrmResultT result( CONN->queryf("UPDATE %s SET %s WHERE id=%llu",
-										ctx->message->GetDescriptor()->name().c_str(),
-										assignments.c_str(),
-										ctx->id) );
+		// Assignments for unchanged aggregated messages and unchanged values
+		// are left out, so the columns are part of the key for the prepared
+		// statement.
+		params.add_ulonglong(ctx->id);
+		DB::OrmResultT result( CONN->query_prepared(descriptor->full_name()+":update:"+assignments,
+													params,
+													"UPDATE %s SET %s WHERE id=?",
+													descriptor->name().c_str(),
+													assignments.c_str()) );
 		if (!result.assigned())
 			return false;
+
+		// The db now holds the new values.
+		std::map<int, std::string>::iterator it;
+		for (it=changed.begin(); it!=changed.end(); ++it)
+			ctx->values[it->first] = it->second;
 	}
 	return true;
 }
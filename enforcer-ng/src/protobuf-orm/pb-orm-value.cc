@@ -166,6 +166,121 @@ bool pb_field_value(OrmConn conn,
 	return false;
 }
 
+static bool
+pb_time_param(time_t value, const char *format, DB::OrmParamsT &params)
+{
+	char timestr[32];
+	struct tm timestruct;
+	if (value==-1)
+		return false;
+	if (!gmtime_r(&value, &timestruct)) {
+		OrmLogError("cannot convert time_t value %ld to UTC", (long)value);
+		return false;
+	}
+	strftime(timestr, sizeof(timestr), format, &timestruct);
+	params.add_string(timestr);
+	return true;
+}
+
+bool pb_field_param(OrmConn conn,
+					const pb::Message *message,
+					const pb::FieldDescriptor *field,
+					DB::OrmParamsT &params)
+{
+	const pb::Reflection *reflection = message->GetReflection();
+	
+	// A type that is not present should be represented by NULL
+	if (!reflection->HasField(*message, field)) {
+		params.add_null();
+		return true;
+	}
+	
+	orm::Column	column;
+	if (field->options().HasExtension(orm::column)) {
+		column = field->options().GetExtension(orm::column);
+	}
+	if (column.has_type()) {
+		switch (column.type()) {
+			case orm::DATETIME: {
+				time_t value = pb_reflection_get_time(reflection, *message, field);
+				return pb_time_param(value, "%Y-%m-%d %H:%M:%S", params);
+			}
+			case orm::DATE: {
+				time_t value = pb_reflection_get_time(reflection, *message, field);
+				return pb_time_param(value, "%Y-%m-%d", params);
+			}
+			case orm::TIME: {
+				time_t value = pb_reflection_get_time(reflection, *message, field);
+				return pb_time_param(value, "%H:%M:%S", params);
+			}
+			case orm::YEAR: {
+				break;
+			}
+			default:
+				OrmLogError("unknown ormoption.type");
+				return false;
+		}
+	}
+	
+	switch (field->type()) {
+		case pb::FieldDescriptor::TYPE_BOOL:
+			params.add_longlong(reflection->GetBool(*message, field) ? 1 : 0);
+			return true;
+		case pb::FieldDescriptor::TYPE_FLOAT:
+			params.add_double(reflection->GetFloat(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_DOUBLE:
+			params.add_double(reflection->GetDouble(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_INT32:
+		case pb::FieldDescriptor::TYPE_SFIXED32:
+		case pb::FieldDescriptor::TYPE_SINT32:
+			params.add_longlong(reflection->GetInt32(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_INT64:
+		case pb::FieldDescriptor::TYPE_SFIXED64:
+		case pb::FieldDescriptor::TYPE_SINT64:
+			params.add_longlong(reflection->GetInt64(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_UINT32:
+		case pb::FieldDescriptor::TYPE_FIXED32:
+			params.add_longlong(reflection->GetUInt32(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_UINT64:
+		case pb::FieldDescriptor::TYPE_FIXED64:
+			params.add_ulonglong(reflection->GetUInt64(*message,field));
+			return true;
+		case pb::FieldDescriptor::TYPE_STRING: {
+			std::string str;
+			const std::string &strref = reflection->GetStringReference(*message,
+																	   field,
+																	   &str);
+			params.add_string(strref);
+			return true;
+		}
+		case pb::FieldDescriptor::TYPE_GROUP:
+			OrmLogError("cannot create parameter for TYPE_GROUP");
+			return false;
+		case pb::FieldDescriptor::TYPE_MESSAGE:
+			OrmLogError("cannot create parameter for TYPE_MESSAGE");
+			return false;
+		case pb::FieldDescriptor::TYPE_BYTES: {
+			std::string bin;
+			const std::string &binref = reflection->GetStringReference(*message,
+																	   field,
+																	   &bin);
+			params.add_binary(binref);
+			return true;
+		}
+			
+		case pb::FieldDescriptor::TYPE_ENUM:
+			params.add_string(reflection->GetEnum(*message,field)->name());
+			return true;
+	}
+	OrmLogError("ERROR: UNKNOWN FIELD TYPE");
+	return false;
+}
+
 bool pb_field_bool_value(bool value,
 						 std::string &dest)
 {
@@ -385,3 +500,79 @@ pb_field_repeated_value(OrmConn conn,
 	OrmLogError("ERROR: UNKNOWN FIELD TYPE");
 	return false;
 }
+
+bool pb_field_snapshot_value(const pb::Message *message,
+							 const pb::FieldDescriptor *field,
+							 int index,
+							 std::string &dest)
+{
+	const pb::Reflection *reflection = message->GetReflection();
+	
+	// Values that are not present are stored as NULL, keep them apart from
+	// a present value that happens to be empty.
+	if (index < 0 && !reflection->HasField(*message, field)) {
+		dest.clear();
+		return true;
+	}
+	dest = "=";
+	
+	switch (field->cpp_type()) {
+		case pb::FieldDescriptor::CPPTYPE_BOOL: {
+			bool value = index < 0 ? reflection->GetBool(*message, field)
+				: reflection->GetRepeatedBool(*message, field, index);
+			dest += value ? '1' : '0';
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_FLOAT: {
+			float value = index < 0 ? reflection->GetFloat(*message, field)
+				: reflection->GetRepeatedFloat(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_DOUBLE: {
+			double value = index < 0 ? reflection->GetDouble(*message, field)
+				: reflection->GetRepeatedDouble(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_INT32: {
+			pb::int32 value = index < 0 ? reflection->GetInt32(*message, field)
+				: reflection->GetRepeatedInt32(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_INT64: {
+			pb::int64 value = index < 0 ? reflection->GetInt64(*message, field)
+				: reflection->GetRepeatedInt64(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_UINT32: {
+			pb::uint32 value = index < 0 ? reflection->GetUInt32(*message, field)
+				: reflection->GetRepeatedUInt32(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_UINT64: {
+			pb::uint64 value = index < 0 ? reflection->GetUInt64(*message, field)
+				: reflection->GetRepeatedUInt64(*message, field, index);
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_STRING:
+			dest += index < 0 ? reflection->GetString(*message, field)
+				: reflection->GetRepeatedString(*message, field, index);
+			return true;
+		case pb::FieldDescriptor::CPPTYPE_ENUM: {
+			int value = index < 0 ? reflection->GetEnum(*message, field)->number()
+				: reflection->GetRepeatedEnum(*message, field, index)->number();
+			dest.append((const char *)&value, sizeof(value));
+			return true;
+		}
+		case pb::FieldDescriptor::CPPTYPE_MESSAGE:
+			OrmLogError("no snapshot value for message fields");
+			return false;
+	}
+	OrmLogError("ERROR: UNKNOWN FIELD TYPE");
+	return false;
+}
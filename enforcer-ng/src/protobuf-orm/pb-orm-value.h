@@ -36,6 +36,10 @@
 
 #include "pb-orm-common.h"
 
+namespace DB {
+	class OrmParamsT;
+}
+
 void pb_field_name(const pb::FieldDescriptor *field,
 				   std::string &name);
 
@@ -44,6 +48,13 @@ bool pb_field_value(OrmConn conn,
 					const pb::FieldDescriptor *field,
 					std::string &dest);
 
+// Same as pb_field_value but adds the value as a parameter for a
+// prepared statement instead of formatting it as an SQL literal.
+bool pb_field_param(OrmConn conn,
+					const pb::Message *message,
+					const pb::FieldDescriptor *field,
+					DB::OrmParamsT &params);
+
 bool pb_field_bool_value(bool value,
 						 std::string &dest);
 
@@ -91,4 +102,12 @@ bool pb_field_repeated_value(OrmConn conn,
 							 int index,
 							 std::string &dest);
 
+// Raw unquoted representation of a field value that only serves to detect
+// changes to the value. Pass an index of -1 for a field that is not repeated.
+// Message fields are not supported, they have their own context.
+bool pb_field_snapshot_value(const pb::Message *message,
+							 const pb::FieldDescriptor *field,
+							 int index,
+							 std::string &dest);
+
 #endif
@@ -37,6 +37,7 @@
 #include "pb-orm-big-tests.h"
 #include "timecollector.h"
 #include "pbormtest.h"
+#include "pb-orm-database.h"
 
 #include "big.pb.h"
 
@@ -309,6 +310,84 @@ void BigTests::testMessageUpdate()
 	CPPUNIT_ASSERT(OrmMessageDelete(conn, all.descriptor(), allid));
 }
 
+void BigTests::testMessageUpdateChanged()
+{
+	Stopwatch swatch("BigTests::testMessageUpdateChanged");
+
+	::pb_orm_test::BigMessage all;
+	all.set_f_int32(1);
+	all.set_f_int64(2);
+	pb::uint64 allid;
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, all, allid));
+
+	::pb_orm_test::BigMessageRepeated rep;
+	rep.add_f_int32s(1);
+	rep.add_f_int32s(2);
+	pb::uint64 repid;
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, rep, repid));
+
+	all.Clear();
+	OrmContext context;
+	CPPUNIT_ASSERT(OrmMessageRead(conn, all, allid, true, context));
+	rep.Clear();
+	OrmContext repcontext;
+	CPPUNIT_ASSERT(OrmMessageRead(conn, rep, repid, true, repcontext));
+
+	// Change the db behind the back of the contexts. Updates only write
+	// the values that changed in the messages, so these changes survive.
+	CPPUNIT_ASSERT(CONN->queryf("UPDATE BigMessage SET f_int32=10 WHERE id=%llu",
+								allid).assigned());
+	CPPUNIT_ASSERT(CONN->queryf("UPDATE BigMessageRepeated_f_int32s SET value=10 "
+								"WHERE parent_id=%llu AND value=1",
+								repid).assigned());
+
+	all.set_f_int64(20);
+	CPPUNIT_ASSERT(OrmMessageUpdate(context));
+	OrmFreeContext(context);
+	rep.set_f_int32s(1, 20);
+	CPPUNIT_ASSERT(OrmMessageUpdate(repcontext));
+	OrmFreeContext(repcontext);
+
+	all.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, all, allid, true));
+	CPPUNIT_ASSERT(all.f_int32() == 10);
+	CPPUNIT_ASSERT(all.f_int64() == 20);
+
+	rep.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, rep, repid, true));
+	CPPUNIT_ASSERT(rep.f_int32s_size() == 2);
+	CPPUNIT_ASSERT(rep.f_int32s(0) == 10);
+	CPPUNIT_ASSERT(rep.f_int32s(1) == 20);
+
+	// A value changed back to what was read is written again, an update
+	// takes over the written values as the new snapshot of the context.
+	all.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, all, allid, true, context));
+	CPPUNIT_ASSERT(all.f_int32() == 10);
+	all.set_f_int32(5);
+	CPPUNIT_ASSERT(OrmMessageUpdate(context));
+	all.set_f_int32(10);
+	CPPUNIT_ASSERT(OrmMessageUpdate(context));
+	OrmFreeContext(context);
+	all.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, all, allid, true));
+	CPPUNIT_ASSERT(all.f_int32() == 10);
+
+	rep.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, rep, repid, true, repcontext));
+	CPPUNIT_ASSERT(rep.f_int32s(1) == 20);
+	rep.set_f_int32s(1, 30);
+	CPPUNIT_ASSERT(OrmMessageUpdate(repcontext));
+	rep.set_f_int32s(1, 20);
+	CPPUNIT_ASSERT(OrmMessageUpdate(repcontext));
+	OrmFreeContext(repcontext);
+	rep.Clear();
+	CPPUNIT_ASSERT(OrmMessageRead(conn, rep, repid, true));
+	CPPUNIT_ASSERT(rep.f_int32s_size() == 2);
+	CPPUNIT_ASSERT(rep.f_int32s(0) == 10);
+	CPPUNIT_ASSERT(rep.f_int32s(1) == 20);
+}
+
 void BigTests::testDateTime()
 {
 	Stopwatch swatch("BigTests::testDateTime");
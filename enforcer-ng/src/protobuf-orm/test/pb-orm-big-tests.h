@@ -46,6 +46,7 @@ class BigTests : public CppUnit::TestFixture
 	CPPUNIT_TEST(testDatabaseTransaction);
 	CPPUNIT_TEST(testMessageCRUD);
 	CPPUNIT_TEST(testMessageUpdate);
+	CPPUNIT_TEST(testMessageUpdateChanged);
 	CPPUNIT_TEST(testDateTime);
 	CPPUNIT_TEST(testBigRepeatedCreate);
 	CPPUNIT_TEST_SUITE_END();
@@ -55,6 +56,7 @@ public:
 	void testDatabaseTransaction();
 	void testMessageCRUD();
 	void testMessageUpdate();
+	void testMessageUpdateChanged();
 	void testDateTime();
 	void testBigRepeatedCreate();
 
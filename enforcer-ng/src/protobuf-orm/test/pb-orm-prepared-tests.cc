@@ -0,0 +1,246 @@
+/* $Id$ */
+
+/*
+ * Copyright (c) 2011 SURFnet bv
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*****************************************************************************
+ pb-orm-prepared-tests.cc
+
+ Contains test cases for the prepared statement cache of the connection,
+ including a benchmark comparing it with statements formatted per call.
+ *****************************************************************************/
+
+#include <time.h>
+#include <vector>
+
+#include "pb-orm-prepared-tests.h"
+#include "pb-orm-database.h"
+#include "pb-orm-str.h"
+#include "timecollector.h"
+#include "pbormtest.h"
+
+#include "big.pb.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PreparedTests);
+
+// Number of messages read per round in testReadThroughput.
+static const int NUM_READS = 2000;
+
+void PreparedTests::setUp()
+{
+	Stopwatch swatch("PreparedTests::setUp");
+
+	conn = NULL;
+
+	OrmInitialize();
+
+	__setup_conn(conn);
+
+	OrmDropTable(conn,::pb_orm_test::BigMessage::descriptor());
+
+	CPPUNIT_ASSERT(OrmCreateTable(conn,::pb_orm_test::BigMessage::descriptor()));
+}
+
+void PreparedTests::tearDown()
+{
+	Stopwatch swatch("PreparedTests::tearDown");
+
+    if (conn) {
+    	CPPUNIT_ASSERT(OrmDropTable(conn,::pb_orm_test::BigMessage::descriptor()));
+		OrmConnClose(conn);
+    }
+    OrmShutdown();
+}
+
+void PreparedTests::testBoundValues()
+{
+	Stopwatch swatch("PreparedTests::testBoundValues");
+
+	// Values that need quoting when put into the statement text.
+	::pb_orm_test::BigMessage msg;
+	msg.set_f_string("it's a 'quoted' string; DROP TABLE BigMessage");
+	msg.set_f_bytes(std::string("nul\0byte",8));
+	msg.set_f_uint64(0xfedcba9876543210ULL);
+	msg.set_f_double(1.0/3.0);
+	msg.set_f_testenum(::pb_orm_test::three);
+
+	pb::uint64 msgid;
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, msg, msgid));
+
+	::pb_orm_test::BigMessage readmsg;
+	OrmContext context;
+	CPPUNIT_ASSERT(OrmMessageRead(conn, readmsg, msgid, false, context));
+	CPPUNIT_ASSERT(readmsg.f_string() == msg.f_string());
+	CPPUNIT_ASSERT(readmsg.f_bytes() == msg.f_bytes());
+	CPPUNIT_ASSERT(readmsg.f_uint64() == msg.f_uint64());
+	CPPUNIT_ASSERT(readmsg.f_double() == msg.f_double());
+	CPPUNIT_ASSERT(readmsg.f_testenum() == ::pb_orm_test::three);
+
+	// Update goes through a different prepared statement than the insert.
+	readmsg.set_f_string("another 'quoted' string");
+	readmsg.clear_f_bytes();
+	CPPUNIT_ASSERT(OrmMessageUpdate(context));
+	OrmFreeContext(context);
+
+	CPPUNIT_ASSERT(OrmMessageRead(conn, msg, msgid, false));
+	CPPUNIT_ASSERT(msg.f_string() == "another 'quoted' string");
+	CPPUNIT_ASSERT(!msg.has_f_bytes());
+
+	CPPUNIT_ASSERT(OrmMessageDelete(conn, msg.descriptor(), msgid));
+	CPPUNIT_ASSERT(!OrmMessageFind(conn, msg.descriptor(), msgid));
+}
+
+void PreparedTests::testNestedResults()
+{
+	Stopwatch swatch("PreparedTests::testNestedResults");
+
+	::pb_orm_test::BigMessage msg;
+	pb::uint64 firstid, secondid;
+	msg.set_f_int32(1);
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, msg, firstid));
+	msg.set_f_int32(2);
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, msg, secondid));
+
+	// While the first result is still alive the same statement is used
+	// again, the cache must not hand out the statement it is iterating.
+	OrmResult first, second;
+	CPPUNIT_ASSERT(OrmMessageSelect(conn, msg.descriptor(), firstid, first));
+	CPPUNIT_ASSERT(OrmMessageSelect(conn, msg.descriptor(), secondid, second));
+
+	CPPUNIT_ASSERT(OrmGetMessage(first, msg, false));
+	CPPUNIT_ASSERT(msg.f_int32() == 1);
+	CPPUNIT_ASSERT(OrmGetMessage(second, msg, false));
+	CPPUNIT_ASSERT(msg.f_int32() == 2);
+
+	OrmFreeResult(first);
+	OrmFreeResult(second);
+}
+
+void PreparedTests::testCacheLimit()
+{
+	Stopwatch swatch("PreparedTests::testCacheLimit");
+
+	::pb_orm_test::BigMessage msg;
+	pb::uint64 msgid;
+	msg.set_f_int32(7);
+	CPPUNIT_ASSERT(OrmMessageInsert(conn, msg, msgid));
+
+	const char *name = msg.descriptor()->name().c_str();
+	DB::OrmParamsT params;
+	params.add_ulonglong(msgid);
+
+	// The statement of a result that is still being iterated survives
+	// filling the cache with more statements than it holds.
+	DB::OrmResultT held( CONN->query_prepared("PreparedTests:held", params,
+											  "SELECT * FROM %s WHERE id=?",
+											  name) );
+	CPPUNIT_ASSERT(held.assigned());
+	CPPUNIT_ASSERT(held->first_row());
+
+	for (size_t i=0; i<=DB::OrmConnT::prepared_max; ++i) {
+		std::string key;
+		CPPUNIT_ASSERT(OrmFormat(key, "PreparedTests:limit:%u", (unsigned)i));
+		DB::OrmResultT r( CONN->query_prepared(key, params,
+											   "SELECT f_int32+%u AS v FROM %s WHERE id=?",
+											   (unsigned)i, name) );
+		CPPUNIT_ASSERT(r.assigned());
+		CPPUNIT_ASSERT(r->first_row());
+		CPPUNIT_ASSERT(r->get_int("v") == 7+(int)i);
+	}
+	CPPUNIT_ASSERT(CONN->is_prepared("PreparedTests:held"));
+	CPPUNIT_ASSERT(!CONN->is_prepared("PreparedTests:limit:0"));
+	CPPUNIT_ASSERT(held->get_int("f_int32") == 7);
+	held = DB::OrmResultT();
+
+	// An evicted statement is prepared again on its next use.
+	DB::OrmResultT r( CONN->query_prepared("PreparedTests:limit:0", params,
+										   "SELECT f_int32+%u AS v FROM %s WHERE id=?",
+										   0u, name) );
+	CPPUNIT_ASSERT(r.assigned());
+	CPPUNIT_ASSERT(r->first_row());
+	CPPUNIT_ASSERT(r->get_int("v") == 7);
+}
+
+void PreparedTests::testReadThroughput()
+{
+	std::vector<pb::uint64> ids;
+	{
+		Stopwatch swatch("PreparedTests::testReadThroughput.insert");
+		OrmTransactionRW transaction(conn);
+		CPPUNIT_ASSERT(transaction.started());
+		::pb_orm_test::BigMessage msg;
+		for (int i=0; i<NUM_READS; ++i) {
+			pb::uint64 msgid;
+			msg.set_f_int32(i);
+			CPPUNIT_ASSERT(OrmMessageInsert(conn, msg, msgid));
+			ids.push_back(msgid);
+		}
+		CPPUNIT_ASSERT(transaction.commit());
+	}
+
+	const char *name = ::pb_orm_test::BigMessage::descriptor()->name().c_str();
+	OrmTransaction transaction(conn);
+	CPPUNIT_ASSERT(transaction.started());
+
+	// Statement text formatted, parsed and planned for every read.
+	{
+		Stopwatch swatch("PreparedTests::testReadThroughput.queryf");
+		for (int i=0; i<NUM_READS; ++i) {
+			DB::OrmResultT r( CONN->queryf("SELECT * FROM %s WHERE id=%llu",
+										   name, ids[i]) );
+			CPPUNIT_ASSERT(r.assigned());
+			CPPUNIT_ASSERT(r->first_row());
+			CPPUNIT_ASSERT(r->get_int("f_int32") == i);
+		}
+	}
+
+	// Statement prepared once and only bound and stepped for every read.
+	{
+		Stopwatch swatch("PreparedTests::testReadThroughput.prepared");
+		DB::OrmParamsT params;
+		for (int i=0; i<NUM_READS; ++i) {
+			params.clear();
+			params.add_ulonglong(ids[i]);
+			DB::OrmResultT r( CONN->query_prepared("PreparedTests:select",
+												   params,
+												   "SELECT * FROM %s WHERE id=?",
+												   name) );
+			CPPUNIT_ASSERT(r.assigned());
+			CPPUNIT_ASSERT(r->first_row());
+			CPPUNIT_ASSERT(r->get_int("f_int32") == i);
+		}
+	}
+
+	// Complete ORM read path that now goes through the cache.
+	{
+		Stopwatch swatch("PreparedTests::testReadThroughput.OrmMessageRead");
+		::pb_orm_test::BigMessage msg;
+		for (int i=0; i<NUM_READS; ++i) {
+			CPPUNIT_ASSERT(OrmMessageRead(conn, msg, ids[i], false));
+			CPPUNIT_ASSERT(msg.f_int32() == i);
+		}
+	}
+}
@@ -438,3 +438,84 @@ void TreeTests::testTreeUpdateRepeated()
 	}
 }
 
+
+void TreeTests::testTreeBulkRead()
+{
+	const int TREES = 5;
+	const int BRANCHES = 20;
+
+	Stopwatch swatch("TreeTests::testTreeBulkRead");
+
+	for (int t=0; t<TREES; ++t)
+		CPPUNIT_ASSERT(treeInsert(conn,BRANCHES));
+
+	OrmTransaction trans(conn);
+
+	// Read the trees one query at a time for reference.
+	std::vector<std::string> expected;
+	{
+		Stopwatch swatch1("TreeTests::testTreeBulkRead.single");
+		OrmResult dbresult;
+		::pb_orm_test::Tree tree;
+		CPPUNIT_ASSERT(OrmMessageEnum(conn, tree.descriptor(), dbresult));
+		for (bool next=OrmFirst(dbresult); next; next=OrmNext(dbresult)) {
+			CPPUNIT_ASSERT(OrmGetMessage(dbresult, tree, true));
+			expected.push_back(tree.SerializeAsString());
+		}
+		OrmFreeResult(dbresult);
+	}
+	CPPUNIT_ASSERT(expected.size() == TREES);
+	
+	// Read the same trees in bulk, two at a time.
+	{
+		Stopwatch swatch2("TreeTests::testTreeBulkRead.bulk");
+		OrmResult dbresult;
+		CPPUNIT_ASSERT(OrmMessageEnum(conn, ::pb_orm_test::Tree::descriptor(), dbresult));
+		CPPUNIT_ASSERT(OrmFirst(dbresult));
+		size_t count = 0;
+		for (bool next=true; next; ) {
+			OrmMessageList trees;
+			CPPUNIT_ASSERT(OrmGetMessages(dbresult, ::pb_orm_test::Tree::default_instance(),
+										  true, 2, trees, false, next));
+			CPPUNIT_ASSERT(trees.size() == 2 || !next);
+			for (size_t i=0; i<trees.size(); ++i, ++count) {
+				CPPUNIT_ASSERT(count < expected.size());
+				CPPUNIT_ASSERT(trees.message(i).SerializeAsString() == expected[count]);
+			}
+		}
+		OrmFreeResult(dbresult);
+		CPPUNIT_ASSERT(count == expected.size());
+	}
+	
+	// Update a tree through the context created by the bulk read.
+	{
+		OrmResult dbresult;
+		OrmMessageList trees;
+		bool next;
+		CPPUNIT_ASSERT(OrmMessageEnum(conn, ::pb_orm_test::Tree::descriptor(), dbresult));
+		CPPUNIT_ASSERT(OrmFirst(dbresult));
+		CPPUNIT_ASSERT(OrmGetMessages(dbresult, ::pb_orm_test::Tree::default_instance(),
+									  true, 0, trees, true, next));
+		OrmFreeResult(dbresult);
+		CPPUNIT_ASSERT(!next);
+		CPPUNIT_ASSERT(trees.size() == TREES);
+
+		::pb_orm_test::Tree &tree = trees.message< ::pb_orm_test::Tree >(1);
+		tree.mutable_trunk()->mutable_branches(3)->set_leaves(4, "bulk");
+		tree.mutable_trunk()->mutable_branches()->RemoveLast();
+		CPPUNIT_ASSERT(OrmMessageUpdate(trees.context(1)));
+		expected[1] = tree.SerializeAsString();
+	}
+
+	{
+		OrmResult dbresult;
+		::pb_orm_test::Tree tree;
+		CPPUNIT_ASSERT(OrmMessageEnum(conn, tree.descriptor(), dbresult));
+		CPPUNIT_ASSERT(OrmFirst(dbresult));
+		CPPUNIT_ASSERT(OrmNext(dbresult));
+		CPPUNIT_ASSERT(OrmGetMessage(dbresult, tree, true));
+		OrmFreeResult(dbresult);
+		CPPUNIT_ASSERT(tree.trunk().branches_size() == BRANCHES-1);
+		CPPUNIT_ASSERT(tree.SerializeAsString() == expected[1]);
+	}
+}
@@ -46,6 +46,7 @@ class TreeTests : public CppUnit::TestFixture
 	CPPUNIT_TEST(testTreeCRUD);
 	CPPUNIT_TEST(testTreeReadRepeated);
 	CPPUNIT_TEST(testTreeUpdateRepeated);
+	CPPUNIT_TEST(testTreeBulkRead);
 	CPPUNIT_TEST_SUITE_END();
 	
 public:
@@ -54,6 +55,7 @@ public:
 	void testTreeCRUD();
 	void testTreeReadRepeated();
 	void testTreeUpdateRepeated();
+	void testTreeBulkRead();
 	
 	void setUp();
 	void tearDown();
@@ -33,8 +33,10 @@
  *****************************************************************************/
 
 #include "pb-orm-zone-tests.h"
+#include <strings.h>
 #include "timecollector.h"
 #include "pbormtest.h"
+#include "pb-orm-database.h"
 
 #include "zone.pb.h"
 
@@ -118,3 +120,100 @@ void ZoneTests::testZonesCRUD()
 
 	CPPUNIT_ASSERT(OrmMessageRead(conn, zone, zoneid, true));
 }
+
+void ZoneTests::testZonesIndexes()
+{
+	Stopwatch swatch("ZoneTests::testZonesIndexes");
+
+	CPPUNIT_ASSERT(CONN->index_exists("EnforcerZone_keys",
+									  "EnforcerZone_keys_child_id_index"));
+	CPPUNIT_ASSERT(CONN->index_exists("EnforcerZone",
+									  "EnforcerZone_next_change_index"));
+	CPPUNIT_ASSERT(!CONN->index_exists("EnforcerZone",
+									   "EnforcerZone_policy_index"));
+
+	// Adding the indexes again to the existing tables is a no-op.
+	CPPUNIT_ASSERT(OrmCreateIndexes(conn,::pb_orm_test::EnforcerZone::descriptor()));
+	CPPUNIT_ASSERT(OrmCreateTable(conn,::pb_orm_test::EnforcerZone::descriptor()));
+}
+
+static OrmConn static_kept = NULL;
+static bool static_reusable = false;
+
+static bool
+keep_conn(OrmConn conn, bool reusable)
+{
+	static_reusable = reusable;
+	if (!reusable)
+		return false;
+	static_kept = conn;
+	return true;
+}
+
+void ZoneTests::testConnCloseHandler()
+{
+	Stopwatch swatch("ZoneTests::testConnCloseHandler");
+
+	CPPUNIT_ASSERT(OrmConnPing(conn));
+
+	// A connection taken over by the handler is not closed.
+	OrmSetConnCloseHandler(keep_conn);
+	OrmConnClose(conn);
+	OrmSetConnCloseHandler(NULL);
+	CPPUNIT_ASSERT(static_kept == conn);
+	CPPUNIT_ASSERT(static_reusable);
+	CPPUNIT_ASSERT(OrmConnPing(conn));
+
+	// A connection with an open transaction is closed anyway.
+	OrmConn other = NULL;
+	__setup_conn(other);
+	CPPUNIT_ASSERT(((DB::OrmConnT *)other)->begin_transaction());
+	static_kept = NULL;
+	OrmSetConnCloseHandler(keep_conn);
+	OrmConnClose(other);
+	OrmSetConnCloseHandler(NULL);
+	CPPUNIT_ASSERT(static_kept == NULL);
+	CPPUNIT_ASSERT(!static_reusable);
+}
+
+void ZoneTests::testSQLite3Options()
+{
+	Stopwatch swatch("ZoneTests::testSQLite3Options");
+
+	if (!OrmDatastoreSQLite3())
+		return;
+
+	OrmSQLite3Options options;
+	options.journal_mode = "WAL";
+	options.synchronous = "NORMAL";
+	options.cache_size_kb = 4096;
+	options.mmap_size_mb = 16;
+
+	OrmConn wal = NULL;
+	CPPUNIT_ASSERT(OrmConnectSQLite3("./", "sample_db", options, wal));
+	DB::OrmConnT *walconn = (DB::OrmConnT *)wal;
+
+	DB::OrmResultT result = walconn->query("PRAGMA journal_mode", 19);
+	CPPUNIT_ASSERT(result.assigned() && result->first_row());
+	CPPUNIT_ASSERT(strcasecmp(result->get_string("journal_mode"),"wal")==0);
+
+	result = walconn->query("PRAGMA synchronous", 18);
+	CPPUNIT_ASSERT(result.assigned() && result->first_row());
+	CPPUNIT_ASSERT(result->get_int("synchronous") == 1); // NORMAL
+
+	result = walconn->query("PRAGMA cache_size", 17);
+	CPPUNIT_ASSERT(result.assigned() && result->first_row());
+	CPPUNIT_ASSERT(result->get_int("cache_size") == -4096);
+	result = DB::OrmResultT();
+
+	// Values are pasted into the pragma statement and must be plain words.
+	options.synchronous = "OFF; DROP TABLE x";
+	OrmConn bad = NULL;
+	CPPUNIT_ASSERT(!OrmConnectSQLite3("./", "sample_db", options, bad));
+
+	// Switch the shared test database back to its default journal mode.
+	result = walconn->query("PRAGMA journal_mode=DELETE", 26);
+	CPPUNIT_ASSERT(result.assigned());
+	result = DB::OrmResultT();
+	OrmConnClose(wal);
+}
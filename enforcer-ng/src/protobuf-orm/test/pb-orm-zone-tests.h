@@ -43,10 +43,16 @@ class ZoneTests : public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE(ZoneTests);
 	CPPUNIT_TEST(testZonesCRUD);
+	CPPUNIT_TEST(testZonesIndexes);
+	CPPUNIT_TEST(testConnCloseHandler);
+	CPPUNIT_TEST(testSQLite3Options);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void testZonesCRUD();
+	void testZonesIndexes();
+	void testConnCloseHandler();
+	void testSQLite3Options();
 
 	void setUp();
 	void tearDown();
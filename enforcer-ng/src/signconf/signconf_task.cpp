@@ -30,11 +30,22 @@
  */
 
 #include <memory>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
 
 #include "signconf/signconf_task.h"
 #include "shared/file.h"
 #include "shared/duration.h"
+#include "shared/locks.h"
 
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
@@ -204,6 +215,115 @@ write_signer_configuration_to_file(int sockfd,
 }
 
 
+// A signer configuration to be written by one of the writer threads.
+struct SignconfJob {
+	const ::ods::kasp::Policy *policy;
+	::ods::keystate::EnforcerZone *zone;
+	OrmContext context;
+	bool written;
+};
+
+// Shared state of the threads writing signer configurations.
+struct SignconfWork {
+	int sockfd;
+	std::vector<SignconfJob> jobs;
+	size_t next_job;
+	lock_basic_type lock;
+};
+
+static void *
+write_signconfs_thread(void *arg)
+{
+	SignconfWork &work = *(SignconfWork *)arg;
+	for (;;) {
+		lock_basic_lock(&work.lock);
+		size_t j = work.next_job++;
+		lock_basic_unlock(&work.lock);
+		if (j >= work.jobs.size())
+			break;
+
+		SignconfJob &job = work.jobs[j];
+		job.written = write_signer_configuration_to_file(work.sockfd,
+														 job.policy,
+														 job.zone);
+	}
+	return NULL;
+}
+
+// Tell the signer engine over its command socket which zones have a new
+// signer configuration, packing as many zones per update command as fit.
+static bool
+notify_signer(const std::vector<std::string> &zones)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		ods_log_error("[%s] unable to create socket: %s", module_str,
+					  strerror(errno));
+		return false;
+	}
+
+	struct sockaddr_un servaddr;
+	memset(&servaddr, 0, sizeof(servaddr));
+	servaddr.sun_family = AF_UNIX;
+	strncpy(servaddr.sun_path, ODS_SE_SOCKFILE, sizeof(servaddr.sun_path)-1);
+
+	// Don't let a signer that stopped responding block this task forever.
+	struct timeval tv;
+	tv.tv_sec = 30;
+	tv.tv_usec = 0;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (connect(fd, (const struct sockaddr*)&servaddr, sizeof(servaddr))) {
+		ods_log_error("[%s] unable to connect to signer engine: %s",
+					  module_str, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	bool ok = true;
+	size_t z = 0;
+	while (ok && z < zones.size()) {
+		// The signer reads a command with a single read of at most
+		// ODS_SE_MAXLINE bytes.
+		std::string cmd("update");
+		do {
+			cmd += " " + zones[z++];
+		} while (z < zones.size()
+				 && cmd.size() + zones[z].size() + 2 < ODS_SE_MAXLINE);
+		cmd += "\n";
+
+		if (ods_writen(fd, cmd.c_str(), cmd.size()) < 0) {
+			ods_log_error("[%s] unable to send update to signer engine: %s",
+						  module_str, strerror(errno));
+			ok = false;
+			break;
+		}
+
+		// Wait for the prompt before sending the next command, otherwise
+		// both could end up in a single read on the signer side.
+		std::string reply;
+		char buf[ODS_SE_MAXLINE];
+		while (reply.size() < 5
+			   || reply.compare(reply.size()-5, 5, "cmd> ") != 0)
+		{
+			ssize_t n = read(fd, buf, sizeof(buf));
+			if (n <= 0) {
+				if (n < 0 && errno == EINTR)
+					continue;
+				ods_log_error("[%s] no reply from signer engine: %s",
+							  module_str, n ? strerror(errno) : "eof");
+				ok = false;
+				break;
+			}
+			reply.append(buf, n);
+			if (reply.size() > 5)
+				reply.erase(0, reply.size()-5);
+		}
+	}
+	close(fd);
+	return ok;
+}
+
 /*
  * ForEvery zone Z in zonelist do
  *   if flag signerConfNeedsWriting is set then
@@ -211,16 +331,19 @@ write_signer_configuration_to_file(int sockfd,
  *          configuration object
  *      Write signer configuration XML file at the correct location taken
  *          from zonedata signerconfiguration field in the zone 
+ *   Tell the signer about all the written zones at once
  */
 void 
 perform_signconf(int sockfd, engineconfig_type *config, int bforce)
 {
 	GOOGLE_PROTOBUF_VERIFY_VERSION;
-	int signer_flag = 1;  /* Is the signer responding? (1 == yes) */
     
 	OrmConnRef conn;
 	if (!ods_orm_connect(sockfd, config, conn))
 		return;
+
+	// zones that the signer needs to pick up a new configuration for.
+	std::vector<std::string> updated;
 	
 	{	OrmTransactionRW transaction(conn);
 		if (!transaction.started()) {
@@ -243,19 +366,39 @@ perform_signconf(int sockfd, engineconfig_type *config, int bforce)
 				return;
 			}
 
-			// Go through all the enumerated zones that need to be written.
-			bool bZonesUpdated = false;
-			for (bool next=OrmFirst(rows); next; next=OrmNext(rows)) {
+			// Load all the enumerated zones together with their keys.
+			OrmMessageList zones;
+			bool next = OrmFirst(rows);
+			if (next && !OrmGetMessages(rows, zone, true, 0, zones, true, next)) {
+				ods_log_error_and_printf(sockfd, module_str,
+										 "error reading zone");
+				return;
+			}
+			rows.release();
+
+			// Zones of the same policy share the policy loaded only once.
+			std::map<std::string, ::ods::kasp::Policy> policies;
+			std::set<std::string> missing;
+
+			SignconfWork work;
+			work.sockfd = sockfd;
+			work.next_job = 0;
+			for (size_t z=0; z<zones.size(); ++z) {
 				
-				OrmContextRef context;
-				if (!OrmGetMessage(rows, zone, true,context)) {
-					ods_log_error_and_printf(sockfd, module_str,
-											 "error reading zone");
-					return;
-				}
+				::ods::keystate::EnforcerZone &zone =
+					zones.message< ::ods::keystate::EnforcerZone >(z);
 
-				::ods::kasp::Policy policy;
-				if (!load_kasp_policy(conn, zone.policy(), policy)) {
+				std::map<std::string, ::ods::kasp::Policy>::iterator p =
+					policies.find(zone.policy());
+				if (p == policies.end() && !missing.count(zone.policy())) {
+					::ods::kasp::Policy policy;
+					if (load_kasp_policy(conn, zone.policy(), policy))
+						p = policies.insert(std::make_pair(zone.policy(),
+														   policy)).first;
+					else
+						missing.insert(zone.policy());
+				}
+				if (p == policies.end()) {
 					ods_log_error_and_printf(sockfd,module_str,
 											 "failed to find kasp "
 											 "policy \"%s\"",
@@ -263,43 +406,50 @@ perform_signconf(int sockfd, engineconfig_type *config, int bforce)
 					continue; // skip to next zone
 				}
 
-				if (!write_signer_configuration_to_file(sockfd,&policy,&zone))
-					continue; // skip to next zone
-				
-				if (zone.signconf_needs_writing()) {
-					zone.set_signconf_needs_writing(false);
-					if (!OrmMessageUpdate(context)) {
-						ods_log_error_and_printf(sockfd, module_str,
-												 "updating zone %s in the "
-												 "database failed",
-												 zone.name().c_str());
-					} else {
-						bZonesUpdated = true;
-						
-						if (signer_flag) {
-							/* call the signer engine to tell it that something changed */
-							/* TODO for beta version connect straight to the socket
-							   should we make a blocking call on this?
-							   should we call it here or after we have written all of the files?
-							   have timeout if call is blocking */
-							char signer_command[512];
-							strcpy(signer_command, SIGNER_CLI_UPDATE);
-							strcat(signer_command, " ");
-							strcat(signer_command, zone.name().c_str());
-							if (system(signer_command) != 0)
-							{
-								ods_log_error("Could not call signer engine");
-								ods_log_info("Will continue: call 'ods-signer update' to manually update zones");
-								signer_flag = 0;
-							}
-						}
-					}
-				}
+				SignconfJob job;
+				job.policy = &p->second;
+				job.zone = &zone;
+				job.context = zones.context(z);
+				job.written = false;
+				work.jobs.push_back(job);
+			}
+
+			// Write the signer configurations, on several threads when 
+			// there are enough of them.
+			int nthreads = 1;
+#if defined(HAVE_PTHREAD)
+			nthreads = (int)std::min((size_t)std::max(config->num_worker_threads,1),
+									 work.jobs.size());
+#endif
+			lock_basic_init(&work.lock);
+			if (nthreads > 1) {
+#if defined(HAVE_PTHREAD)
+				std::vector<ods_thread_type> threads(nthreads);
+				for (int t=0; t<nthreads; ++t)
+					ods_thread_create(&threads[t], write_signconfs_thread, &work);
+				for (int t=0; t<nthreads; ++t)
+					ods_thread_join(threads[t]);
+#endif
+			} else
+				write_signconfs_thread(&work);
+			lock_basic_destroy(&work.lock);
+
+			// Clear the flag of the zones that were written.
+			for (size_t j=0; j<work.jobs.size(); ++j) {
+				SignconfJob &job = work.jobs[j];
+				if (!job.written || !job.zone->signconf_needs_writing())
+					continue;
+				job.zone->set_signconf_needs_writing(false);
+				if (!OrmMessageUpdate(job.context)) {
+					ods_log_error_and_printf(sockfd, module_str,
+											 "updating zone %s in the "
+											 "database failed",
+											 job.zone->name().c_str());
+				} else
+					updated.push_back(job.zone->name());
 			}
-			// We have finished processing the zones...
-			rows.release();
 			
-			if (bZonesUpdated) {
+			if (!updated.empty()) {
 				if (!transaction.commit()) {
 					ods_log_error_and_printf(sockfd, module_str,
 							"error commiting updated zones to the database.");
@@ -307,6 +457,12 @@ perform_signconf(int sockfd, engineconfig_type *config, int bforce)
 			}
 		}
 	}
+
+	// call the signer engine to tell it that something changed
+	if (!updated.empty() && !notify_signer(updated)) {
+		ods_log_error("Could not call signer engine");
+		ods_log_info("Will continue: call 'ods-signer update' to manually update zones");
+	}
 }
 
 static task_type * 
@@ -199,18 +199,17 @@ generate_attributes(std::string &a, const google::protobuf::Message *msg)
     }
 }
 
-void write_msg(FILE *fw,const ::google::protobuf::Message *msg);
+void write_msg(FILE *fw,const ::google::protobuf::Message *msg,int level);
 
 void
 recurse_write(
     FILE *fw,
     const ::google::protobuf::Message *msg,
     const std::vector<const ::google::protobuf::FieldDescriptor*> &fields,
-    int ccskip)
+    int ccskip,
+    int level)
 {
     const ::google::protobuf::Reflection *reflection = msg->GetReflection();
-    static int level = -1;
-    ++level;
 
     std::set<const ::google::protobuf::FieldDescriptor*> processed_fields;
     std::vector<const ::google::protobuf::FieldDescriptor*>::const_iterator it;
@@ -267,7 +266,7 @@ recurse_write(
                     processed_fields.insert(*it);
                 }
             }
-            recurse_write(fw,msg,subfields,sspos+1);
+            recurse_write(fw,msg,subfields,sspos+1,level+1);
 
             fprintf(fw,"%s</%s>\n",indent.c_str(),elem.c_str());
             continue;
@@ -369,7 +368,7 @@ recurse_write(
                     case ::google::protobuf::FieldDescriptor::TYPE_MESSAGE:
                         // Length-delimited message.
                         fprintf(fw,"\n");
-                        write_msg(fw,&reflection->GetRepeatedMessage(*msg,field,f));
+                        write_msg(fw,&reflection->GetRepeatedMessage(*msg,field,f),level+1);
                         fprintf(fw,"%s",indent.c_str());
                         break;
                         
@@ -480,7 +479,7 @@ recurse_write(
                 case ::google::protobuf::FieldDescriptor::TYPE_MESSAGE:
                     // Length-delimited message.
                     fprintf(fw,"\n");
-                    write_msg(fw,&reflection->GetMessage(*msg,field));
+                    write_msg(fw,&reflection->GetMessage(*msg,field),level+1);
                     fprintf(fw,"%s",indent.c_str());
                     break;
                     
@@ -508,16 +507,16 @@ recurse_write(
         }
         
     }
-    
-    --level;
 }
 
+// The nesting level determines the indentation, it is passed along instead
+// of kept in a static so documents can be written from several threads.
 void 
-write_msg(FILE *fw, const ::google::protobuf::Message *msg)
+write_msg(FILE *fw, const ::google::protobuf::Message *msg, int level)
 {
     std::vector<const ::google::protobuf::FieldDescriptor*> fields;
     msg->GetReflection()->ListFields(*msg, &fields);
-    recurse_write(fw,msg,fields,0);
+    recurse_write(fw,msg,fields,0,level);
 }
 
 bool write_pb_message_to_xml_file(const google::protobuf::Message *document, 
@@ -525,7 +524,7 @@ bool write_pb_message_to_xml_file(const google::protobuf::Message *document,
 {
     FILE *fw = ods_fopen(xmlfilepath,NULL,"w");
     if (!fw) return false;
-    write_msg(fw,document);
+    write_msg(fw,document,0);
     ods_fclose(fw);
     return true;
 }
@@ -546,7 +545,7 @@ bool write_pb_message_to_xml_fd(const google::protobuf::Message *document,
     }
     FILE *fw = fdopen(dfd,"w");
     if (!fw) return false;
-    write_msg(fw,document);
+    write_msg(fw,document,0);
     ods_fclose(fw);
     return true;
 }
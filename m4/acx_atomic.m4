@@ -0,0 +1,39 @@
+# $Id$
+
+AC_DEFUN([ACX_TLS],[
+	AC_REQUIRE([AC_PROG_CC])
+
+	AC_MSG_CHECKING(for __thread storage class)
+	AC_CACHE_VAL(acx_cv_c_tls,[
+		AC_COMPILE_IFELSE(
+			[AC_LANG_PROGRAM([static __thread int tls = 0;], [tls++;])],
+			[acx_cv_c_tls=yes],
+			[acx_cv_c_tls=no])
+	])
+	AC_MSG_RESULT($acx_cv_c_tls)
+	if test $acx_cv_c_tls = yes; then
+		AC_DEFINE_UNQUOTED([HAVE_TLS], 1, [Define if the compiler supports __thread variables])
+	fi
+])
+
+AC_DEFUN([ACX_SYNC_BUILTINS],[
+	AC_REQUIRE([AC_PROG_CC])
+
+	AC_MSG_CHECKING(for __sync atomic builtins)
+	AC_CACHE_VAL(acx_cv_c_sync_builtins,[
+		# 64 bit operations may compile but need library support on
+		# some 32 bit platforms, so link the probe as well
+		AC_LINK_IFELSE(
+			[AC_LANG_PROGRAM([#include <stdint.h>],
+				[uint64_t v = 0; unsigned int u = 0;
+				 (void) __sync_fetch_and_add(&v, 1);
+				 (void) __sync_fetch_and_add(&u, 1);
+				 return !__sync_bool_compare_and_swap(&v, 1, 2);])],
+			[acx_cv_c_sync_builtins=yes],
+			[acx_cv_c_sync_builtins=no])
+	])
+	AC_MSG_RESULT($acx_cv_c_sync_builtins)
+	if test $acx_cv_c_sync_builtins = yes; then
+		AC_DEFINE_UNQUOTED([HAVE_SYNC_BUILTINS], 1, [Define if the compiler supports the __sync atomic builtins])
+	fi
+])
@@ -101,6 +101,9 @@ AC_DEFINE_UNQUOTED(OPENDNSSEC_ENFORCER_WORKINGDIR, "$OPENDNSSEC_ENFORCER_WORKING
 AC_DEFINE(OPENDNSSEC_ENFORCER_WORKERTHREADS, 4, [Number of worker threads for the enforcer])
 OPENDNSSEC_ENFORCER_KASPCHECK=$OPENDNSSEC_BIN_DIR/ods-kaspcheck
 AC_DEFINE_UNQUOTED(ODS_EN_VERBOSITY,     [3],                                [Default verbosity])
+AC_DEFINE_UNQUOTED(ODS_EN_ENFORCEBATCHSIZE, [5],                              [Default number of zones enforced per transaction])
+AC_DEFINE_UNQUOTED(ODS_EN_SQLITE_JOURNAL, ["WAL"],                             [Default journal mode of the SQLite datastore])
+AC_DEFINE_UNQUOTED(ODS_EN_SQLITE_SYNCHRONOUS, ["NORMAL"],                      [Default synchronous level of the SQLite datastore])
 
 AC_DEFINE_UNQUOTED(ODS_EN_CONTROL,    ["$OPENDNSSEC_ENFORCER_CONTROL enforcer "],    [Path to the OpenDNSSEC ods-control binary])
 AC_DEFINE_UNQUOTED(ODS_EN_KASPCHECK,  ["$OPENDNSSEC_ENFORCER_KASPCHECK"],            [Path to the OpenDNSSEC kaspcheck binary])
@@ -36,6 +36,7 @@
 #include "shared/duration.h"
 #include "shared/file.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 #include "shared/status.h"
 #include "shared/util.h"
 #include "signer/zone.h"
@@ -125,6 +126,7 @@ adapi_trans_full(zone_type* zone)
 {
     time_t start = 0;
     time_t end = 0;
+    uint64_t stage = 0;
     uint32_t num_added = 0;
     if (!zone || !zone->db) {
         return;
@@ -138,8 +140,10 @@ adapi_trans_full(zone_type* zone)
         lock_basic_unlock(&zone->stats->stats_lock);
     }
     start = time(NULL);
+    stage = metrics_now();
     /* nsecify(3) */
     namedb_nsecify(zone->db, &num_added);
+    metrics_observe_since(METRIC_NSECIFY, stage);
     end = time(NULL);
     lock_basic_lock(&zone->stats->stats_lock);
     if (!zone->stats->start_time) {
@@ -161,6 +165,7 @@ adapi_trans_diff(zone_type* zone)
 {
     time_t start = 0;
     time_t end = 0;
+    uint64_t stage = 0;
     uint32_t num_added = 0;
     if (!zone || !zone->db) {
         return;
@@ -174,8 +179,10 @@ adapi_trans_diff(zone_type* zone)
         lock_basic_unlock(&zone->stats->stats_lock);
     }
     start = time(NULL);
+    stage = metrics_now();
     /* nsecify(3) */
     namedb_nsecify(zone->db, &num_added);
+    metrics_observe_since(METRIC_NSECIFY, stage);
     end = time(NULL);
     lock_basic_lock(&zone->stats->stats_lock);
     if (!zone->stats->start_time) {
@@ -383,18 +390,40 @@ adapi_del_rr(zone_type* zone, ldns_rr* rr, int backup)
 }
 
 
+/**
+ * Print RRset, without signatures.
+ *
+ */
+static void
+adapi_printrrset(FILE* fd, rrset_type* rrset, ods_status* status)
+{
+    rrprint_type* printer = rrprint_create(fd);
+    ods_status result = ODS_STATUS_OK;
+    if (!printer) {
+        *status = ODS_STATUS_MALLOC_ERR;
+        return;
+    }
+    rrset_print(printer, rrset, 1, status);
+    result = rrprint_cleanup(printer);
+    if (*status == ODS_STATUS_OK) {
+        *status = result;
+    }
+    return;
+}
+
+
 /**
  * Print zone.
  *
  */
 ods_status
-adapi_printzone(FILE* fd, zone_type* zone)
+adapi_printzone(FILE* fd, zone_type* zone, int threads)
 {
     ods_status status = ODS_STATUS_OK;
     if (!fd || !zone || !zone->db) {
         return ODS_STATUS_ASSERT_ERR;
     }
-    namedb_export(fd, zone->db, &status);
+    namedb_export(fd, zone->db, threads, &status);
     return status;
 }
 
@@ -411,11 +440,11 @@ adapi_printaxfr(FILE* fd, zone_type* zone)
     if (!fd || !zone || !zone->db) {
         return ODS_STATUS_ASSERT_ERR;
     }
-    namedb_export(fd, zone->db, &status);
+    namedb_export(fd, zone->db, 1, &status);
     if (status == ODS_STATUS_OK) {
         rrset = zone_lookup_rrset(zone, zone->apex, LDNS_RR_TYPE_SOA);
         ods_log_assert(rrset);
-        rrset_print(fd, rrset, 1, &status);
+        adapi_printrrset(fd, rrset, &status);
     }
     return status;
 }
@@ -439,11 +468,11 @@ adapi_printixfr(FILE* fd, zone_type* zone)
     }
     rrset = zone_lookup_rrset(zone, zone->apex, LDNS_RR_TYPE_SOA);
     ods_log_assert(rrset);
-    rrset_print(fd, rrset, 1, &status);
+    adapi_printrrset(fd, rrset, &status);
     if (status != ODS_STATUS_OK) {
         return status;
     }
     ixfr_print(fd, zone->ixfr);
-    rrset_print(fd, rrset, 1, &status);
+    adapi_printrrset(fd, rrset, &status);
     return status;
 }
@@ -38,7 +38,9 @@
 #include "shared/status.h"
 #include "signer/zone.h"
 
+#include <ctype.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 static const char* adapter_str = "adapter";
 
@@ -70,6 +72,7 @@ adapter_create(const char* str, adapter_mode type, unsigned in)
     adapter->inbound = in;
     adapter->config = NULL;
     adapter->config_last_modified = 0;
+    adapter->digest_ok = 0;
     adapter->configstr = allocator_strdup(allocator, str);
     if (!adapter->configstr) {
         ods_log_error("[%s] unable to create adapter: allocator_strdup() "
@@ -162,7 +165,7 @@ adapter_load_config(adapter_type* adapter)
  *
  */
 ods_status
-adapter_read(void* zone)
+adapter_read(void* zone, int threads)
 {
     zone_type* adzone = (zone_type*) zone;
     if (!adzone || !adzone->adinbound) {
@@ -175,7 +178,7 @@ adapter_read(void* zone)
         case ADAPTER_FILE:
             ods_log_verbose("[%s] read zone %s from file input adapter %s",
                 adapter_str, adzone->name, adzone->adinbound->configstr);
-            return adfile_read(zone);
+            return adfile_read(zone, threads);
             break;
         case ADAPTER_DNS:
             ods_log_verbose("[%s] read zone %s from dns input adapter %s",
@@ -198,7 +201,7 @@ adapter_read(void* zone)
  *
  */
 ods_status
-adapter_write(void* zone)
+adapter_write(void* zone, int threads)
 {
     zone_type* adzone = (zone_type*) zone;
     if (!adzone || !adzone->db || !adzone->adoutbound) {
@@ -210,7 +213,8 @@ adapter_write(void* zone)
             ods_log_verbose("[%s] write zone %s serial %u to output file "
                 "adapter %s", adapter_str, adzone->name,
                 adzone->db->intserial, adzone->adoutbound->configstr);
-            return adfile_write(zone, adzone->adoutbound->configstr);
+            return adfile_write(zone, adzone->adoutbound->configstr,
+                threads);
             break;
         case ADAPTER_DNS:
             return addns_write(zone);
@@ -226,6 +230,74 @@ adapter_write(void* zone)
 }
 
 
+/**
+ * Backup the digest of the last input read.
+ *
+ */
+void
+adapter_backup_digest(adapter_type* adapter, const char* filename)
+{
+    FILE* fd = NULL;
+    size_t i = 0;
+    if (!adapter || !filename) {
+        return;
+    }
+    if (!adapter->digest_ok) {
+        (void) unlink(filename);
+        return;
+    }
+    fd = ods_fopen(filename, NULL, "w");
+    if (!fd) {
+        ods_log_warning("[%s] unable to backup input digest to %s",
+            adapter_str, filename);
+        return;
+    }
+    for (i = 0; i < LDNS_SHA256_DIGEST_LENGTH; i++) {
+        fprintf(fd, "%02x", (unsigned) adapter->digest[i]);
+    }
+    fprintf(fd, "\n");
+    ods_fclose(fd);
+    return;
+}
+
+
+/**
+ * Recover the digest of the last input read.
+ *
+ */
+void
+adapter_recover_digest(adapter_type* adapter, const char* filename)
+{
+    FILE* fd = NULL;
+    size_t i = 0;
+    int hi = 0;
+    int lo = 0;
+    if (!adapter || !filename) {
+        return;
+    }
+    adapter->digest_ok = 0;
+    fd = ods_fopen(filename, NULL, "r");
+    if (!fd) {
+        return;
+    }
+    for (i = 0; i < LDNS_SHA256_DIGEST_LENGTH; i++) {
+        hi = fgetc(fd);
+        lo = fgetc(fd);
+        if (!isxdigit(hi) || !isxdigit(lo)) {
+            ods_log_warning("[%s] corrupted input digest %s, ignoring",
+                adapter_str, filename);
+            ods_fclose(fd);
+            return;
+        }
+        adapter->digest[i] = (uint8_t) ((ldns_hexdigit_to_int((char) hi) << 4)
+            | ldns_hexdigit_to_int((char) lo));
+    }
+    adapter->digest_ok = 1;
+    ods_fclose(fd);
+    return;
+}
+
+
 /**
  * Compare adapters.
  *
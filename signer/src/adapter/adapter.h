@@ -40,6 +40,7 @@
 #include "shared/allocator.h"
 #include "shared/status.h"
 
+#include <ldns/ldns.h>
 #include <stdio.h>
 
 /** Adapter mode. */
@@ -61,6 +62,8 @@ struct adapter_struct {
     time_t config_last_modified;
     const char* configstr;
     void* config;
+    uint8_t digest[LDNS_SHA256_DIGEST_LENGTH]; /* last input read */
+    unsigned digest_ok : 1; /* input can be skipped if digest matches */
     unsigned inbound : 1;
 };
 
@@ -94,18 +97,36 @@ int adapter_compare(adapter_type* a1, adapter_type* a2);
 /**
  * Read zone from input adapter.
  * \param[in] zone zone
+ * \param[in] threads number of threads the adapter may use for parsing
  * \return ods_status status
  *
  */
-ods_status adapter_read(void* zone);
+ods_status adapter_read(void* zone, int threads);
 
 /**
  * Write zone to output adapter.
  * \param[in] zone zone
+ * \param[in] threads number of threads to format the zone with
  * \return ods_status status
  *
  */
-ods_status adapter_write(void* zone);
+ods_status adapter_write(void* zone, int threads);
+
+/**
+ * Backup the digest of the last input read.
+ * \param[in] adapter adapter
+ * \param[in] filename backup file
+ *
+ */
+void adapter_backup_digest(adapter_type* adapter, const char* filename);
+
+/**
+ * Recover the digest of the last input read.
+ * \param[in] adapter adapter
+ * \param[in] filename backup file
+ *
+ */
+void adapter_recover_digest(adapter_type* adapter, const char* filename);
 
 /**
  * Clean up adapter.
@@ -38,6 +38,7 @@
 #include "adapter/adutil.h"
 #include "shared/duration.h"
 #include "shared/file.h"
+#include "shared/locks.h"
 #include "shared/log.h"
 #include "shared/status.h"
 #include "shared/util.h"
@@ -48,7 +49,46 @@
 #include <stdlib.h>
 
 static const char* adapter_str = "adapter";
-static ods_status adfile_read_file(FILE* fd, zone_type* zone);
+static ods_status adfile_read_file(FILE* fd, zone_type* zone, int threads);
+
+/** Number of RR lines handed to a parser thread at once. */
+#define ADFILE_CHUNK_LINES 1000
+/** Number of chunks per parser thread that are read ahead. */
+#define ADFILE_CHUNKS_PER_THREAD 4
+
+/**
+ * RR line, waiting to be parsed.
+ *
+ */
+typedef struct adfile_line_struct adfile_line_type;
+struct adfile_line_struct {
+    char* line; /* RR in presentation format */
+    ldns_rdf* orig; /* $ORIGIN in effect, shared with other lines */
+    uint32_t ttl; /* $TTL in effect */
+    unsigned int l; /* line number */
+    ldns_rr* rr; /* parsed RR */
+    ldns_status status; /* parse status */
+};
+
+/**
+ * Batch of RR lines, cut into chunks that start with an explicit owner.
+ *
+ */
+typedef struct adfile_batch_struct adfile_batch_type;
+struct adfile_batch_struct {
+    allocator_type* allocator;
+    adfile_line_type* lines;
+    size_t line_count;
+    size_t* chunks; /* index of first line of each chunk */
+    size_t chunk_count;
+    size_t chunk_max;
+    size_t chunk_next; /* next chunk to be parsed */
+    ldns_rdf** origs; /* all $ORIGINs referred to by the lines */
+    size_t orig_count;
+    ldns_rdf* prev; /* owner preceding the first chunk */
+    ldns_rdf* last; /* owner of the last RR in the batch */
+    lock_basic_type batch_lock;
+};
 
 
 /**
@@ -119,9 +159,11 @@ adfile_read_line:
                     while (isspace((int)line[offset])) {
                         offset++;
                     }
+                    /* the digest does not cover included files */
+                    zone->adinbound->digest_ok = 0;
                     fd_include = ods_fopen(line + offset, NULL, "r");
                     if (fd_include) {
-                        s = adfile_read_file(fd_include, zone);
+                        s = adfile_read_file(fd_include, zone, 1);
                         ods_fclose(fd_include);
                     } else {
                         ods_log_error("[%s] unable to open include file %s",
@@ -189,12 +231,384 @@ adfile_read_rr:
 }
 
 
+#ifdef HAVE_PTHREAD
+/**
+ * Parse chunks of RR lines, until there are no more chunks left.
+ *
+ */
+static void*
+adfile_parse_chunks(void* arg)
+{
+    adfile_batch_type* batch = (adfile_batch_type*) arg;
+    adfile_line_type* rrline = NULL;
+    ldns_rdf* prev = NULL;
+    size_t c = 0;
+    size_t i = 0;
+    size_t end = 0;
+
+    ods_log_assert(batch);
+    while (1) {
+        lock_basic_lock(&batch->batch_lock);
+        c = batch->chunk_next;
+        batch->chunk_next++;
+        lock_basic_unlock(&batch->batch_lock);
+        if (c >= batch->chunk_count) {
+            break;
+        }
+        end = (c+1 < batch->chunk_count)?batch->chunks[c+1]:batch->line_count;
+        prev = NULL;
+        if (c == 0 && batch->prev) {
+            prev = ldns_rdf_clone(batch->prev);
+        }
+        for (i = batch->chunks[c]; i < end; i++) {
+            rrline = &batch->lines[i];
+            rrline->status = ldns_rr_new_frm_str(&rrline->rr, rrline->line,
+                rrline->ttl, rrline->orig, &prev);
+            if (rrline->status == LDNS_STATUS_SYNTAX_EMPTY) {
+                if (rrline->rr) {
+                    ldns_rr_free(rrline->rr);
+                    rrline->rr = NULL;
+                }
+                rrline->status = LDNS_STATUS_OK;
+            } else if (rrline->status != LDNS_STATUS_OK) {
+                /* the rest of the batch will not be merged */
+                if (rrline->rr) {
+                    ldns_rr_free(rrline->rr);
+                    rrline->rr = NULL;
+                }
+                break;
+            }
+        }
+        if (c == batch->chunk_count-1) {
+            batch->last = prev;
+        } else if (prev) {
+            ldns_rdf_deep_free(prev);
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Add a line to the batch.
+ *
+ */
+static ods_status
+adfile_batch_add(adfile_batch_type* batch, const char* line, ldns_rdf* orig,
+    uint32_t ttl, unsigned int l, int new_chunk)
+{
+    adfile_line_type* rrline = NULL;
+    size_t max = batch->chunk_max * ADFILE_CHUNK_LINES;
+    if (batch->line_count >= max) {
+        return ODS_STATUS_ERR;
+    }
+    if (new_chunk || batch->chunk_count == 0) {
+        batch->chunks[batch->chunk_count] = batch->line_count;
+        batch->chunk_count++;
+    }
+    rrline = &batch->lines[batch->line_count];
+    rrline->line = allocator_strdup(batch->allocator, line);
+    if (!rrline->line) {
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    rrline->orig = orig;
+    rrline->ttl = ttl;
+    rrline->l = l;
+    rrline->rr = NULL;
+    rrline->status = LDNS_STATUS_OK;
+    batch->line_count++;
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Parse the batch in parallel and add the RRs to the zone, in input order.
+ *
+ */
+static ods_status
+adfile_batch_flush(adfile_batch_type* batch, zone_type* zone, int threads,
+    uint32_t* new_serial)
+{
+    ods_status result = ODS_STATUS_OK;
+    ods_thread_type* tids = NULL;
+    adfile_line_type* rrline = NULL;
+    size_t i = 0;
+    int t = 0;
+
+    if (batch->line_count == 0) {
+        return ODS_STATUS_OK;
+    }
+    if ((size_t) threads > batch->chunk_count) {
+        threads = (int) batch->chunk_count;
+    }
+    batch->chunk_next = 0;
+    batch->last = NULL;
+    tids = (ods_thread_type*) allocator_alloc(batch->allocator,
+        threads * sizeof(ods_thread_type));
+    if (!tids) {
+        threads = 0;
+    }
+    /* the calling thread is one of the parsers */
+    for (t = 0; t < threads-1; t++) {
+        ods_thread_create(&tids[t], adfile_parse_chunks, (void*) batch);
+    }
+    (void) adfile_parse_chunks((void*) batch);
+    for (t = 0; t < threads-1; t++) {
+        ods_thread_join(tids[t]);
+    }
+    allocator_deallocate(batch->allocator, (void*) tids);
+    /* merge */
+    for (i = 0; i < batch->line_count; i++) {
+        rrline = &batch->lines[i];
+        if (result != ODS_STATUS_OK) {
+            if (rrline->rr) {
+                ldns_rr_free(rrline->rr);
+            }
+        } else if (rrline->status != LDNS_STATUS_OK) {
+            ods_log_error("[%s] error parsing RR at line %i (%s): %s",
+                adapter_str, rrline->l,
+                ldns_get_errorstr_by_id(rrline->status), rrline->line);
+            result = ODS_STATUS_ERR;
+        } else if (rrline->rr) {
+            if (ldns_rr_get_type(rrline->rr) == LDNS_RR_TYPE_SOA) {
+                *new_serial = ldns_rdf2native_int32(
+                    ldns_rr_rdf(rrline->rr, SE_SOA_RDATA_SERIAL));
+            } else if (ldns_rr_get_type(rrline->rr) == LDNS_RR_TYPE_DNSKEY ||
+                ldns_rr_get_type(rrline->rr) == LDNS_RR_TYPE_NSEC3PARAMS) {
+                /* always fully diffed, must be read every time */
+                zone->adinbound->digest_ok = 0;
+            }
+            result = adapi_add_rr(zone, rrline->rr, 0);
+            if (result == ODS_STATUS_UNCHANGED) {
+                ods_log_debug("[%s] skipping RR at line %i (duplicate): %s",
+                    adapter_str, rrline->l, rrline->line);
+                ldns_rr_free(rrline->rr);
+                result = ODS_STATUS_OK;
+            } else if (result != ODS_STATUS_OK) {
+                ods_log_error("[%s] error adding RR at line %i: %s",
+                    adapter_str, rrline->l, rrline->line);
+                ldns_rr_free(rrline->rr);
+            }
+        }
+        rrline->rr = NULL;
+        allocator_deallocate(batch->allocator, (void*) rrline->line);
+        rrline->line = NULL;
+    }
+    batch->line_count = 0;
+    batch->chunk_count = 0;
+    /* next batch continues with the last owner and $ORIGIN */
+    if (batch->prev) {
+        ldns_rdf_deep_free(batch->prev);
+    }
+    batch->prev = batch->last;
+    batch->last = NULL;
+    for (i = 0; i+1 < batch->orig_count; i++) {
+        ldns_rdf_deep_free(batch->origs[i]);
+    }
+    if (batch->orig_count > 1) {
+        batch->origs[0] = batch->origs[batch->orig_count-1];
+        batch->orig_count = 1;
+    }
+    return result;
+}
+
+
+/**
+ * Remember a new $ORIGIN for the lines that follow.
+ *
+ */
+static ods_status
+adfile_batch_origin(adfile_batch_type* batch, ldns_rdf* orig)
+{
+    ldns_rdf** origs = (ldns_rdf**) allocator_alloc(batch->allocator,
+        (batch->orig_count + 1) * sizeof(ldns_rdf*));
+    if (!origs) {
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    if (batch->origs) {
+        memcpy(origs, batch->origs, batch->orig_count * sizeof(ldns_rdf*));
+        allocator_deallocate(batch->allocator, (void*) batch->origs);
+    }
+    origs[batch->orig_count] = orig;
+    batch->origs = origs;
+    batch->orig_count++;
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Read zone file, parsing the RRs with multiple threads.
+ * Directives are handled while reading, so that every RR line carries the
+ * $ORIGIN and $TTL in effect. Lines are cut in chunks at explicit owner
+ * names, so that each chunk can be parsed independently. The parsed RRs
+ * are added to the zone in the order of the input file.
+ *
+ */
+static ods_status
+adfile_read_parallel(FILE* fd, zone_type* zone, ldns_rdf* orig, uint32_t ttl,
+    int threads, uint32_t* new_serial)
+{
+    ods_status result = ODS_STATUS_OK;
+    ods_status s = ODS_STATUS_OK;
+    adfile_batch_type batch;
+    FILE* fd_include = NULL;
+    ldns_rdf* tmp = NULL;
+    const char *endptr;  /* unused */
+    char line[SE_ADFILE_MAXLINE];
+    unsigned int line_update_interval = 100000;
+    unsigned int line_update = line_update_interval;
+    unsigned int l = 0;
+    size_t i = 0;
+    int offset = 0;
+    int len = 0;
+    int new_chunk = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.allocator = zone->allocator;
+    batch.chunk_max = (size_t) threads * ADFILE_CHUNKS_PER_THREAD;
+    batch.chunks = (size_t*) allocator_alloc(batch.allocator,
+        batch.chunk_max * sizeof(size_t));
+    batch.lines = (adfile_line_type*) allocator_alloc(batch.allocator,
+        batch.chunk_max * ADFILE_CHUNK_LINES * sizeof(adfile_line_type));
+    if (!batch.chunks || !batch.lines ||
+        adfile_batch_origin(&batch, orig) != ODS_STATUS_OK) {
+        ods_log_error("[%s] unable to read file: allocator_alloc() failed",
+            adapter_str);
+        allocator_deallocate(batch.allocator, (void*) batch.chunks);
+        allocator_deallocate(batch.allocator, (void*) batch.lines);
+        ldns_rdf_deep_free(orig);
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    lock_basic_init(&batch.batch_lock);
+
+    while (result == ODS_STATUS_OK &&
+        (len = adutil_readline_frm_file(fd, line, &l, 0)) >= 0) {
+        adutil_rtrim_line(line, &len);
+        if (len < 0) {
+            break;
+        }
+        /* debug update */
+        if (l > line_update) {
+            ods_log_debug("[%s] ...at line %i: %s", adapter_str, l, line);
+            line_update += line_update_interval;
+        }
+        if (line[0] == '$') {
+            if (strncmp(line, "$ORIGIN", 7) == 0 && isspace((int)line[7])) {
+                offset = 8;
+                while (isspace((int)line[offset])) {
+                    offset++;
+                }
+                tmp = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_DNAME,
+                    line + offset);
+                if (!tmp) {
+                    ods_log_error("[%s] error reading RR at line %i (%s): %s",
+                        adapter_str, l, ldns_get_errorstr_by_id(
+                        LDNS_STATUS_SYNTAX_DNAME_ERR), line);
+                    result = ODS_STATUS_ERR;
+                    break;
+                }
+                result = adfile_batch_origin(&batch, tmp);
+                if (result != ODS_STATUS_OK) {
+                    ldns_rdf_deep_free(tmp);
+                }
+                continue;
+            } else if (strncmp(line, "$TTL", 4) == 0 &&
+                isspace((int)line[4])) {
+                offset = 5;
+                while (isspace((int)line[offset])) {
+                    offset++;
+                }
+                ttl = ldns_str2period(line + offset, &endptr);
+                continue;
+            } else if (strncmp(line, "$INCLUDE", 8) == 0 &&
+                isspace((int)line[8])) {
+                /* everything before the include goes first */
+                result = adfile_batch_flush(&batch, zone, threads,
+                    new_serial);
+                if (result != ODS_STATUS_OK) {
+                    break;
+                }
+                offset = 9;
+                while (isspace((int)line[offset])) {
+                    offset++;
+                }
+                /* the digest does not cover included files */
+                zone->adinbound->digest_ok = 0;
+                fd_include = ods_fopen(line + offset, NULL, "r");
+                if (fd_include) {
+                    s = adfile_read_file(fd_include, zone, threads);
+                    ods_fclose(fd_include);
+                } else {
+                    ods_log_error("[%s] unable to open include file %s",
+                        adapter_str, (line+offset));
+                    result = ODS_STATUS_ERR;
+                    break;
+                }
+                if (s != ODS_STATUS_OK) {
+                    ods_log_error("[%s] error in include file %s",
+                        adapter_str, (line+offset));
+                    result = ODS_STATUS_ERR;
+                    break;
+                }
+                continue;
+            }
+            /* this can be an owner name */
+        } else if (line[0] == ';' || line[0] == '\n' ||
+            adutil_whitespace_line(line, len)) {
+            /* comments, empty lines */
+            continue;
+        }
+        /* only cut at explicit owner names */
+        new_chunk = !isspace((int)line[0]) && (batch.line_count == 0 ||
+            batch.line_count - batch.chunks[batch.chunk_count-1] >=
+            ADFILE_CHUNK_LINES);
+        if (new_chunk && batch.chunk_count >= batch.chunk_max) {
+            result = adfile_batch_flush(&batch, zone, threads, new_serial);
+            if (result != ODS_STATUS_OK) {
+                break;
+            }
+        }
+        if (batch.line_count >= batch.chunk_max * ADFILE_CHUNK_LINES) {
+            /* many owner-less lines in a row, cut anyway */
+            result = adfile_batch_flush(&batch, zone, threads, new_serial);
+            if (result != ODS_STATUS_OK) {
+                break;
+            }
+            new_chunk = 1;
+        }
+        result = adfile_batch_add(&batch, line,
+            batch.origs[batch.orig_count-1], ttl, l, new_chunk);
+    }
+    if (result == ODS_STATUS_OK) {
+        result = adfile_batch_flush(&batch, zone, threads, new_serial);
+    } else {
+        /* read error, do not merge what is left */
+        for (i = 0; i < batch.line_count; i++) {
+            allocator_deallocate(batch.allocator, (void*) batch.lines[i].line);
+        }
+    }
+    /* and done */
+    for (i = 0; i < batch.orig_count; i++) {
+        ldns_rdf_deep_free(batch.origs[i]);
+    }
+    if (batch.prev) {
+        ldns_rdf_deep_free(batch.prev);
+    }
+    lock_basic_destroy(&batch.batch_lock);
+    allocator_deallocate(batch.allocator, (void*) batch.origs);
+    allocator_deallocate(batch.allocator, (void*) batch.chunks);
+    allocator_deallocate(batch.allocator, (void*) batch.lines);
+    return result;
+}
+#endif /* HAVE_PTHREAD */
+
+
 /**
  * Read zone file.
  *
  */
 static ods_status
-adfile_read_file(FILE* fd, zone_type* zone)
+adfile_read_file(FILE* fd, zone_type* zone, int threads)
 {
     ods_status result = ODS_STATUS_OK;
     ldns_rr* rr = NULL;
@@ -227,6 +641,15 @@ adfile_read_file(FILE* fd, zone_type* zone)
     }
     /* $TTL <default ttl> */
     ttl = adapi_get_ttl(zone);
+#ifdef HAVE_PTHREAD
+    if (threads > 1) {
+        /* takes care of orig */
+        result = adfile_read_parallel(fd, zone, orig, ttl, threads,
+            &new_serial);
+        orig = NULL;
+        goto adfile_read_done;
+    }
+#endif /* HAVE_PTHREAD */
     /* read RRs */
     while ((rr = adfile_read_rr(fd, zone, line, &orig, &prev, &ttl,
         &status, &l)) != NULL) {
@@ -246,6 +669,10 @@ adfile_read_file(FILE* fd, zone_type* zone)
         if (ldns_rr_get_type(rr) == LDNS_RR_TYPE_SOA) {
             new_serial =
               ldns_rdf2native_int32(ldns_rr_rdf(rr, SE_SOA_RDATA_SERIAL));
+        } else if (ldns_rr_get_type(rr) == LDNS_RR_TYPE_DNSKEY ||
+            ldns_rr_get_type(rr) == LDNS_RR_TYPE_NSEC3PARAMS) {
+            /* always fully diffed, must be read every time */
+            zone->adinbound->digest_ok = 0;
         }
         /* add to the database */
         result = adapi_add_rr(zone, rr, 0);
@@ -278,6 +705,7 @@ adfile_read_file(FILE* fd, zone_type* zone)
             adapter_str, l, ldns_get_errorstr_by_id(status), line);
         result = ODS_STATUS_ERR;
     }
+adfile_read_done:
     /* input zone ok, set inbound serial and apply differences */
     if (result == ODS_STATUS_OK) {
         result = namedb_examine(zone->db);
@@ -292,16 +720,42 @@ adfile_read_file(FILE* fd, zone_type* zone)
 }
 
 
+/**
+ * Compute the digest of the zonefile.
+ *
+ */
+static ods_status
+adfile_digest(FILE* fd, uint8_t* digest)
+{
+    ldns_sha256_CTX ctx;
+    uint8_t buf[8192];
+    size_t len = 0;
+
+    ldns_sha256_init(&ctx);
+    while ((len = fread(buf, 1, sizeof(buf), fd)) > 0) {
+        ldns_sha256_update(&ctx, buf, len);
+    }
+    if (ferror(fd)) {
+        return ODS_STATUS_FREAD_ERR;
+    }
+    ldns_sha256_final(digest, &ctx);
+    rewind(fd);
+    return ODS_STATUS_OK;
+}
+
+
 /**
  * Read zone from zonefile.
  *
  */
 ods_status
-adfile_read(void* zone)
+adfile_read(void* zone, int threads)
 {
     FILE* fd = NULL;
     zone_type* adzone = (zone_type*) zone;
     ods_status status = ODS_STATUS_OK;
+    uint8_t digest[LDNS_SHA256_DIGEST_LENGTH];
+    int digest_ok = 0;
     if (!adzone || !adzone->adinbound || !adzone->adinbound->configstr) {
         return ODS_STATUS_ASSERT_ERR;
     }
@@ -309,10 +763,25 @@ adfile_read(void* zone)
     if (!fd) {
         return ODS_STATUS_FOPEN_ERR;
     }
-    status = adfile_read_file(fd, adzone);
+    digest_ok = (adfile_digest(fd, digest) == ODS_STATUS_OK);
+    if (digest_ok && adzone->adinbound->digest_ok && adzone->db->is_initialized
+        && memcmp(digest, adzone->adinbound->digest, sizeof(digest)) == 0) {
+        /* input unchanged, only apply dnskey and nsec3param updates */
+        ods_fclose(fd);
+        ods_log_verbose("[%s] zone %s input file %s unchanged, skip reading",
+            adapter_str, adzone->name, adzone->adinbound->configstr);
+        adapi_trans_diff(zone);
+        return ODS_STATUS_OK;
+    }
+    /* readers clear this if the digest can not be trusted */
+    adzone->adinbound->digest_ok = digest_ok;
+    status = adfile_read_file(fd, adzone, threads);
     ods_fclose(fd);
     if (status == ODS_STATUS_OK) {
+        memcpy(adzone->adinbound->digest, digest, sizeof(digest));
         adapi_trans_full(zone);
+    } else {
+        adzone->adinbound->digest_ok = 0;
     }
     return status;
 }
@@ -323,7 +792,7 @@ adfile_read(void* zone)
  *
  */
 ods_status
-adfile_write(void* zone, const char* filename)
+adfile_write(void* zone, const char* filename, int threads)
 {
     FILE* fd = NULL;
     char* tmpname = NULL;
@@ -347,7 +816,7 @@ adfile_write(void* zone, const char* filename)
     tmpname = ods_build_path(filename, ".tmp", 0, 0);
     fd = ods_fopen(tmpname, NULL, "w");
     if (fd) {
-        status = adapi_printzone(fd, adzone);
+        status = adapi_printzone(fd, adzone, threads);
         ods_fclose(fd);
     } else {
         status = ODS_STATUS_FOPEN_ERR;
@@ -363,3 +832,92 @@ adfile_write(void* zone, const char* filename)
     /* [end] write zone */
     return status;
 }
+
+
+/**
+ * Format zone into an in-memory image.
+ *
+ */
+ods_status
+adfile_image(void* zone, char** image, size_t* size, int threads)
+{
+#ifdef HAVE_OPEN_MEMSTREAM
+    FILE* fd = NULL;
+    zone_type* adzone = (zone_type*) zone;
+    ods_status status = ODS_STATUS_OK;
+
+    if (!adzone || !image || !size) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    *image = NULL;
+    *size = 0;
+    fd = open_memstream(image, size);
+    if (!fd) {
+        ods_log_error("[%s] unable to create image: open_memstream() "
+            "failed (%s)", adapter_str, strerror(errno));
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    status = adapi_printzone(fd, adzone, threads);
+    if (fclose(fd) != 0 && status == ODS_STATUS_OK) {
+        status = ODS_STATUS_MALLOC_ERR;
+    }
+    if (status != ODS_STATUS_OK) {
+        free(*image);
+        *image = NULL;
+        *size = 0;
+    }
+    return status;
+#else
+    (void) zone;
+    (void) image;
+    (void) size;
+    (void) threads;
+    return ODS_STATUS_ERR;
+#endif /* HAVE_OPEN_MEMSTREAM */
+}
+
+
+/**
+ * Write zone image to file.
+ *
+ */
+ods_status
+adfile_write_image(const char* image, size_t size, const char* filename)
+{
+    FILE* fd = NULL;
+    char* tmpname = NULL;
+    ods_status status = ODS_STATUS_OK;
+
+    if (!filename || (!image && size)) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    tmpname = ods_build_path(filename, ".tmp", 0, 0);
+    if (!tmpname) {
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    fd = ods_fopen(tmpname, NULL, "w");
+    if (fd) {
+        if (size && fwrite(image, 1, size, fd) != size) {
+            ods_log_error("[%s] unable to write file %s: fwrite() failed "
+                "(%s)", adapter_str, tmpname, strerror(errno));
+            status = ODS_STATUS_FWRITE_ERR;
+        }
+        if (fflush(fd) != 0 && status == ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to write file %s: fflush() failed "
+                "(%s)", adapter_str, tmpname, strerror(errno));
+            status = ODS_STATUS_FWRITE_ERR;
+        }
+        ods_fclose(fd);
+    } else {
+        status = ODS_STATUS_FOPEN_ERR;
+    }
+    if (status == ODS_STATUS_OK) {
+        if (rename((const char*) tmpname, filename) != 0) {
+            ods_log_error("[%s] unable to write file: failed to rename %s "
+                "to %s (%s)", adapter_str, tmpname, filename, strerror(errno));
+            status = ODS_STATUS_RENAME_ERR;
+        }
+    }
+    free(tmpname);
+    return status;
+}
@@ -49,18 +49,43 @@
 /**
  * Read zone from input file adapter.
  * \param[in] zone zone reference
+ * \param[in] threads number of threads to parse the zone file with
  * \return ods_status status
  *
  */
-ods_status adfile_read(void* zone);
+ods_status adfile_read(void* zone, int threads);
 
 /**
  * Write zone to output file adapter.
  * \param[in] zone zone reference
  * \param[in] filename write to this specific file
+ * \param[in] threads number of threads to format the zone with
  * \return ods_status status
  *
  */
-ods_status adfile_write(void* zone, const char* filename);
+ods_status adfile_write(void* zone, const char* filename, int threads);
+
+/**
+ * Format zone into an in-memory image, as adfile_write() would write it.
+ * \param[in] zone zone reference
+ * \param[out] image the image, to be released with free()
+ * \param[out] size size of the image
+ * \param[in] threads number of threads to format the zone with
+ * \return ods_status status, ODS_STATUS_ERR if images are not supported
+ *
+ */
+ods_status adfile_image(void* zone, char** image, size_t* size,
+    int threads);
+
+/**
+ * Write zone image to output file, via a temporary file and a rename.
+ * \param[in] image zone image
+ * \param[in] size size of the image
+ * \param[in] filename write to this specific file
+ * \return ods_status status
+ *
+ */
+ods_status adfile_write_image(const char* image, size_t size,
+    const char* filename);
 
 #endif /* ADAPTER_ADFILE_H */
@@ -76,31 +76,44 @@ adutil_lookup_soa_rr(FILE* fd)
 }
 
 
+/**
+ * Skip the rest of a comment that did not fit in the line buffer.
+ *
+ */
+static int
+adutil_skip_comment(FILE* fd)
+{
+    int c = 0;
+    while ((c = getc(fd)) != EOF && c != '\n') {
+        /* skip */
+    }
+    return c;
+}
+
+
 /**
  * Read one line from zone file.
+ * Whole physical lines are read with fgets(3), and only the characters
+ * that need attention (quotes, brackets, comments, tabs and newlines) are
+ * visited, instead of reading the file one character at a time.
  *
  */
 int
 adutil_readline_frm_file(FILE* fd, char* line, unsigned int* l,
     int keep_comments)
 {
-    int i = 0;
+    const char* special = keep_comments?"\"()\t\n":"\"();\t\n";
+    char* p = NULL;
+    char* q = NULL;
     int li = 0;
     int in_string = 0;
     int depth = 0;
-    int comments = 0;
-    char c = 0;
-    char lc = 0;
-
-    for (i = 0; i < SE_ADFILE_MAXLINE; i++) {
-        c = (char) ods_fgetc(fd, l);
-        if (comments) {
-            while (c != EOF && c != '\n') {
-                c = (char) ods_fgetc(fd, l);
-            }
-        }
+    int escaped = 0;
 
-        if (c == EOF) {
+    while (li < SE_ADFILE_MAXLINE - 1) {
+        p = line + li;
+        if (!fgets(p, SE_ADFILE_MAXLINE - li, fd)) {
+            /* EOF */
             if (depth != 0) {
                 ods_log_error("[%s] read line: bracket mismatch discovered at "
                     "line %i, missing ')'", adapter_str, l&&*l?*l:0);
@@ -108,71 +121,82 @@ adutil_readline_frm_file(FILE* fd, char* line, unsigned int* l,
             if (li > 0) {
                 line[li] = '\0';
                 return li;
-            } else {
-                return -1;
-            }
-        } else if (c == '"' && lc != '\\') {
-            in_string = 1 - in_string; /* swap status */
-            line[li] = c;
-            li++;
-        } else if (c == '(') {
-            if (in_string) {
-                line[li] = c;
-                li++;
-            } else if (lc != '\\') {
-                depth++;
-                line[li] = ' ';
-                li++;
-            } else {
-                line[li] = c;
-                li++;
-            }
-        } else if (c == ')') {
-            if (in_string) {
-                line[li] = c;
-                li++;
-            } else if (lc != '\\') {
-                if (depth < 1) {
-                    ods_log_error("[%s] read line: bracket mismatch "
-                        "discovered at line %i, missing '('", adapter_str,
-                        l&&*l?*l:0);
-                    line[li] = '\0';
-                    return li;
-                }
-                depth--;
-                line[li] = ' ';
-                li++;
-            } else {
-                line[li] = c;
-                li++;
             }
-        } else if (c == ';') {
-            if (in_string) {
-                line[li] = c;
-                li++;
-            } else if (lc != '\\' && !keep_comments) {
-                comments = 1;
-            } else {
-                line[li] = c;
-                li++;
-            }
-        } else if (c == '\n' && lc != '\\') {
-            comments = 0;
-            /* if no depth issue, we are done */
-            if (depth == 0) {
-                break;
+            return -1;
+        }
+        while (*(p += strcspn(p, special)) != '\0') {
+            escaped = (p > line && p[-1] == '\\');
+            switch (*p) {
+                case '"':
+                    if (!escaped) {
+                        in_string = 1 - in_string; /* swap status */
+                    }
+                    break;
+                case '(':
+                    if (!in_string && !escaped) {
+                        depth++;
+                        *p = ' ';
+                    }
+                    break;
+                case ')':
+                    if (!in_string && !escaped) {
+                        if (depth < 1) {
+                            ods_log_error("[%s] read line: bracket mismatch "
+                                "discovered at line %i, missing '('",
+                                adapter_str, l&&*l?*l:0);
+                            if (strchr(p, '\n') && l) {
+                                (*l)++;
+                            }
+                            *p = '\0';
+                            return (int) (p - line);
+                        }
+                        depth--;
+                        *p = ' ';
+                    }
+                    break;
+                case ';':
+                    if (in_string || escaped) {
+                        break;
+                    }
+                    q = strchr(p, '\n');
+                    if (q) {
+                        /* drop the comment, keep the newline */
+                        memmove(p, q, strlen(q) + 1);
+                        continue;
+                    }
+                    *p = '\0';
+                    if (adutil_skip_comment(fd) == '\n') {
+                        p[0] = '\n';
+                        p[1] = '\0';
+                        continue;
+                    }
+                    /* comment until EOF */
+                    continue;
+                case '\t':
+                    if (!escaped) {
+                        *p = ' ';
+                    }
+                    break;
+                case '\n':
+                    if (l) {
+                        (*l)++;
+                    }
+                    if (escaped) {
+                        break;
+                    }
+                    if (depth == 0) {
+                        /* if no depth issue, we are done */
+                        *p = '\0';
+                        return (int) (p - line);
+                    }
+                    *p = ' ';
+                    break;
+                default:
+                    break;
             }
-            line[li] = ' ';
-            li++;
-        } else if (c == '\t' && lc != '\\') {
-            line[li] = ' ';
-            li++;
-        } else {
-            line[li] = c;
-            li++;
+            p++;
         }
-        /* continue with line */
-        lc = c;
+        li = (int) (p - line);
     }
 
     /* done */
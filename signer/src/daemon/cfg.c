@@ -87,6 +87,8 @@ engine_config(allocator_type* allocator, const char* cfgfile,
         ecfg->log_filename = parse_conf_log_filename(allocator, cfgfile);
         ecfg->pid_filename = parse_conf_pid_filename(allocator, cfgfile);
         ecfg->notify_command = parse_conf_notify_command(allocator, cfgfile);
+        ecfg->metrics_filename = parse_conf_metrics_filename(allocator,
+            cfgfile);
         ecfg->clisock_filename = parse_conf_clisock_filename(allocator,
             cfgfile);
         ecfg->working_dir = parse_conf_working_dir(allocator, cfgfile);
@@ -96,6 +98,9 @@ engine_config(allocator_type* allocator, const char* cfgfile,
         ecfg->use_syslog = parse_conf_use_syslog(cfgfile);
         ecfg->num_worker_threads = parse_conf_worker_threads(cfgfile);
         ecfg->num_signer_threads = parse_conf_signer_threads(cfgfile);
+        ecfg->refresh_batch = parse_conf_refresh_batch(cfgfile);
+        ecfg->spread_signatures = parse_conf_spread_signatures(cfgfile);
+        ecfg->resign_slice = parse_conf_resign_slice(cfgfile);
         /* If any verbosity has been specified at cmd line we will use that */
         if (cmdline_verbosity > 0) {
         	ecfg->verbosity = cmdline_verbosity;
@@ -211,6 +216,21 @@ engine_config_print(FILE* out, engineconfig_type* config)
             fprintf(out, "\t\t<NotifyCommand>%s</NotifyCommand>\n",
                 config->notify_command);
         }
+        if (config->metrics_filename) {
+            fprintf(out, "\t\t<MetricsFile>%s</MetricsFile>\n",
+                config->metrics_filename);
+        }
+        if (config->refresh_batch) {
+            fprintf(out, "\t\t<RefreshBatch>PT%uS</RefreshBatch>\n",
+                (unsigned) config->refresh_batch);
+        }
+        if (config->spread_signatures) {
+            fprintf(out, "\t\t<SpreadSignatures/>\n");
+        }
+        if (config->resign_slice) {
+            fprintf(out, "\t\t<ResignSlice>%i</ResignSlice>\n",
+                config->resign_slice);
+        }
         fprintf(out, "\t</Signer>\n");
 
         fprintf(out, "</Configuration>\n");
@@ -242,6 +262,7 @@ engine_config_cleanup(engineconfig_type* config)
     allocator_deallocate(allocator, (void*) config->log_filename);
     allocator_deallocate(allocator, (void*) config->pid_filename);
     allocator_deallocate(allocator, (void*) config->notify_command);
+    allocator_deallocate(allocator, (void*) config->metrics_filename);
     allocator_deallocate(allocator, (void*) config->clisock_filename);
     allocator_deallocate(allocator, (void*) config->working_dir);
     allocator_deallocate(allocator, (void*) config->username);
@@ -41,6 +41,7 @@
 #include "wire/listener.h"
 
 #include <stdio.h>
+#include <time.h>
 
 /**
  * Engine configuration.
@@ -55,6 +56,7 @@ struct engineconfig_struct {
     const char* log_filename;
     const char* pid_filename;
     const char* notify_command;
+    const char* metrics_filename;
     const char* clisock_filename;
     const char* working_dir;
     const char* username;
@@ -64,6 +66,9 @@ struct engineconfig_struct {
     int num_worker_threads;
     int num_signer_threads;
     int verbosity;
+    time_t refresh_batch;
+    int spread_signatures;
+    int resign_slice;
 };
 
 /**
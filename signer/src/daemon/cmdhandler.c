@@ -37,6 +37,7 @@
 #include "shared/file.h"
 #include "shared/locks.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 #include "shared/status.h"
 
 #include <errno.h>
@@ -85,13 +86,19 @@ cmdhandler_handle_cmd_help(int sockfd)
         "                All signatures will be regenerated on the next "
                          "re-sign.\n"
         "queue           Show the current task queue.\n"
+        "stats           Show signer latencies and counters.\n"
+        "stats --prometheus\n"
+        "                Show them in Prometheus text format.\n"
     );
     ods_writen(sockfd, buf, strlen(buf));
 
     (void) snprintf(buf, ODS_SE_MAXLINE,
         "flush           Execute all scheduled tasks immediately.\n"
-        "update <zone>   Update this zone signer configurations.\n"
-        "update [--all]  Update zone list and all signer configurations.\n"
+        "update <zone> [<zone> ...]\n"
+        "                Update the signer configurations of these zones.\n"
+        "update [--all]  Update zone list. If it changed, update the signer\n"
+        "                configurations of the added and changed zones,\n"
+        "                otherwise update all signer configurations.\n"
         "start           Start the engine.\n"
         "running         Check if the engine is running.\n"
         "reload          Reload the engine.\n"
@@ -144,6 +151,54 @@ cmdhandler_handle_cmd_zones(int sockfd, cmdhandler_type* cmdc)
 }
 
 
+/**
+ * Reschedule the signconf task of a single zone.
+ * \return int 0 if the zone was not found, 1 otherwise
+ *
+ */
+static int
+cmdhandler_update_zone(int sockfd, engine_type* engine, const char* name)
+{
+    char buf[ODS_SE_MAXLINE];
+    ods_status status = ODS_STATUS_OK;
+    zone_type* zone = NULL;
+
+    /* look up zone */
+    lock_basic_lock(&engine->zonelist->zl_lock);
+    zone = zonelist_lookup_zone_by_name(engine->zonelist, name,
+        LDNS_RR_CLASS_IN);
+    /* If this zone is just added, don't update (it might not have a
+     * task yet) */
+    if (zone && zone->zl_status == ZONE_ZL_ADDED) {
+        zone = NULL;
+    }
+    lock_basic_unlock(&engine->zonelist->zl_lock);
+
+    if (!zone) {
+        (void)snprintf(buf, ODS_SE_MAXLINE, "Zone %s not found.\n",
+            name);
+        ods_writen(sockfd, buf, strlen(buf));
+        return 0;
+    }
+
+    lock_basic_lock(&zone->zone_lock);
+    status = zone_reschedule_task(zone, engine->taskq, TASK_SIGNCONF);
+    lock_basic_unlock(&zone->zone_lock);
+
+    if (status != ODS_STATUS_OK) {
+        (void)snprintf(buf, ODS_SE_MAXLINE, "Error: Unable to reschedule "
+            "task for zone %s.\n", name);
+        ods_writen(sockfd, buf, strlen(buf));
+        ods_log_crit("[%s] unable to reschedule task for zone %s: %s",
+            cmdh_str, zone->name, ods_status2str(status));
+    }
+    (void)snprintf(buf, ODS_SE_MAXLINE, "Zone %s config being updated.\n",
+        name);
+    ods_writen(sockfd, buf, strlen(buf));
+    return 1;
+}
+
+
 /**
  * Handle the 'update' command.
  *
@@ -154,8 +209,10 @@ cmdhandler_handle_cmd_update(int sockfd, cmdhandler_type* cmdc,
 {
     engine_type* engine = NULL;
     char buf[ODS_SE_MAXLINE];
-    ods_status status = ODS_STATUS_OK;
-    zone_type* zone = NULL;
+    char name[ODS_SE_MAXLINE];
+    const char* p = NULL;
+    size_t len = 0;
+    int notfound = 0;
     ods_status zl_changed = ODS_STATUS_OK;
     ods_log_assert(tbd);
     ods_log_assert(cmdc);
@@ -188,46 +245,32 @@ cmdhandler_handle_cmd_update(int sockfd, cmdhandler_type* cmdc,
             engine->zonelist->just_added = 0;
             engine->zonelist->just_updated = 0;
             lock_basic_unlock(&engine->zonelist->zl_lock);
-            engine_update_zones(engine);
+            engine_update_zones(engine, zl_changed);
         }
         return;
     } else {
-        /* look up zone */
-        lock_basic_lock(&engine->zonelist->zl_lock);
-        zone = zonelist_lookup_zone_by_name(engine->zonelist, tbd,
-            LDNS_RR_CLASS_IN);
-        /* If this zone is just added, don't update (it might not have a
-         * task yet) */
-        if (zone && zone->zl_status == ZONE_ZL_ADDED) {
-            zone = NULL;
+        /* one or more zones separated by spaces, so that the enforcer can
+         * notify us about a batch of zones at once */
+        p = tbd;
+        while (*p) {
+            while (*p == ' ') {
+                p++;
+            }
+            len = strcspn(p, " ");
+            if (len == 0) {
+                break;
+            }
+            (void)snprintf(name, sizeof(name), "%.*s", (int) len, p);
+            p += len;
+            if (!cmdhandler_update_zone(sockfd, engine, name)) {
+                notfound = 1;
+            }
         }
-        lock_basic_unlock(&engine->zonelist->zl_lock);
-
-        if (!zone) {
-            (void)snprintf(buf, ODS_SE_MAXLINE, "Zone %s not found.\n",
-                tbd);
-            ods_writen(sockfd, buf, strlen(buf));
+        engine_wakeup_workers(engine);
+        if (notfound) {
             /* update all */
             cmdhandler_handle_cmd_update(sockfd, cmdc, "--all");
-            return;
         }
-
-        lock_basic_lock(&zone->zone_lock);
-        status = zone_reschedule_task(zone, engine->taskq, TASK_SIGNCONF);
-        lock_basic_unlock(&zone->zone_lock);
-
-        if (status != ODS_STATUS_OK) {
-            (void)snprintf(buf, ODS_SE_MAXLINE, "Error: Unable to reschedule "
-                "task for zone %s.\n", tbd);
-            ods_writen(sockfd, buf, strlen(buf));
-            ods_log_crit("[%s] unable to reschedule task for zone %s: %s",
-                cmdh_str, zone->name, ods_status2str(status));
-        } else {
-            engine_wakeup_workers(engine);
-        }
-        (void)snprintf(buf, ODS_SE_MAXLINE, "Zone %s config being updated.\n",
-            tbd);
-        ods_writen(sockfd, buf, strlen(buf));
     }
     return;
 }
@@ -335,6 +378,7 @@ cmdhandler_handle_cmd_clear(int sockfd, cmdhandler_type* cmdc, const char* tbd)
     engine = (engine_type*) cmdc->engine;
     unlink_backup_file(tbd, ".inbound");
     unlink_backup_file(tbd, ".backup");
+    unlink_backup_file(tbd, ".digest");
     lock_basic_lock(&engine->zonelist->zl_lock);
     zone = zonelist_lookup_zone_by_name(engine->zonelist, tbd,
         LDNS_RR_CLASS_IN);
@@ -349,6 +393,10 @@ cmdhandler_handle_cmd_clear(int sockfd, cmdhandler_type* cmdc, const char* tbd)
         zone->db = namedb_create(zone->allocator);
         zone->db->is_initialized = 1;
         zone->db->inbserial = inbserial;
+        if (zone->adinbound) {
+            /* force a full read of the input */
+            zone->adinbound->digest_ok = 0;
+        }
         zone->db->intserial = intserial;
         zone->db->outserial = outserial;
 
@@ -383,7 +431,9 @@ cmdhandler_handle_cmd_queue(int sockfd, cmdhandler_type* cmdc)
     char buf[ODS_SE_MAXLINE];
     size_t i = 0;
     time_t now = 0;
-    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
+    task_type** list = NULL;
+    size_t count = 0;
+    size_t j = 0;
     task_type* task = NULL;
     ods_log_assert(cmdc);
     ods_log_assert(cmdc->engine);
@@ -413,24 +463,40 @@ cmdhandler_handle_cmd_queue(int sockfd, cmdhandler_type* cmdc)
     }
     /* how many tasks */
     (void)snprintf(buf, ODS_SE_MAXLINE, "\nI have %i tasks scheduled.\n",
-        (int) engine->taskq->tasks->count);
+        (int) schedule_size(engine->taskq));
     ods_writen(sockfd, buf, strlen(buf));
     /* list tasks */
-    node = ldns_rbtree_first(engine->taskq->tasks);
-    while (node && node != LDNS_RBTREE_NULL) {
-        task = (task_type*) node->data;
+    list = schedule_list(engine->taskq, &count);
+    for (j=0; j < count; j++) {
+        task = list[j];
         for (i=0; i < ODS_SE_MAXLINE; i++) {
             buf[i] = 0;
         }
         (void)task2str(task, (char*) &buf[0]);
         ods_writen(sockfd, buf, strlen(buf));
-        node = ldns_rbtree_next(node);
     }
+    free((void*) list);
     lock_basic_unlock(&engine->taskq->schedule_lock);
     return;
 }
 
 
+/**
+ * Handle the 'stats' command.
+ *
+ */
+static void
+cmdhandler_handle_cmd_stats(int sockfd, const char* format)
+{
+    if (format && ods_strcmp(format, "--prometheus") == 0) {
+        metrics_print_prometheus(sockfd);
+    } else {
+        metrics_print(sockfd);
+    }
+    return;
+}
+
+
 /**
  * Handle the 'flush' command.
  *
@@ -644,6 +710,15 @@ again:
         } else if (n == 5 && strncmp(buf, "queue", n) == 0) {
             ods_log_debug("[%s] list tasks command", cmdh_str);
             cmdhandler_handle_cmd_queue(sockfd, cmdc);
+        } else if (n >= 5 && strncmp(buf, "stats", 5) == 0) {
+            ods_log_debug("[%s] stats command", cmdh_str);
+            if (buf[5] == '\0') {
+                cmdhandler_handle_cmd_stats(sockfd, NULL);
+            } else if (buf[5] != ' ') {
+                cmdhandler_handle_cmd_unknown(sockfd, buf);
+            } else {
+                cmdhandler_handle_cmd_stats(sockfd, &buf[6]);
+            }
         } else if (n == 5 && strncmp(buf, "flush", n) == 0) {
             ods_log_debug("[%s] flush tasks command", cmdh_str);
             cmdhandler_handle_cmd_flush(sockfd, cmdc);
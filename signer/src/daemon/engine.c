@@ -35,12 +35,14 @@
 #include "daemon/cfg.h"
 #include "daemon/engine.h"
 #include "daemon/signal.h"
+#include "parser/confparser.h"
 #include "shared/allocator.h"
 #include "shared/duration.h"
 #include "shared/file.h"
 #include "shared/hsm.h"
 #include "shared/locks.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 #include "shared/privdrop.h"
 #include "shared/status.h"
 #include "shared/util.h"
@@ -93,6 +95,7 @@ engine_create(void)
     engine->cmdhandler_done = 0;
     engine->dnshandler = NULL;
     engine->xfrhandler = NULL;
+    engine->writer = NULL;
     engine->pid = -1;
     engine->zfpid = -1;
     engine->uid = -1;
@@ -332,6 +335,49 @@ engine_privdrop(engine_type* engine)
 }
 
 
+/**
+ * Start/stop writer.
+ *
+ */
+static void*
+writer_thread_start(void* arg)
+{
+    writer_type* writer = (writer_type*) arg;
+    ods_thread_blocksigs();
+    writer_start(writer);
+    return NULL;
+}
+static void
+engine_start_writer(engine_type* engine)
+{
+    if (!engine || !engine->writer) {
+        return;
+    }
+    ods_log_debug("[%s] start writer", engine_str);
+    engine->writer->engine = engine;
+    engine->writer->started = 1;
+    ods_thread_create(&engine->writer->thread_id, writer_thread_start,
+        engine->writer);
+    return;
+}
+static void
+engine_stop_writer(engine_type* engine)
+{
+    if (!engine || !engine->writer) {
+        return;
+    }
+    ods_log_debug("[%s] stop writer", engine_str);
+    writer_signal(engine->writer);
+    ods_log_debug("[%s] join writer", engine_str);
+    if (engine->writer->started) {
+        ods_thread_join(engine->writer->thread_id);
+        engine->writer->started = 0;
+    }
+    engine->writer->engine = NULL;
+    return;
+}
+
+
 /**
  * Start/stop workers.
  *
@@ -496,6 +542,7 @@ engine_setup(engine_type* engine)
     if (!engine->xfrhandler) {
         return ODS_STATUS_XFRHANDLER_ERR;
     }
+    engine->writer = writer_create(engine->allocator);
     if (engine->dnshandler) {
         if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) == -1) {
             return ODS_STATUS_XFRHANDLER_ERR;
@@ -568,6 +615,7 @@ engine_setup(engine_type* engine)
     engine_start_cmdhandler(engine);
     engine_start_dnshandler(engine);
     engine_start_xfrhandler(engine);
+    engine_start_writer(engine);
     tsig_handler_init(engine->allocator);
     /* write pidfile */
     if (util_write_pidfile(engine->config->pid_filename, engine->pid) == -1) {
@@ -752,21 +800,29 @@ dnsconfig_zone(engine_type* engine, zone_type* zone)
  *
  */
 void
-engine_update_zones(engine_type* engine)
+engine_update_zones(engine_type* engine, ods_status zl_changed)
 {
     ldns_rbnode_t* node = LDNS_RBTREE_NULL;
     zone_type* zone = NULL;
     zone_type* delzone = NULL;
+    zone_type** removed = NULL;
+    zone_type** grown = NULL;
+    size_t removed_count = 0;
+    size_t removed_size = 0;
     task_type* task = NULL;
     ods_status status = ODS_STATUS_OK;
     unsigned wake_up = 0;
     int warnings = 0;
     time_t now = 0;
+    uint64_t start = 0;
+    size_t touched = 0;
+    size_t i = 0;
 
     if (!engine || !engine->zonelist || !engine->zonelist->zones) {
         return;
     }
     now = time_now();
+    start = time_now_ms();
 
     ods_log_debug("[%s] commit zone list changes", engine_str);
     lock_basic_lock(&engine->zonelist->zl_lock);
@@ -775,6 +831,12 @@ engine_update_zones(engine_type* engine)
         zone = (zone_type*) node->data;
         task = NULL; /* reset task */
 
+        if (zl_changed == ODS_STATUS_OK && zone->zl_status == ZONE_ZL_OK) {
+            /* not in the change set */
+            node = ldns_rbtree_next(node);
+            continue;
+        }
+        touched++;
         if (zone->zl_status == ZONE_ZL_REMOVED) {
             node = ldns_rbtree_next(node);
             lock_basic_lock(&zone->zone_lock);
@@ -790,7 +852,24 @@ engine_update_zones(engine_type* engine)
             lock_basic_unlock(&zone->zone_lock);
             netio_remove_handler(engine->xfrhandler->netio,
                 &zone->xfrd->handler);
-            zone_cleanup(zone);
+            /* the writer may still hold an image of the zone, wait for it
+             * after the zone list is unlocked */
+            if (removed_count == removed_size) {
+                removed_size = removed_size ? removed_size * 2 : 16;
+                grown = (zone_type**) realloc(removed,
+                    removed_size * sizeof(zone_type*));
+                if (!grown) {
+                    ods_log_error("[%s] unable to defer clean up of zone "
+                        "%s: realloc() failed", engine_str, zone->name);
+                    removed_size = removed_count;
+                    writer_wait(engine->writer, zone);
+                    zone_cleanup(zone);
+                    zone = NULL;
+                    continue;
+                }
+                removed = grown;
+            }
+            removed[removed_count++] = zone;
             zone = NULL;
             continue;
         } else if (zone->zl_status == ZONE_ZL_ADDED) {
@@ -849,6 +928,13 @@ engine_update_zones(engine_type* engine)
         node = ldns_rbtree_next(node);
     }
     lock_basic_unlock(&engine->zonelist->zl_lock);
+    for (i = 0; i < removed_count; i++) {
+        writer_wait(engine->writer, removed[i]);
+        zone_cleanup(removed[i]);
+    }
+    free(removed);
+    ods_log_info("[%s] committed zone list changes for %u zones in %u ms",
+        engine_str, (unsigned) touched, (unsigned) (time_now_ms() - start));
     if (engine->dnshandler) {
         dnshandler_fwd_notify(engine->dnshandler,
             (uint8_t*) ODS_SE_NOTIFY_CMD, strlen(ODS_SE_NOTIFY_CMD));
@@ -957,6 +1043,8 @@ engine_start(const char* cfgfile, int cmdline_verbosity, int daemonize,
     xmlInitGlobals();
     xmlInitParser();
     xmlInitThreads();
+    parse_rng_init();
+    metrics_init();
     engine = engine_create();
     if (!engine) {
         ods_fatal_exit("[%s] create failed", engine_str);
@@ -1017,13 +1105,18 @@ engine_start(const char* cfgfile, int cmdline_verbosity, int daemonize,
         }
         if (zl_changed == ODS_STATUS_OK ||
             zl_changed == ODS_STATUS_UNCHANGED) {
-            engine_update_zones(engine);
+            /* start and reload check all signer configurations */
+            engine_update_zones(engine, ODS_STATUS_UNCHANGED);
         }
         engine_run(engine, single_run);
     }
 
     /* shutdown */
     ods_log_info("[%s] signer shutdown", engine_str);
+    if (engine->config && engine->config->metrics_filename) {
+        (void) metrics_dump(engine->config->metrics_filename, 0);
+    }
+    engine_stop_writer(engine);
     if (close_hsm) {
         hsm_close();
     }
@@ -1044,6 +1137,7 @@ earlyexit:
     engine_cleanup(engine);
     engine = NULL;
     ods_log_close();
+    parse_rng_cleanup();
     xmlCleanupParser();
     xmlCleanupGlobals();
     xmlCleanupThreads();
@@ -1086,6 +1180,7 @@ engine_cleanup(engine_type* engine)
     cmdhandler_cleanup(engine->cmdhandler);
     dnshandler_cleanup(engine->dnshandler);
     xfrhandler_cleanup(engine->xfrhandler);
+    writer_cleanup(engine->writer);
     engine_config_cleanup(engine->config);
     allocator_deallocate(allocator, (void*) engine);
     lock_basic_destroy(&signal_lock);
@@ -40,6 +40,7 @@
 #include "daemon/dnshandler.h"
 #include "daemon/xfrhandler.h"
 #include "daemon/worker.h"
+#include "daemon/writer.h"
 #include "scheduler/fifoq.h"
 #include "scheduler/schedule.h"
 #include "shared/allocator.h"
@@ -65,6 +66,7 @@ struct engine_struct {
     cmdhandler_type* cmdhandler;
     dnshandler_type* dnshandler;
     xfrhandler_type* xfrhandler;
+    writer_type* writer;
     edns_data_type edns;
     int cmdhandler_done;
 
@@ -118,9 +120,12 @@ void engine_wakeup_workers(engine_type* engine);
 /**
  * Update zones.
  * \param[in] engine engine
+ * \param[in] zl_changed ODS_STATUS_OK if the zone list has just been merged,
+ *            only the added, removed and updated zones are touched then.
+ *            Otherwise, all zones get their signer configuration checked.
  *
  */
-void engine_update_zones(engine_type* engine);
+void engine_update_zones(engine_type* engine, ods_status zl_changed);
 
 /**
  * Clean up engine.
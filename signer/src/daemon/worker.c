@@ -38,8 +38,10 @@
 #include "shared/hsm.h"
 #include "shared/locks.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 #include "shared/status.h"
 #include "shared/util.h"
+#include "signer/ixfr.h"
 #include "signer/tools.h"
 #include "signer/zone.h"
 
@@ -192,15 +194,13 @@ worker_queue_rrset(worker_type* worker, fifoq_type* q, rrset_type* rrset)
 static void
 worker_queue_domain(worker_type* worker, fifoq_type* q, domain_type* domain)
 {
-    rrset_type* rrset = NULL;
     denial_type* denial = NULL;
+    size_t i = 0;
     ods_log_assert(worker);
     ods_log_assert(q);
     ods_log_assert(domain);
-    rrset = domain->rrsets;
-    while (rrset) {
-        worker_queue_rrset(worker, q, rrset);
-        rrset = rrset->next;
+    for (i=0; i < domain->rrset_count; i++) {
+        worker_queue_rrset(worker, q, domain->rrsets[i]);
     }
     denial = (denial_type*) domain->denial;
     if (denial && denial->rrset) {
@@ -272,6 +272,81 @@ worker_check_jobs(worker_type* worker, task_type* task) {
 }
 
 
+/**
+ * Dump metrics, if configured.
+ *
+ */
+static void
+worker_dump_metrics(engine_type* engine)
+{
+    if (engine->config->metrics_filename) {
+        (void) metrics_dump(engine->config->metrics_filename,
+            METRICS_DUMP_INTERVAL);
+    }
+    return;
+}
+
+
+/**
+ * Are batched signature refreshes due?
+ * Stale signatures are kept until the earliest expiration in the zone is
+ * more than the batch duration past its refresh time, or until the zone
+ * has to be published anyway.
+ *
+ */
+static int
+worker_refresh_due(zone_type* zone, time_t batch)
+{
+    time_t refresh = 0;
+    ods_log_assert(zone);
+    ods_log_assert(zone->db);
+    if (!batch || !zone->db->sig_expire_min || !zone->signconf ||
+        zone->db->force_output || ixfr_changed(zone->ixfr)) {
+        return 1;
+    }
+    refresh = duration2time(zone->signconf->sig_refresh_interval);
+    /* never eat more than half of the refresh margin */
+    if (batch > refresh/2) {
+        batch = refresh/2;
+    }
+    return ((time_t) zone->db->sig_expire_min < time_now() + refresh - batch);
+}
+
+
+/**
+ * Increment the serial and sign the new SOA.
+ *
+ */
+static ods_status
+worker_publish_serial(worker_type* worker, engine_type* engine,
+    zone_type* zone, task_type* task)
+{
+    ods_status status = ODS_STATUS_OK;
+    rrset_type* rrset = NULL;
+    int resign = !zone->db->serial_updated;
+
+    status = zone_update_serial(zone);
+    if (status != ODS_STATUS_OK) {
+        ods_log_error("[%s[%i]] unable to sign zone %s: "
+            "failed to increment serial",
+            worker2str(worker->type), worker->thread_num,
+            task_who2str(task));
+        return status;
+    }
+    if (!resign) {
+        /* serial came with the input, its SOA is signed already */
+        return ODS_STATUS_OK;
+    }
+    rrset = zone_lookup_rrset(zone, zone->apex, LDNS_RR_TYPE_SOA);
+    ods_log_assert(rrset);
+    worker_queue_rrset(worker, engine->signq, rrset);
+    worker_sleep_unless(worker, 0);
+    status = worker_check_jobs(worker, task);
+    worker_clear_jobs(worker);
+    return status;
+}
+
+
 /**
  * Perform task.
  *
@@ -289,6 +364,10 @@ worker_perform_task(worker_type* worker)
     int backup = 0;
     time_t start = 0;
     time_t end = 0;
+    uint64_t stage = 0;
+    int publish = 1;
+    task_id halted = TASK_NONE;
+    time_t halted_when = 0;
 
     if (!worker || !worker->task || !worker->task->zone || !worker->engine) {
         return;
@@ -305,7 +384,9 @@ worker_perform_task(worker_type* worker)
             /* perform 'load signconf' task */
             worker_working_with(worker, TASK_SIGNCONF, TASK_READ,
                 "configure", task_who2str(task), &what, &when);
+            stage = metrics_now();
             status = tools_signconf(zone);
+            metrics_observe_since(METRIC_SIGNCONF, stage);
             if (status == ODS_STATUS_UNCHANGED) {
                 if (!zone->signconf->last_modified) {
                     ods_log_debug("[%s[%i]] no signconf.xml for zone %s yet",
@@ -340,7 +421,10 @@ worker_perform_task(worker_type* worker)
                 status = ODS_STATUS_ERR;
             } else {
                 lhsm_check_connection((void*)engine);
-                status = tools_input(zone);
+                stage = metrics_now();
+                status = tools_input(zone,
+                    engine->config->num_signer_threads);
+                metrics_observe_since(METRIC_READ, stage);
             }
             if (status == ODS_STATUS_OK) {
                 if (task->interrupt > TASK_SIGNCONF) {
@@ -358,25 +442,9 @@ worker_perform_task(worker_type* worker)
             /* perform 'sign' task */
             worker_working_with(worker, TASK_SIGN, TASK_WRITE,
                 "sign", task_who2str(task), &what, &when);
-            status = zone_update_serial(zone);
-            if (status == ODS_STATUS_OK) {
-                if (task->interrupt > TASK_SIGNCONF) {
-                    task->interrupt = TASK_NONE;
-                    task->halted = TASK_NONE;
-                }
-            } else {
-                ods_log_error("[%s[%i]] unable to sign zone %s: "
-                    "failed to increment serial",
-                    worker2str(worker->type), worker->thread_num,
-                    task_who2str(task));
-                if (task->halted == TASK_NONE) {
-                    goto task_perform_fail;
-                }
-                goto task_perform_continue;
-            }
-
             /* start timer */
             start = time(NULL);
+            stage = metrics_now();
             if (zone->stats) {
                 lock_basic_lock(&zone->stats->stats_lock);
                 if (!zone->stats->start_time) {
@@ -385,9 +453,16 @@ worker_perform_task(worker_type* worker)
                 zone->stats->sig_count = 0;
                 zone->stats->sig_soa_count = 0;
                 zone->stats->sig_reuse = 0;
+                zone->stats->sig_deferred = 0;
+                zone->stats->sig_refreshed = 0;
+                zone->stats->sig_expire_min = 0;
                 zone->stats->sig_time = 0;
                 lock_basic_unlock(&zone->stats->stats_lock);
             }
+            zone->db->refresh_due = worker_refresh_due(zone,
+                engine->config->refresh_batch);
+            zone->db->sig_spread = engine->config->spread_signatures?1:0;
+            zone->db->sig_slice = (uint32_t) engine->config->resign_slice;
             /* check the HSM connection before queuing sign operations */
             lhsm_check_connection((void*)engine);
             /* queue menial, hard signing work */
@@ -400,11 +475,27 @@ worker_perform_task(worker_type* worker)
             worker_sleep_unless(worker, 0);
             status = worker_check_jobs(worker, task);
             worker_clear_jobs(worker);
+            /* publish decision: only a real delta gets a new serial,
+             * unless the last output may not have been written */
+            if (status == ODS_STATUS_OK) {
+                publish = zone->db->force_output ||
+                    ixfr_changed(zone->ixfr);
+                metrics_count(publish?COUNTER_PUBLISHED:
+                    COUNTER_PUBLISH_SKIPPED, 1);
+            }
+            if (status == ODS_STATUS_OK && publish) {
+                status = worker_publish_serial(worker, engine, zone, task);
+            }
             /* stop timer */
             end = time(NULL);
+            metrics_observe_since(METRIC_SIGN, stage);
             if (status == ODS_STATUS_OK && zone->stats) {
                 lock_basic_lock(&zone->stats->stats_lock);
                 zone->stats->sig_time = (end-start);
+                zone->stats->publish = publish;
+                zone->db->sig_expire_min = zone->stats->sig_expire_min;
+                metrics_count(COUNTER_SIGS_DEFERRED,
+                    zone->stats->sig_deferred);
                 lock_basic_unlock(&zone->stats->stats_lock);
             }
             if (status != ODS_STATUS_OK) {
@@ -423,8 +514,20 @@ worker_perform_task(worker_type* worker)
             /* perform 'write to output adapter' task */
             worker_working_with(worker, TASK_WRITE, TASK_SIGN,
                 "write", task_who2str(task), &what, &when);
-            status = tools_output(zone, engine);
+            stage = metrics_now();
+            if (publish) {
+                status = tools_output(zone, engine);
+            } else {
+                tools_skip_output(zone);
+                status = ODS_STATUS_OK;
+            }
+            metrics_observe_since(METRIC_WRITE, stage);
             if (status == ODS_STATUS_OK) {
+                if (task->interrupt == TASK_WRITE) {
+                    /* a retried write, go on with the task it halted */
+                    halted = task->halted;
+                    halted_when = task->halted_when;
+                }
                 if (task->interrupt > TASK_SIGNCONF) {
                     task->interrupt = TASK_NONE;
                     task->halted = TASK_NONE;
@@ -453,6 +556,10 @@ worker_perform_task(worker_type* worker)
                 what = TASK_SIGN;
                 when = worker->clock_in + 3600;
             }
+            if (halted != TASK_NONE) {
+                what = halted;
+                when = halted_when;
+            }
             backup = 1;
             break;
         case TASK_NONE:
@@ -495,7 +602,9 @@ worker_perform_task(worker_type* worker)
     }
     /* backup the last successful run */
     if (backup) {
+        stage = metrics_now();
         status = zone_backup2(zone);
+        metrics_observe_since(METRIC_BACKUP, stage);
         if (status != ODS_STATUS_OK) {
             ods_log_warning("[%s[%i]] unable to backup zone %s: %s",
             worker2str(worker->type), worker->thread_num,
@@ -505,11 +614,16 @@ worker_perform_task(worker_type* worker)
         }
         backup = 0;
     }
+    metrics_count(COUNTER_TASKS, 1);
+    worker_dump_metrics(engine);
     return;
 
 task_perform_fail:
     /* in case of failure, also mark zone processed (for single run usage) */
     zone->db->is_processed = 1;
+    metrics_count(COUNTER_TASKS, 1);
+    metrics_count(COUNTER_TASK_ERRORS, 1);
+    worker_dump_metrics(engine);
     if (task->backoff) {
         task->backoff *= 2;
         if (task->backoff > ODS_SE_MAX_BACKOFF) {
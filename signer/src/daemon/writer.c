@@ -0,0 +1,405 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Zone output writer.
+ *
+ */
+
+#include "config.h"
+#include "adapter/adfile.h"
+#include "daemon/dnshandler.h"
+#include "daemon/engine.h"
+#include "daemon/writer.h"
+#include "shared/duration.h"
+#include "shared/file.h"
+#include "shared/log.h"
+#include "shared/metrics.h"
+#include "signer/zone.h"
+
+#include <string.h>
+
+static const char* writer_str = "writer";
+
+
+/**
+ * Clean up job.
+ *
+ */
+static void
+writer_job_cleanup(writer_job_type* job)
+{
+    if (!job) {
+        return;
+    }
+    free(job->name);
+    free(job->filename);
+    free(job->notify_ns);
+    free(job->image);
+    free(job);
+    return;
+}
+
+
+/**
+ * Create writer.
+ *
+ */
+writer_type*
+writer_create(allocator_type* allocator)
+{
+    writer_type* writer = NULL;
+    if (!allocator) {
+        return NULL;
+    }
+    writer = (writer_type*) allocator_alloc(allocator, sizeof(writer_type));
+    if (!writer) {
+        ods_log_error("[%s] unable to create writer: allocator_alloc() "
+            "failed", writer_str);
+        return NULL;
+    }
+    writer->allocator = allocator;
+    writer->engine = NULL;
+    writer->first = NULL;
+    writer->last = NULL;
+    writer->current = NULL;
+    writer->count = 0;
+    writer->started = 0;
+    writer->need_to_exit = 0;
+    lock_basic_init(&writer->q_lock);
+    lock_basic_set(&writer->q_threshold);
+    lock_basic_set(&writer->q_done);
+    return writer;
+}
+
+
+/**
+ * Retry writing the zone later.
+ * The zone lock is taken here, never while holding the queue lock.
+ *
+ */
+static void
+writer_retry(writer_type* writer, writer_job_type* job)
+{
+    engine_type* engine = (engine_type*) writer->engine;
+    zone_type* zone = (zone_type*) job->zone;
+    task_type* task = NULL;
+
+    if (!engine || !zone) {
+        return;
+    }
+    lock_basic_lock(&zone->zone_lock);
+    /* the journal is purged and the backup says the serial is out, so a
+     * sign run that ends up without changes must write the output too */
+    if (zone->db) {
+        zone->db->force_output = 1;
+    }
+    if (zone->zl_status == ZONE_ZL_REMOVED || !zone->task) {
+        lock_basic_unlock(&zone->zone_lock);
+        return;
+    }
+    lock_basic_lock(&engine->taskq->schedule_lock);
+    task = unschedule_task(engine->taskq, (task_type*) zone->task);
+    if (task) {
+        if (task->what != TASK_WRITE) {
+            if (task->halted == TASK_NONE) {
+                task->halted = task->what;
+                task->halted_when = task->when;
+            } else {
+                /* already interrupted: keep the earliest stage, the
+                 * worker falls through to the later ones from there */
+                if (task->what < task->halted) {
+                    task->halted = task->what;
+                }
+                if (task->when < task->halted_when) {
+                    task->halted_when = task->when;
+                }
+            }
+            task->interrupt = TASK_WRITE;
+        }
+        task->what = TASK_WRITE;
+        if (task->backoff) {
+            task->backoff *= 2;
+            if (task->backoff > ODS_SE_MAX_BACKOFF) {
+                task->backoff = ODS_SE_MAX_BACKOFF;
+            }
+        } else {
+            task->backoff = 60;
+        }
+        task->when = time_now() + task->backoff;
+        ods_log_info("[%s] backoff write for zone %s with %u seconds",
+            writer_str, job->name, task->backoff);
+        (void) schedule_task(engine->taskq, task, 0);
+    } else {
+        /* task is being worked on, it will be written anyway */
+        task = (task_type*) zone->task;
+        task->interrupt = TASK_WRITE;
+    }
+    lock_basic_unlock(&engine->taskq->schedule_lock);
+    lock_basic_unlock(&zone->zone_lock);
+    return;
+}
+
+
+/**
+ * Write one image and kick the nameserver.
+ *
+ */
+static void
+writer_write(writer_type* writer, writer_job_type* job)
+{
+    engine_type* engine = (engine_type*) writer->engine;
+    ods_status status = ODS_STATUS_OK;
+    char str[SYSTEM_MAXLEN];
+    uint64_t start = metrics_now();
+
+    ods_log_verbose("[%s] write zone %s serial %u to output file %s",
+        writer_str, job->name, job->serial, job->filename);
+    status = adfile_write_image(job->image, job->size, job->filename);
+    metrics_observe_since(METRIC_OUTPUT, start);
+    if (status != ODS_STATUS_OK) {
+        ods_log_error("[%s] unable to write zone %s serial %u: %s",
+            writer_str, job->name, job->serial, ods_status2str(status));
+        writer_retry(writer, job);
+        return;
+    }
+    /* kick the nameserver */
+    if (job->notify_ns) {
+        ods_log_verbose("[%s] notify nameserver: %s", writer_str,
+            job->notify_ns);
+        snprintf(str, SYSTEM_MAXLEN, "%s > /dev/null", job->notify_ns);
+        if (system(str)) {
+           ods_log_error("[%s] failed to notify nameserver", writer_str);
+        }
+    }
+    if (engine && engine->dnshandler) {
+        dnshandler_fwd_notify(engine->dnshandler, (uint8_t*) ODS_SE_NOTIFY_CMD,
+            strlen(ODS_SE_NOTIFY_CMD));
+    }
+    return;
+}
+
+
+/**
+ * Start writer.
+ *
+ */
+void
+writer_start(writer_type* writer)
+{
+    writer_job_type* job = NULL;
+    ods_log_assert(writer);
+    ods_log_debug("[%s] writer started", writer_str);
+    while (1) {
+        lock_basic_lock(&writer->q_lock);
+        while (!writer->first && !writer->need_to_exit) {
+            lock_basic_sleep(&writer->q_threshold, &writer->q_lock, 0);
+        }
+        job = writer->first;
+        if (!job) {
+            /* need to exit and nothing left to write */
+            lock_basic_unlock(&writer->q_lock);
+            break;
+        }
+        writer->first = job->next;
+        if (!writer->first) {
+            writer->last = NULL;
+        }
+        writer->count--;
+        job->next = NULL;
+        writer->current = job;
+        lock_basic_unlock(&writer->q_lock);
+
+        writer_write(writer, job);
+
+        lock_basic_lock(&writer->q_lock);
+        writer->current = NULL;
+        lock_basic_broadcast(&writer->q_done);
+        lock_basic_unlock(&writer->q_lock);
+        writer_job_cleanup(job);
+    }
+    ods_log_debug("[%s] writer stopped", writer_str);
+    return;
+}
+
+
+/**
+ * Queue a zone image.
+ *
+ */
+ods_status
+writer_queue(writer_type* writer, void* zone, const char* filename,
+    const char* notify_ns, uint32_t serial, char* image, size_t size)
+{
+    writer_job_type* job = NULL;
+    char* fname = NULL;
+    char* notify = NULL;
+    zone_type* z = (zone_type*) zone;
+
+    if (!writer || !zone || !filename) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    fname = strdup(filename);
+    notify = notify_ns ? strdup(notify_ns) : NULL;
+    if (!fname || (notify_ns && !notify)) {
+        free(fname);
+        free(notify);
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    lock_basic_lock(&writer->q_lock);
+    /* a newer image replaces a waiting one */
+    for (job = writer->first; job; job = job->next) {
+        if (job->zone == zone) {
+            ods_log_debug("[%s] replace queued serial %u of zone %s with "
+                "serial %u", writer_str, job->serial, job->name, serial);
+            free(job->image);
+            free(job->filename);
+            free(job->notify_ns);
+            break;
+        }
+    }
+    if (!job) {
+        job = (writer_job_type*) calloc(1, sizeof(writer_job_type));
+        if (job) {
+            job->name = strdup(z->name ? z->name : "(null)");
+        }
+        if (!job || !job->name) {
+            lock_basic_unlock(&writer->q_lock);
+            ods_log_error("[%s] unable to queue zone %s: malloc failed",
+                writer_str, z->name);
+            free(job);
+            free(fname);
+            free(notify);
+            return ODS_STATUS_MALLOC_ERR;
+        }
+        job->zone = zone;
+        if (writer->last) {
+            writer->last->next = job;
+        } else {
+            writer->first = job;
+        }
+        writer->last = job;
+        writer->count++;
+    }
+    job->filename = fname;
+    job->notify_ns = notify;
+    job->serial = serial;
+    job->image = image;
+    job->size = size;
+    lock_basic_alarm(&writer->q_threshold);
+    lock_basic_unlock(&writer->q_lock);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Is an image of this zone queued or being written?
+ *
+ */
+static int
+writer_busy(writer_type* writer, void* zone)
+{
+    writer_job_type* job = NULL;
+    if (writer->current && writer->current->zone == zone) {
+        return 1;
+    }
+    for (job = writer->first; job; job = job->next) {
+        if (job->zone == zone) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * Wait until no image of this zone is queued or being written.
+ *
+ */
+void
+writer_wait(writer_type* writer, void* zone)
+{
+    if (!writer || !zone) {
+        return;
+    }
+    lock_basic_lock(&writer->q_lock);
+    while (writer_busy(writer, zone)) {
+        if (!writer->started) {
+            /* nobody to write it */
+            break;
+        }
+        lock_basic_sleep(&writer->q_done, &writer->q_lock, 0);
+    }
+    lock_basic_unlock(&writer->q_lock);
+    return;
+}
+
+
+/**
+ * Signal writer to exit.
+ *
+ */
+void
+writer_signal(writer_type* writer)
+{
+    if (!writer) {
+        return;
+    }
+    lock_basic_lock(&writer->q_lock);
+    writer->need_to_exit = 1;
+    lock_basic_alarm(&writer->q_threshold);
+    lock_basic_unlock(&writer->q_lock);
+    return;
+}
+
+
+/**
+ * Clean up writer.
+ *
+ */
+void
+writer_cleanup(writer_type* writer)
+{
+    writer_job_type* job = NULL;
+    allocator_type* allocator = NULL;
+    if (!writer) {
+        return;
+    }
+    allocator = writer->allocator;
+    while (writer->first) {
+        job = writer->first;
+        writer->first = job->next;
+        writer_job_cleanup(job);
+    }
+    lock_basic_destroy(&writer->q_lock);
+    lock_basic_off(&writer->q_threshold);
+    lock_basic_off(&writer->q_done);
+    allocator_deallocate(allocator, (void*) writer);
+    return;
+}
@@ -0,0 +1,138 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Zone output writer.
+ *
+ */
+
+#ifndef DAEMON_WRITER_H
+#define DAEMON_WRITER_H
+
+#include "config.h"
+#include "shared/allocator.h"
+#include "shared/locks.h"
+#include "shared/status.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Output job: an immutable image of a signed zone.
+ *
+ */
+typedef struct writer_job_struct writer_job_type;
+struct writer_job_struct {
+    void* zone;
+    char* name;
+    char* filename;
+    char* notify_ns;
+    char* image;
+    size_t size;
+    uint32_t serial;
+    writer_job_type* next;
+};
+
+/**
+ * Zone output writer.
+ * Images are written by a dedicated thread, so that the zone lock can be
+ * released as soon as the zone is formatted. Per zone, there is at most
+ * one image being written and one image waiting: a newer image replaces
+ * the waiting one.
+ *
+ */
+typedef struct writer_struct writer_type;
+struct writer_struct {
+    allocator_type* allocator;
+    ods_thread_type thread_id;
+    void* engine;
+    writer_job_type* first;
+    writer_job_type* last;
+    writer_job_type* current;
+    size_t count;
+    int started;
+    int need_to_exit;
+    cond_basic_type q_threshold;
+    cond_basic_type q_done;
+    lock_basic_type q_lock;
+};
+
+/**
+ * Create writer.
+ * \param[in] allocator memory allocator
+ * \return writer_type* writer
+ *
+ */
+writer_type* writer_create(allocator_type* allocator);
+
+/**
+ * Start writer.
+ * \param[in] writer writer
+ *
+ */
+void writer_start(writer_type* writer);
+
+/**
+ * Queue a zone image. The writer takes ownership of the image.
+ * \param[in] writer writer
+ * \param[in] zone zone the image belongs to
+ * \param[in] filename output file
+ * \param[in] notify_ns command to notify the nameserver, or NULL
+ * \param[in] serial serial of the image
+ * \param[in] image zone image, allocated with malloc()
+ * \param[in] size size of the image
+ * \return ods_status status
+ *
+ */
+ods_status writer_queue(writer_type* writer, void* zone, const char* filename,
+    const char* notify_ns, uint32_t serial, char* image, size_t size);
+
+/**
+ * Wait until no image of this zone is queued or being written.
+ * \param[in] writer writer
+ * \param[in] zone zone
+ *
+ */
+void writer_wait(writer_type* writer, void* zone);
+
+/**
+ * Signal writer to exit. Pending images are written first.
+ * \param[in] writer writer
+ *
+ */
+void writer_signal(writer_type* writer);
+
+/**
+ * Clean up writer.
+ * \param[in] writer writer
+ *
+ */
+void writer_cleanup(writer_type* writer);
+
+#endif /* DAEMON_WRITER_H */
@@ -34,7 +34,9 @@
 #include "parser/confparser.h"
 #include "parser/zonelistparser.h"
 #include "shared/allocator.h"
+#include "shared/duration.h"
 #include "shared/file.h"
+#include "shared/locks.h"
 #include "shared/log.h"
 #include "shared/status.h"
 #include "wire/acl.h"
@@ -42,45 +44,49 @@
 #include <libxml/xpath.h>
 #include <libxml/relaxng.h>
 #include <libxml/xmlreader.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 
 static const char* parser_str = "parser";
 
 
+/** Maximum number of cached RelaxNG schemas. */
+#define PARSE_RNG_MAX 8
+
 /**
- * Parse elements from the configuration file.
+ * Compiled RelaxNG schema.
  *
  */
-ods_status
-parse_file_check(const char* cfgfile, const char* rngfile)
+typedef struct parse_rng_struct parse_rng_type;
+struct parse_rng_struct {
+    char* rngfile;
+    xmlRelaxNGPtr schema;
+};
+
+static parse_rng_type parse_rng_cache[PARSE_RNG_MAX];
+static size_t parse_rng_count = 0;
+static int parse_rng_initialized = 0;
+static lock_basic_type parse_rng_lock;
+
+
+/**
+ * Compile RelaxNG schema.
+ *
+ */
+static xmlRelaxNGPtr
+parse_rng_compile(const char* rngfile)
 {
-    xmlDocPtr doc = NULL;
     xmlDocPtr rngdoc = NULL;
     xmlRelaxNGParserCtxtPtr rngpctx = NULL;
-    xmlRelaxNGValidCtxtPtr rngctx = NULL;
     xmlRelaxNGPtr schema = NULL;
-    int status = 0;
 
-    if (!cfgfile || !rngfile) {
-        return ODS_STATUS_ASSERT_ERR;
-    }
-    ods_log_debug("[%s] check cfgfile %s with rngfile %s", parser_str,
-        cfgfile, rngfile);
-    /* Load XML document */
-    doc = xmlParseFile(cfgfile);
-    if (doc == NULL) {
-        ods_log_error("[%s] unable to parse file: failed to load cfgfile %s",
-            parser_str, cfgfile);
-        return ODS_STATUS_XML_ERR;
-    }
     /* Load rng document */
     rngdoc = xmlParseFile(rngfile);
     if (rngdoc == NULL) {
         ods_log_error("[%s] unable to parse file: failed to load rngfile %s",
             parser_str, rngfile);
-        xmlFreeDoc(doc);
-        return ODS_STATUS_XML_ERR;
+        return NULL;
     }
     /* Create an XML RelaxNGs parser context for the relax-ng document. */
     rngpctx = xmlRelaxNGNewDocParserCtxt(rngdoc);
@@ -88,8 +94,7 @@ parse_file_check(const char* cfgfile, const char* rngfile)
         ods_log_error("[%s] unable to parse file: "
            "xmlRelaxNGNewDocParserCtxt() failed", parser_str);
         xmlFreeDoc(rngdoc);
-        xmlFreeDoc(doc);
-        return ODS_STATUS_XML_ERR;
+        return NULL;
     }
     /* Parse a schema definition resource and
      * build an internal XML schema structure.
@@ -98,42 +103,167 @@ parse_file_check(const char* cfgfile, const char* rngfile)
     if (schema == NULL) {
         ods_log_error("[%s] unable to parse file: xmlRelaxNGParse() failed",
             parser_str);
-        xmlRelaxNGFreeParserCtxt(rngpctx);
-        xmlFreeDoc(rngdoc);
-        xmlFreeDoc(doc);
-        return ODS_STATUS_PARSE_ERR;
     }
+    xmlRelaxNGFreeParserCtxt(rngpctx);
+    xmlFreeDoc(rngdoc);
+    return schema;
+}
+
+
+/**
+ * Validate a document against a compiled RelaxNG schema.
+ *
+ */
+static ods_status
+parse_rng_validate(xmlDocPtr doc, xmlRelaxNGPtr schema)
+{
+    xmlRelaxNGValidCtxtPtr rngctx = NULL;
+    int status = 0;
+
     /* Create an XML RelaxNGs validation context. */
     rngctx = xmlRelaxNGNewValidCtxt(schema);
     if (rngctx == NULL) {
         ods_log_error("[%s] unable to parse file: xmlRelaxNGNewValidCtxt() "
             "failed", parser_str);
-        xmlRelaxNGFree(schema);
-        xmlRelaxNGFreeParserCtxt(rngpctx);
-        xmlFreeDoc(rngdoc);
-        xmlFreeDoc(doc);
         return ODS_STATUS_RNG_ERR;
     }
     /* Validate a document tree in memory. */
     status = xmlRelaxNGValidateDoc(rngctx,doc);
+    xmlRelaxNGFreeValidCtxt(rngctx);
     if (status != 0) {
         ods_log_error("[%s] unable to parse file: xmlRelaxNGValidateDoc() "
             "failed", parser_str);
-        xmlRelaxNGFreeValidCtxt(rngctx);
-        xmlRelaxNGFree(schema);
-        xmlRelaxNGFreeParserCtxt(rngpctx);
-        xmlFreeDoc(rngdoc);
-        xmlFreeDoc(doc);
         return ODS_STATUS_RNG_ERR;
     }
-    xmlRelaxNGFreeValidCtxt(rngctx);
-    xmlRelaxNGFree(schema);
-    xmlRelaxNGFreeParserCtxt(rngpctx);
-    xmlFreeDoc(rngdoc);
-    xmlFreeDoc(doc);
     return ODS_STATUS_OK;
 }
 
+
+/**
+ * Initialize the RelaxNG schema cache.
+ *
+ */
+void
+parse_rng_init(void)
+{
+    if (parse_rng_initialized) {
+        return;
+    }
+    lock_basic_init(&parse_rng_lock);
+    parse_rng_count = 0;
+    parse_rng_initialized = 1;
+    return;
+}
+
+
+/**
+ * Clean up the RelaxNG schema cache.
+ *
+ */
+void
+parse_rng_cleanup(void)
+{
+    size_t i = 0;
+    if (!parse_rng_initialized) {
+        return;
+    }
+    for (i = 0; i < parse_rng_count; i++) {
+        xmlRelaxNGFree(parse_rng_cache[i].schema);
+        free((void*) parse_rng_cache[i].rngfile);
+    }
+    parse_rng_count = 0;
+    parse_rng_initialized = 0;
+    lock_basic_destroy(&parse_rng_lock);
+    return;
+}
+
+
+/**
+ * Check document with rng file.
+ *
+ */
+ods_status
+parse_doc_check(xmlDocPtr doc, const char* rngfile)
+{
+    xmlRelaxNGPtr schema = NULL;
+    ods_status status = ODS_STATUS_OK;
+    size_t i = 0;
+
+    if (!doc || !rngfile) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    if (!parse_rng_initialized) {
+        /* no cache, compile every time */
+        schema = parse_rng_compile(rngfile);
+        if (!schema) {
+            return ODS_STATUS_PARSE_ERR;
+        }
+        status = parse_rng_validate(doc, schema);
+        xmlRelaxNGFree(schema);
+        return status;
+    }
+    /* the schema is shared, validate one document at a time */
+    lock_basic_lock(&parse_rng_lock);
+    for (i = 0; i < parse_rng_count; i++) {
+        if (strcmp(parse_rng_cache[i].rngfile, rngfile) == 0) {
+            schema = parse_rng_cache[i].schema;
+            break;
+        }
+    }
+    if (!schema) {
+        schema = parse_rng_compile(rngfile);
+        if (!schema) {
+            lock_basic_unlock(&parse_rng_lock);
+            return ODS_STATUS_PARSE_ERR;
+        }
+        if (parse_rng_count < PARSE_RNG_MAX) {
+            parse_rng_cache[parse_rng_count].rngfile = strdup(rngfile);
+            if (parse_rng_cache[parse_rng_count].rngfile) {
+                parse_rng_cache[parse_rng_count].schema = schema;
+                parse_rng_count++;
+            }
+        }
+        if (i == parse_rng_count) {
+            /* not cached */
+            status = parse_rng_validate(doc, schema);
+            xmlRelaxNGFree(schema);
+            lock_basic_unlock(&parse_rng_lock);
+            return status;
+        }
+    }
+    status = parse_rng_validate(doc, schema);
+    lock_basic_unlock(&parse_rng_lock);
+    return status;
+}
+
+
+/**
+ * Parse elements from the configuration file.
+ *
+ */
+ods_status
+parse_file_check(const char* cfgfile, const char* rngfile)
+{
+    xmlDocPtr doc = NULL;
+    ods_status status = ODS_STATUS_OK;
+
+    if (!cfgfile || !rngfile) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    ods_log_debug("[%s] check cfgfile %s with rngfile %s", parser_str,
+        cfgfile, rngfile);
+    /* Load XML document */
+    doc = xmlParseFile(cfgfile);
+    if (doc == NULL) {
+        ods_log_error("[%s] unable to parse file: failed to load cfgfile %s",
+            parser_str, cfgfile);
+        return ODS_STATUS_XML_ERR;
+    }
+    status = parse_doc_check(doc, rngfile);
+    xmlFreeDoc(doc);
+    return status;
+}
+
 /* TODO: look how the enforcer reads this now */
 
 
@@ -230,6 +360,43 @@ parse_conf_listener(allocator_type* allocator, const char* cfgfile)
 }
 
 
+/**
+ * Parse elements from a parsed document.
+ *
+ */
+const char*
+parse_xpath_string(xmlXPathContextPtr xpathCtx, const char* expr,
+    int required)
+{
+    xmlXPathObjectPtr xpathObj = NULL;
+    xmlChar *xexpr = NULL;
+    const char* string = NULL;
+
+    ods_log_assert(expr);
+    ods_log_assert(xpathCtx);
+
+    /* Get string */
+    xexpr = (unsigned char*) expr;
+    xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
+    if (xpathObj == NULL || xpathObj->nodesetval == NULL ||
+        xpathObj->nodesetval->nodeNr <= 0) {
+        if (required) {
+            ods_log_error("[%s] unable to evaluate expression %s in %s",
+                parser_str, (char*) xexpr,
+                xpathCtx->doc && xpathCtx->doc->URL ?
+                (const char*) xpathCtx->doc->URL : "document");
+        }
+        if (xpathObj) {
+            xmlXPathFreeObject(xpathObj);
+        }
+        return NULL;
+    }
+    string = (const char*) xmlXPathCastToString(xpathObj);
+    xmlXPathFreeObject(xpathObj);
+    return string;
+}
+
+
 /**
  * Parse elements from the configuration file.
  *
@@ -239,8 +406,6 @@ parse_conf_string(const char* cfgfile, const char* expr, int required)
 {
     xmlDocPtr doc = NULL;
     xmlXPathContextPtr xpathCtx = NULL;
-    xmlXPathObjectPtr xpathObj = NULL;
-    xmlChar *xexpr = NULL;
     const char* string = NULL;
 
     ods_log_assert(expr);
@@ -261,34 +426,10 @@ parse_conf_string(const char* cfgfile, const char* expr, int required)
         xmlFreeDoc(doc);
         return NULL;
     }
-    /* Get string */
-    xexpr = (unsigned char*) expr;
-    xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
-    if (xpathObj == NULL || xpathObj->nodesetval == NULL ||
-        xpathObj->nodesetval->nodeNr <= 0) {
-        if (required) {
-            ods_log_error("[%s] unable to evaluate expression %s in cfgile %s",
-                parser_str, (char*) xexpr, cfgfile);
-        }
-        xmlXPathFreeContext(xpathCtx);
-        if (xpathObj) {
-            xmlXPathFreeObject(xpathObj);
-        }
-        xmlFreeDoc(doc);
-        return NULL;
-    }
-    if (xpathObj->nodesetval != NULL &&
-        xpathObj->nodesetval->nodeNr > 0) {
-        string = (const char*) xmlXPathCastToString(xpathObj);
-        xmlXPathFreeContext(xpathCtx);
-        xmlXPathFreeObject(xpathObj);
-        xmlFreeDoc(doc);
-        return string;
-    }
+    string = parse_xpath_string(xpathCtx, expr, required);
     xmlXPathFreeContext(xpathCtx);
-    xmlXPathFreeObject(xpathObj);
     xmlFreeDoc(doc);
-    return NULL;
+    return string;
 }
 
 
@@ -382,6 +523,23 @@ parse_conf_notify_command(allocator_type* allocator, const char* cfgfile)
 }
 
 
+const char*
+parse_conf_metrics_filename(allocator_type* allocator, const char* cfgfile)
+{
+    const char* dup = NULL;
+    const char* str = parse_conf_string(
+        cfgfile,
+        "//Configuration/Signer/MetricsFile",
+        0);
+
+    if (str) {
+        dup = allocator_strdup(allocator, str);
+        free((void*)str);
+    }
+    return dup;
+}
+
+
 const char*
 parse_conf_clisock_filename(allocator_type* allocator, const char* cfgfile)
 {
@@ -540,3 +698,61 @@ parse_conf_signer_threads(const char* cfgfile)
     /* no SignerThreads value configured, look at WorkerThreads */
     return parse_conf_worker_threads(cfgfile);
 }
+
+
+time_t
+parse_conf_refresh_batch(const char* cfgfile)
+{
+    time_t batch = 0;
+    duration_type* duration = NULL;
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Signer/RefreshBatch",
+        0);
+    if (str) {
+        duration = duration_create_from_string(str);
+        if (duration) {
+            batch = duration2time(duration);
+            duration_cleanup(duration);
+        } else {
+            ods_log_error("[%s] invalid RefreshBatch duration %s, not "
+                "batching signature refreshes", parser_str, str);
+        }
+        free((void*)str);
+    }
+    return batch;
+}
+
+
+int
+parse_conf_spread_signatures(const char* cfgfile)
+{
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Signer/SpreadSignatures",
+        0);
+    if (str) {
+        free((void*)str);
+        return 1;
+    }
+    return 0;
+}
+
+
+int
+parse_conf_resign_slice(const char* cfgfile)
+{
+    long slice = 0;
+    char* end = NULL;
+    const char* str = parse_conf_string(cfgfile,
+        "//Configuration/Signer/ResignSlice",
+        0);
+    if (str) {
+        slice = strtol(str, &end, 10);
+        if (end == str || *end != '\0' || slice <= 0 || slice > INT_MAX) {
+            ods_log_error("[%s] invalid ResignSlice %s, not limiting "
+                "signature refreshes", parser_str, str);
+            slice = 0;
+        }
+        free((void*)str);
+    }
+    return (int) slice;
+}
@@ -39,8 +39,36 @@
 #include "shared/allocator.h"
 #include "shared/status.h"
 
+#include <libxml/tree.h>
+#include <libxml/xpath.h>
+#include <time.h>
+
 #define ADMAX 6 /* Maximum number of adapters that can be initialized */
 
+/**
+ * Initialize the RelaxNG schema cache.
+ * Schemas are compiled once and reused for every file checked against
+ * them. Without the cache, parse_file_check() compiles the schema on
+ * every call.
+ *
+ */
+void parse_rng_init(void);
+
+/**
+ * Clean up the RelaxNG schema cache.
+ *
+ */
+void parse_rng_cleanup(void);
+
+/**
+ * Check parsed document with rng file.
+ * \param[in] doc the parsed document
+ * \param[in] rngfile the rng file name
+ * \return ods_status status
+ *
+ */
+ods_status parse_doc_check(xmlDocPtr doc, const char* rngfile);
+
 /**
  * Check config file with rng file.
  * \param[in] cfgfile the configuration file name
@@ -61,6 +89,17 @@ ods_status parse_file_check(const char* cfgfile, const char* rngfile);
 const char* parse_conf_string(const char* cfgfile, const char* expr,
     int required);
 
+/**
+ * Parse elements from a parsed document.
+ * \param[in] xpathCtx xpath evaluation context of the document
+ * \param[in] expr xml expression
+ * \param[in] required if the element is required
+ * \return const char* string value
+ *
+ */
+const char* parse_xpath_string(xmlXPathContextPtr xpathCtx, const char* expr,
+    int required);
+
 /**
  * Parse the listener interfaces.
  * \param[in] allocator the allocator
@@ -92,6 +131,8 @@ const char* parse_conf_pid_filename(allocator_type* allocator,
     const char* cfgfile);
 const char* parse_conf_notify_command(allocator_type* allocator,
     const char* cfgfile);
+const char* parse_conf_metrics_filename(allocator_type* allocator,
+    const char* cfgfile);
 const char* parse_conf_clisock_filename(allocator_type* allocator,
     const char* cfgfile);
 const char* parse_conf_working_dir(allocator_type* allocator,
@@ -117,5 +158,8 @@ int parse_conf_verbosity(const char* cfgfile);
 /** Signer specific */
 int parse_conf_worker_threads(const char* cfgfile);
 int parse_conf_signer_threads(const char* cfgfile);
+time_t parse_conf_refresh_batch(const char* cfgfile);
+int parse_conf_spread_signatures(const char* cfgfile);
+int parse_conf_resign_slice(const char* cfgfile);
 
 #endif /* PARSE_CONFPARSER_H */
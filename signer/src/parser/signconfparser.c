@@ -51,10 +51,8 @@ static const char* parser_str = "parser";
  *
  */
 keylist_type*
-parse_sc_keys(void* sc, const char* cfgfile)
+parse_sc_keys(void* sc, xmlXPathContextPtr xpathCtx)
 {
-    xmlDocPtr doc = NULL;
-    xmlXPathContextPtr xpathCtx = NULL;
     xmlXPathObjectPtr xpathObj = NULL;
     xmlNode* curNode = NULL;
     xmlChar* xexpr = NULL;
@@ -65,30 +63,13 @@ parse_sc_keys(void* sc, const char* cfgfile)
     char* algorithm = NULL;
     int ksk, zsk, publish, i;
 
-    if (!cfgfile || !sc) {
-        return NULL;
-    }
-    /* Load XML document */
-    doc = xmlParseFile(cfgfile);
-    if (doc == NULL) {
-        ods_log_error("[%s] unable to parse <Keys>: "
-            "xmlParseFile() failed", parser_str);
-        return NULL;
-    }
-    /* Create xpath evaluation context */
-    xpathCtx = xmlXPathNewContext(doc);
-    if(xpathCtx == NULL) {
-        xmlFreeDoc(doc);
-        ods_log_error("[%s] unable to parse <Keys>: "
-            "xmlXPathNewContext() failed", parser_str);
+    if (!xpathCtx || !sc) {
         return NULL;
     }
     /* Evaluate xpath expression */
     xexpr = (xmlChar*) "//SignerConfiguration/Zone/Keys/Key";
     xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
     if(xpathObj == NULL) {
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
         ods_log_error("[%s] unable to parse <Keys>: "
             "xmlXPathEvalExpression() failed", parser_str);
         return NULL;
@@ -150,10 +131,6 @@ parse_sc_keys(void* sc, const char* cfgfile)
         }
     }
     xmlXPathFreeObject(xpathObj);
-    xmlXPathFreeContext(xpathCtx);
-    if (doc) {
-        xmlFreeDoc(doc);
-    }
     return kl;
 }
 
@@ -163,10 +140,10 @@ parse_sc_keys(void* sc, const char* cfgfile)
  *
  */
 duration_type*
-parse_sc_sig_resign_interval(const char* cfgfile)
+parse_sc_sig_resign_interval(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/Resign",
         1);
     if (!str) {
@@ -179,10 +156,10 @@ parse_sc_sig_resign_interval(const char* cfgfile)
 
 
 duration_type*
-parse_sc_sig_refresh_interval(const char* cfgfile)
+parse_sc_sig_refresh_interval(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/Refresh",
         1);
     if (!str) {
@@ -195,10 +172,10 @@ parse_sc_sig_refresh_interval(const char* cfgfile)
 
 
 duration_type*
-parse_sc_sig_validity_default(const char* cfgfile)
+parse_sc_sig_validity_default(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/Validity/Default",
         1);
     if (!str) {
@@ -211,10 +188,10 @@ parse_sc_sig_validity_default(const char* cfgfile)
 
 
 duration_type*
-parse_sc_sig_validity_denial(const char* cfgfile)
+parse_sc_sig_validity_denial(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/Validity/Denial",
         1);
     if (!str) {
@@ -227,10 +204,10 @@ parse_sc_sig_validity_denial(const char* cfgfile)
 
 
 duration_type*
-parse_sc_sig_jitter(const char* cfgfile)
+parse_sc_sig_jitter(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/Jitter",
         1);
     if (!str) {
@@ -243,10 +220,10 @@ parse_sc_sig_jitter(const char* cfgfile)
 
 
 duration_type*
-parse_sc_sig_inception_offset(const char* cfgfile)
+parse_sc_sig_inception_offset(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/InceptionOffset",
         1);
     if (!str) {
@@ -259,10 +236,10 @@ parse_sc_sig_inception_offset(const char* cfgfile)
 
 
 duration_type*
-parse_sc_dnskey_ttl(const char* cfgfile)
+parse_sc_dnskey_ttl(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Keys/TTL",
         1);
     if (!str) {
@@ -275,10 +252,10 @@ parse_sc_dnskey_ttl(const char* cfgfile)
 
 
 duration_type*
-parse_sc_soa_ttl(const char* cfgfile)
+parse_sc_soa_ttl(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/SOA/TTL",
         1);
     if (!str) {
@@ -291,10 +268,10 @@ parse_sc_soa_ttl(const char* cfgfile)
 
 
 duration_type*
-parse_sc_soa_min(const char* cfgfile)
+parse_sc_soa_min(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/SOA/Minimum",
         1);
     if (!str) {
@@ -307,10 +284,10 @@ parse_sc_soa_min(const char* cfgfile)
 
 
 duration_type*
-parse_sc_max_zone_ttl(const char* cfgfile)
+parse_sc_max_zone_ttl(xmlXPathContextPtr xpathCtx)
 {
     duration_type* duration = NULL;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Signatures/MaxZoneTTL",
         1);
     if (!str) {
@@ -327,16 +304,16 @@ parse_sc_max_zone_ttl(const char* cfgfile)
  *
  */
 ldns_rr_type
-parse_sc_nsec_type(const char* cfgfile)
+parse_sc_nsec_type(xmlXPathContextPtr xpathCtx)
 {
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC3",
         0);
     if (str) {
         free((void*)str);
         return LDNS_RR_TYPE_NSEC3;
     }
-    str = parse_conf_string(cfgfile,
+    str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC",
         0);
     if (str) {
@@ -352,10 +329,10 @@ parse_sc_nsec_type(const char* cfgfile)
  *
  */
 uint32_t
-parse_sc_nsec3_algorithm(const char* cfgfile)
+parse_sc_nsec3_algorithm(xmlXPathContextPtr xpathCtx)
 {
     int ret = 0;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Algorithm",
         1);
     if (str) {
@@ -369,10 +346,10 @@ parse_sc_nsec3_algorithm(const char* cfgfile)
 
 
 uint32_t
-parse_sc_nsec3_iterations(const char* cfgfile)
+parse_sc_nsec3_iterations(xmlXPathContextPtr xpathCtx)
 {
     int ret = 0;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Iterations",
         1);
     if (str) {
@@ -386,10 +363,10 @@ parse_sc_nsec3_iterations(const char* cfgfile)
 
 
 int
-parse_sc_nsec3_optout(const char* cfgfile)
+parse_sc_nsec3_optout(xmlXPathContextPtr xpathCtx)
 {
     int ret = 0;
-    const char* str = parse_conf_string(cfgfile,
+    const char* str = parse_xpath_string(xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC3/OptOut",
         0);
     if (str) {
@@ -405,11 +382,12 @@ parse_sc_nsec3_optout(const char* cfgfile)
  *
  */
 const char*
-parse_sc_soa_serial(allocator_type* allocator, const char* cfgfile)
+parse_sc_soa_serial(allocator_type* allocator,
+    xmlXPathContextPtr xpathCtx)
 {
     const char* dup = NULL;
-    const char* str = parse_conf_string(
-        cfgfile,
+    const char* str = parse_xpath_string(
+        xpathCtx,
         "//SignerConfiguration/Zone/SOA/Serial",
         1);
 
@@ -422,11 +400,12 @@ parse_sc_soa_serial(allocator_type* allocator, const char* cfgfile)
 
 
 const char*
-parse_sc_nsec3_salt(allocator_type* allocator, const char* cfgfile)
+parse_sc_nsec3_salt(allocator_type* allocator,
+    xmlXPathContextPtr xpathCtx)
 {
     const char* dup = NULL;
-    const char* str = parse_conf_string(
-        cfgfile,
+    const char* str = parse_xpath_string(
+        xpathCtx,
         "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Salt",
         1);
 
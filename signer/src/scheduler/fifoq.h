@@ -40,6 +40,7 @@
 #include "shared/locks.h"
 #include "shared/status.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <time.h>
 
@@ -63,6 +64,7 @@ struct fifoq_struct {
     allocator_type* allocator;
     void* blob[FIFOQ_MAX_COUNT];
     worker_type* owner[FIFOQ_MAX_COUNT];
+    uint64_t pushed[FIFOQ_MAX_COUNT]; /* to measure waiting time */
     size_t count;
     lock_basic_type q_lock;
     cond_basic_type q_threshold;
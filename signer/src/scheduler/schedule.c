@@ -38,9 +38,13 @@
 #include "shared/log.h"
 
 #include <ldns/ldns.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char* schedule_str = "scheduler";
 
+#define SCHEDULE_INITIAL_CAPACITY 64
+
 
 /**
  * Create new schedule.
@@ -63,9 +67,15 @@ schedule_create(allocator_type* allocator)
     schedule->allocator = allocator;
     schedule->loading = 0;
     schedule->flushcount = 0;
-    schedule->tasks = ldns_rbtree_create(task_compare);
+    schedule->seq = 0;
+    schedule->count = 0;
+    schedule->capacity = SCHEDULE_INITIAL_CAPACITY;
+    schedule->flush_first = NULL;
+    schedule->flush_last = NULL;
+    schedule->tasks = (task_type**) allocator_alloc(allocator,
+        schedule->capacity * sizeof(task_type*));
     if (!schedule->tasks) {
-        ods_log_error("[%s] unable to create schedule: ldns_rbtree_create() "
+        ods_log_error("[%s] unable to create schedule: allocator_alloc() "
             "failed", schedule_str);
         allocator_deallocate(allocator, (void*) schedule);
         return NULL;
@@ -75,6 +85,178 @@ schedule_create(allocator_type* allocator)
 }
 
 
+/**
+ * Put task at position i in the time queue.
+ *
+ */
+static void
+heap_set(schedule_type* schedule, size_t i, task_type* task)
+{
+    schedule->tasks[i] = task;
+    task->index = i + 1;
+    return;
+}
+
+
+/**
+ * Move task at position i up the time queue.
+ *
+ */
+static void
+heap_up(schedule_type* schedule, size_t i)
+{
+    task_type* task = schedule->tasks[i];
+    size_t parent = 0;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (task_compare(schedule->tasks[parent], task) <= 0) {
+            break;
+        }
+        heap_set(schedule, i, schedule->tasks[parent]);
+        i = parent;
+    }
+    heap_set(schedule, i, task);
+    return;
+}
+
+
+/**
+ * Move task at position i down the time queue.
+ *
+ */
+static void
+heap_down(schedule_type* schedule, size_t i)
+{
+    task_type* task = schedule->tasks[i];
+    size_t child = 0;
+    while ((child = 2 * i + 1) < schedule->count) {
+        if (child + 1 < schedule->count &&
+            task_compare(schedule->tasks[child + 1],
+            schedule->tasks[child]) < 0) {
+            child++;
+        }
+        if (task_compare(task, schedule->tasks[child]) <= 0) {
+            break;
+        }
+        heap_set(schedule, i, schedule->tasks[child]);
+        i = child;
+    }
+    heap_set(schedule, i, task);
+    return;
+}
+
+
+/**
+ * Add task to the time queue.
+ *
+ */
+static ods_status
+heap_insert(schedule_type* schedule, task_type* task)
+{
+    task_type** tasks = NULL;
+    if (schedule->count == schedule->capacity) {
+        tasks = (task_type**) allocator_alloc(schedule->allocator,
+            2 * schedule->capacity * sizeof(task_type*));
+        if (!tasks) {
+            return ODS_STATUS_MALLOC_ERR;
+        }
+        memcpy(tasks, schedule->tasks,
+            schedule->count * sizeof(task_type*));
+        allocator_deallocate(schedule->allocator, (void*) schedule->tasks);
+        schedule->tasks = tasks;
+        schedule->capacity *= 2;
+    }
+    heap_set(schedule, schedule->count, task);
+    schedule->count++;
+    heap_up(schedule, schedule->count - 1);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Remove task from the time queue.
+ *
+ */
+static void
+heap_remove(schedule_type* schedule, task_type* task)
+{
+    size_t i = task->index - 1;
+    task_type* last = NULL;
+    ods_log_assert(task->index > 0 && i < schedule->count);
+    ods_log_assert(schedule->tasks[i] == task);
+    task->index = 0;
+    schedule->count--;
+    if (i == schedule->count) {
+        return;
+    }
+    last = schedule->tasks[schedule->count];
+    heap_set(schedule, i, last);
+    if (i > 0 && task_compare(last, schedule->tasks[(i - 1) / 2]) < 0) {
+        heap_up(schedule, i);
+    } else {
+        heap_down(schedule, i);
+    }
+    return;
+}
+
+
+/**
+ * Append task to the flush queue.
+ *
+ */
+static void
+flush_append(schedule_type* schedule, task_type* task)
+{
+    task->flush = 1;
+    task->flush_next = NULL;
+    task->flush_prev = schedule->flush_last;
+    if (schedule->flush_last) {
+        schedule->flush_last->flush_next = task;
+    } else {
+        schedule->flush_first = task;
+    }
+    schedule->flush_last = task;
+    schedule->flushcount++;
+    return;
+}
+
+
+/**
+ * Remove task from the flush queue.
+ *
+ */
+static void
+flush_remove(schedule_type* schedule, task_type* task)
+{
+    if (task->flush_prev) {
+        task->flush_prev->flush_next = task->flush_next;
+    } else {
+        schedule->flush_first = task->flush_next;
+    }
+    if (task->flush_next) {
+        task->flush_next->flush_prev = task->flush_prev;
+    } else {
+        schedule->flush_last = task->flush_prev;
+    }
+    task->flush_prev = NULL;
+    task->flush_next = NULL;
+    task->flush = 0;
+    schedule->flushcount--;
+    return;
+}
+
+
+/**
+ * Compare tasks referenced from an array.
+ *
+ */
+static int
+task_compare_ref(const void* a, const void* b)
+{
+    return task_compare(*(task_type* const*) a, *(task_type* const*) b);
+}
+
+
 /**
  * Flush schedule.
  *
@@ -82,41 +264,35 @@ schedule_create(allocator_type* allocator)
 void
 schedule_flush(schedule_type* schedule, task_id override)
 {
-    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
     task_type* task = NULL;
+    size_t i = 0;
 
     ods_log_debug("[%s] flush all tasks", schedule_str);
     if (!schedule || !schedule->tasks) {
         return;
     }
-    node = ldns_rbtree_first(schedule->tasks);
-    while (node && node != LDNS_RBTREE_NULL) {
-        task = (task_type*) node->data;
-        task->flush = 1;
-        schedule->flushcount++;
+    /* tasks that are already flushed keep their place */
+    for (task = schedule->flush_first; task; task = task->flush_next) {
+        if (override != TASK_NONE) {
+            task->what = override;
+        }
+    }
+    /* the others follow, in the order they were due */
+    qsort(schedule->tasks, schedule->count, sizeof(task_type*),
+        task_compare_ref);
+    for (i=0; i < schedule->count; i++) {
+        task = schedule->tasks[i];
+        task->index = 0;
         if (override != TASK_NONE) {
             task->what = override;
         }
-        node = ldns_rbtree_next(node);
+        flush_append(schedule, task);
     }
+    schedule->count = 0;
     return;
 }
 
 
-/**
- * Convert task to a tree node.
- *
- */
-static ldns_rbnode_t*
-task2node(task_type* task)
-{
-    ldns_rbnode_t* node = (ldns_rbnode_t*) malloc(sizeof(ldns_rbnode_t));
-    node->key = task;
-    node->data = task;
-    return node;
-}
-
-
 /**
  * Look up task.
  *
@@ -124,17 +300,15 @@ task2node(task_type* task)
 task_type*
 schedule_lookup_task(schedule_type* schedule, task_type* task)
 {
-    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
-    task_type* lookup = NULL;
     if (!schedule || !task) {
         return NULL;
     }
     ods_log_assert(schedule->tasks);
-    node = ldns_rbtree_search(schedule->tasks, task);
-    if (node && node != LDNS_RBTREE_NULL) {
-        lookup = (task_type*) node->data;
+    /* a task is in the time queue or, when flushed, in the flush queue */
+    if (task->index > 0 || task->flush) {
+        return task;
     }
-    return lookup;
+    return NULL;
 }
 
 
@@ -145,8 +319,7 @@ schedule_lookup_task(schedule_type* schedule, task_type* task)
 ods_status
 schedule_task(schedule_type* schedule, task_type* task, int log)
 {
-    ldns_rbnode_t* new_node = NULL;
-    ldns_rbnode_t* ins_node = NULL;
+    ods_status status = ODS_STATUS_OK;
     if (!task || !schedule || !schedule->tasks) {
         return ODS_STATUS_ASSERT_ERR;
     }
@@ -158,18 +331,14 @@ schedule_task(schedule_type* schedule, task_type* task, int log)
             task_who2str(task));
         return ODS_STATUS_ERR;
     }
-    new_node = task2node(task);
-    ins_node = ldns_rbtree_insert(schedule->tasks, new_node);
-    if (!ins_node) {
+    task->seq = schedule->seq++;
+    status = heap_insert(schedule, task);
+    if (status != ODS_STATUS_OK) {
         ods_log_error("[%s] unable to schedule task %s for zone %s: "
             " insert failed", schedule_str, task_what2str(task->what),
             task_who2str(task));
-        free((void*)new_node);
         return ODS_STATUS_ERR;
     }
-    if (task->flush) {
-        schedule->flushcount++;
-    }
     if (log) {
         task_log(task);
     }
@@ -184,28 +353,22 @@ schedule_task(schedule_type* schedule, task_type* task, int log)
 task_type*
 unschedule_task(schedule_type* schedule, task_type* task)
 {
-    ldns_rbnode_t* del_node = LDNS_RBTREE_NULL;
-    task_type* del_task = NULL;
     if (!task || !schedule || !schedule->tasks) {
         return NULL;
     }
     ods_log_debug("[%s] unschedule task %s for zone %s",
         schedule_str, task_what2str(task->what), task_who2str(task));
-    del_node = ldns_rbtree_delete(schedule->tasks, (const void*) task);
-    if (del_node) {
-        del_task = (task_type*) del_node->data;
-        free((void*)del_node);
+    if (task->flush) {
+        flush_remove(schedule, task);
+    } else if (task->index > 0) {
+        heap_remove(schedule, task);
     } else {
         ods_log_warning("[%s] unable to unschedule task %s for zone %s: not "
             "scheduled", schedule_str, task_what2str(task->what),
             task_who2str(task));
         return NULL;
     }
-    if (del_task->flush) {
-        del_task->flush = 0;
-        schedule->flushcount--;
-    }
-    return del_task;
+    return task;
 }
 
 
@@ -238,36 +401,16 @@ reschedule_task(schedule_type* schedule, task_type* task, task_id what,
 task_type*
 schedule_get_first_task(schedule_type* schedule)
 {
-    ldns_rbnode_t* first_node = LDNS_RBTREE_NULL;
-    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
-    task_type* pop = NULL;
     if (!schedule || !schedule->tasks) {
         return NULL;
     }
-    first_node = ldns_rbtree_first(schedule->tasks);
-    if (!first_node) {
-        return NULL;
+    if (schedule->flush_first) {
+        return schedule->flush_first;
     }
-    if (schedule->flushcount > 0) {
-        /* find remaining to be flushed tasks */
-        node = first_node;
-        while (node && node != LDNS_RBTREE_NULL) {
-            pop = (task_type*) node->data;
-            if (pop->flush) {
-                return pop;
-            }
-            node = ldns_rbtree_next(node);
-        }
-        /* no more to be flushed tasks found */
-        ods_log_warning("[%s] unable to get first scheduled task: could not "
-            "find flush-task, while there should be %i flush-tasks left",
-            schedule_str, schedule->flushcount);
-        ods_log_info("[%s] reset flush count to 0", schedule_str);
-        schedule->flushcount = 0;
-    }
-    /* no more tasks to be flushed, return first task in schedule */
-    pop = (task_type*) first_node->data;
-    return pop;
+    if (schedule->count > 0) {
+        return schedule->tasks[0];
+    }
+    return NULL;
 }
 
 
@@ -300,45 +443,76 @@ schedule_pop_task(schedule_type* schedule)
 
 
 /**
- * Print schedule.
+ * Number of scheduled tasks.
  *
  */
-void
-schedule_print(FILE* out, schedule_type* schedule)
+size_t
+schedule_size(schedule_type* schedule)
+{
+    if (!schedule || !schedule->tasks) {
+        return 0;
+    }
+    return schedule->count + (size_t) schedule->flushcount;
+}
+
+
+/**
+ * List scheduled tasks in the order they will be executed.
+ *
+ */
+task_type**
+schedule_list(schedule_type* schedule, size_t* count)
 {
-    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
+    task_type** list = NULL;
     task_type* task = NULL;
+    size_t size = 0;
+    size_t i = 0;
 
-    if (!out || !schedule || !schedule->tasks) {
-        return;
+    if (count) {
+        *count = 0;
     }
-    node = ldns_rbtree_first(schedule->tasks);
-    while (node && node != LDNS_RBTREE_NULL) {
-        task = (task_type*) node->data;
-        task_print(out, task);
-        node = ldns_rbtree_next(node);
+    size = schedule_size(schedule);
+    if (!size) {
+        return NULL;
     }
-    fprintf(out, "\n");
-    return;
+    list = (task_type**) malloc(size * sizeof(task_type*));
+    if (!list) {
+        ods_log_error("[%s] unable to list schedule: malloc() failed",
+            schedule_str);
+        return NULL;
+    }
+    for (task = schedule->flush_first; task; task = task->flush_next) {
+        list[i++] = task;
+    }
+    memcpy(&list[i], schedule->tasks, schedule->count * sizeof(task_type*));
+    qsort(&list[i], schedule->count, sizeof(task_type*), task_compare_ref);
+    if (count) {
+        *count = size;
+    }
+    return list;
 }
 
 
 /**
- * Internal task cleanup function.
+ * Print schedule.
  *
  */
-static void
-task_delfunc(ldns_rbnode_t* elem)
+void
+schedule_print(FILE* out, schedule_type* schedule)
 {
-    task_type* task;
+    task_type** list = NULL;
+    size_t count = 0;
+    size_t i = 0;
 
-    if (elem && elem != LDNS_RBTREE_NULL) {
-        task = (task_type*) elem->data;
-        task_delfunc(elem->left);
-        task_delfunc(elem->right);
-        task_cleanup(task);
-        free((void*)elem);
+    if (!out || !schedule || !schedule->tasks) {
+        return;
+    }
+    list = schedule_list(schedule, &count);
+    for (i=0; i < count; i++) {
+        task_print(out, list[i]);
     }
+    free((void*) list);
+    fprintf(out, "\n");
     return;
 }
 
@@ -352,17 +526,27 @@ schedule_cleanup(schedule_type* schedule)
 {
     allocator_type* allocator;
     lock_basic_type schedule_lock;
+    task_type* task = NULL;
+    size_t i = 0;
 
     if (!schedule) {
         return;
     }
     ods_log_debug("[%s] cleanup schedule", schedule_str);
+    allocator = schedule->allocator;
+    while (schedule->flush_first) {
+        task = schedule->flush_first;
+        schedule->flush_first = task->flush_next;
+        task_cleanup(task);
+    }
+    schedule->flush_last = NULL;
     if (schedule->tasks) {
-        task_delfunc(schedule->tasks->root);
-        ldns_rbtree_free(schedule->tasks);
+        for (i=0; i < schedule->count; i++) {
+            task_cleanup(schedule->tasks[i]);
+        }
+        allocator_deallocate(allocator, (void*) schedule->tasks);
         schedule->tasks = NULL;
     }
-    allocator = schedule->allocator;
     schedule_lock = schedule->schedule_lock;
     allocator_deallocate(allocator, (void*) schedule);
     lock_basic_destroy(&schedule_lock);
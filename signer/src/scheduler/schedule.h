@@ -55,12 +55,22 @@
 
 /**
  * Task schedule.
+ *
+ * Tasks are kept in a binary min-heap ordered on time (the time queue), so
+ * that scheduling, unscheduling and popping a task are O(log n). Tasks that
+ * are flushed move to a separate first-in first-out queue (the flush queue),
+ * which is served before the time queue in O(1).
  */
 typedef struct schedule_struct schedule_type;
 struct schedule_struct {
     allocator_type* allocator;
-    ldns_rbtree_t* tasks;
+    task_type** tasks; /* time queue */
+    size_t count;
+    size_t capacity;
+    task_type* flush_first; /* flush queue */
+    task_type* flush_last;
     int flushcount;
+    uint64_t seq;
     int loading; /* to determine backoff */
     lock_basic_type schedule_lock;
 };
@@ -137,6 +147,23 @@ task_type* schedule_pop_task(schedule_type* schedule);
  */
 task_type* schedule_get_first_task(schedule_type* schedule);
 
+/**
+ * Number of scheduled tasks.
+ * \param[in] schedule schedule
+ * \return size_t number of tasks in the time and flush queue
+ *
+ */
+size_t schedule_size(schedule_type* schedule);
+
+/**
+ * List scheduled tasks in the order they will be executed.
+ * \param[in] schedule schedule
+ * \param[out] count number of tasks listed
+ * \return task_type** array of tasks, to be freed with free(), or NULL
+ *
+ */
+task_type** schedule_list(schedule_type* schedule, size_t* count);
+
 /**
  * Print schedule.
  * \param[in] out file descriptor
@@ -78,6 +78,10 @@ task_create(task_id what, time_t when, void* zone)
     task->backoff = 0;
     task->flush = 0;
     task->zone = zone;
+    task->index = 0;
+    task->seq = 0;
+    task->flush_prev = NULL;
+    task->flush_next = NULL;
     return task;
 }
 
@@ -116,28 +120,21 @@ task_compare(const void* a, const void* b)
 {
     task_type* x = (task_type*)a;
     task_type* y = (task_type*)b;
-    zone_type* zx = NULL;
-    zone_type* zy = NULL;
 
     ods_log_assert(x);
     ods_log_assert(y);
-    zx = (zone_type*) x->zone;
-    zy = (zone_type*) y->zone;
-    if (!ldns_dname_compare((const void*) zx->apex,
-        (const void*) zy->apex)) {
-        /* if dname is the same, consider the same task */
-        return 0;
-    }
-    /* order task on time, what to do, dname */
+    /* order task on time, what to do, scheduling order */
     if (x->when != y->when) {
-        return (int) x->when - y->when;
+        return x->when < y->when ? -1 : 1;
     }
     if (x->what != y->what) {
         return (int) x->what - y->what;
     }
-    /* this is unfair, it prioritizes zones that are first in canonical line */
-    return ldns_dname_compare((const void*) zx->apex,
-        (const void*) zy->apex);
+    /* first come, first served: no zone is favoured over another */
+    if (x->seq != y->seq) {
+        return x->seq < y->seq ? -1 : 1;
+    }
+    return 0;
 }
 
 
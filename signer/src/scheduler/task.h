@@ -37,6 +37,8 @@
 #include "config.h"
 #include "shared/allocator.h"
 
+#include <stdint.h>
+
 #include <ldns/ldns.h>
 
 enum task_id_enum {
@@ -63,6 +65,11 @@ struct task_struct {
     time_t backoff;
     int flush;
     void* zone;
+    /* schedule bookkeeping */
+    size_t index; /* position in the time queue plus one, 0 if not in it */
+    uint64_t seq; /* scheduling order, for tasks due at the same time */
+    task_type* flush_prev; /* neighbours in the flush queue */
+    task_type* flush_next;
 };
 
 /**
@@ -84,7 +91,8 @@ task_type* task_create(task_id what, time_t when, void* zone);
 void task_backup(FILE* fd, task_type* task);
 
 /**
- * Compare tasks.
+ * Compare tasks on the order in which they should be executed: time, what to
+ * do and then the order in which they were scheduled.
  * \param[in] a one task
  * \param[in] b another task
  * \return int -1, 0 or 1
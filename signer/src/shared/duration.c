@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <time.h>
 
 static const char* duration_str = "duration";
@@ -483,6 +484,21 @@ time_now(void)
 }
 
 
+/**
+ * Return the time since Epoch, measured in milliseconds.
+ *
+ */
+uint64_t
+time_now_ms(void)
+{
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) != 0) {
+        return ((uint64_t) time(NULL)) * 1000;
+    }
+    return ((uint64_t) tv.tv_sec) * 1000 + ((uint64_t) tv.tv_usec) / 1000;
+}
+
+
 /**
  * copycode: This code is based on the EXAMPLE in the strftime manual.
  *
@@ -149,6 +149,14 @@ uint32_t time_datestamp(time_t tt, const char* format, char** str);
  */
 time_t time_now(void);
 
+/**
+ * Return the time since Epoch, measured in milliseconds.
+ * Meant for measuring how long things take, timeshift is not applied.
+ * \return uint64_t now in milliseconds.
+ *
+ */
+uint64_t time_now_ms(void);
+
 /**
  * Clean up duration.
  * \param[in] duration duration to be cleaned up
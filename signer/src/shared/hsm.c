@@ -34,6 +34,7 @@
 #include "daemon/engine.h"
 #include "shared/hsm.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 
 static const char* hsm_str = "hsm";
 
@@ -224,6 +225,7 @@ lhsm_sign(hsm_ctx_t* ctx, ldns_rr_list* rrset, key_type* key_id,
     ldns_rr* result = NULL;
     hsm_sign_params_t* params = NULL;
     int retries = 0;
+    uint64_t start = 0;
 
     if (!owner || !key_id || !rrset || !inception || !expiration) {
         ods_log_error("[%s] unable to sign: missing required elements",
@@ -264,9 +266,14 @@ lhsm_sign_start:
     ods_log_debug("[%s] sign RRset[%i] with key %s tag %u", hsm_str,
         ldns_rr_get_type(ldns_rr_list_rr(rrset, 0)),
         key_id->locator?key_id->locator:"(null)", params->keytag);
+    start = metrics_now();
     result = hsm_sign_rrset(ctx, rrset, key_id->hsmkey, params);
+    metrics_observe_since(METRIC_HSM_SIGN, start);
     hsm_sign_params_free(params);
-    if (!result) {
+    if (result) {
+        metrics_count(COUNTER_SIGNATURES, 1);
+    } else {
+        metrics_count(COUNTER_HSM_ERRORS, 1);
         error = hsm_get_error(ctx);
         if (error) {
             ods_log_error("[%s] %s", hsm_str, error);
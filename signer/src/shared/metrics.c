@@ -0,0 +1,638 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Signer metrics: latency histograms and counters.
+ *
+ * Every thread updates its own shard with atomic operations, so recording
+ * a value never takes a lock and rarely contends. Reading the metrics sums
+ * the shards. Without __thread the shard is kept in thread-specific data,
+ * without the __sync builtins the shards are updated under a lock.
+ *
+ */
+
+#include "config.h"
+#include "shared/file.h"
+#include "shared/locks.h"
+#include "shared/log.h"
+#include "shared/metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define METRICS_LINE 256
+
+static const char* metrics_str = "metrics";
+
+typedef struct metrics_shard_struct metrics_shard_type;
+struct metrics_shard_struct {
+    histogram_type histograms[METRIC_MAX];
+    uint64_t counters[COUNTER_MAX];
+};
+
+static metrics_shard_type metrics_shards[METRICS_SHARDS];
+static unsigned int metrics_next_shard = 0;
+static uint64_t metrics_start = 0;
+static uint64_t metrics_last_dump = 0;
+
+#if defined(HAVE_TLS)
+static __thread metrics_shard_type* metrics_shard = NULL;
+#elif defined(HAVE_PTHREAD)
+static pthread_key_t metrics_shard_key;
+static pthread_once_t metrics_shard_once = PTHREAD_ONCE_INIT;
+#else
+static metrics_shard_type* metrics_shard = NULL;
+#endif
+
+#ifndef HAVE_SYNC_BUILTINS
+# ifdef HAVE_PTHREAD
+static lock_basic_type metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+# else
+static lock_basic_type metrics_lock = 0;
+# endif
+#endif
+
+
+/**
+ * Initialize metrics.
+ *
+ */
+void
+metrics_init(void)
+{
+    memset(metrics_shards, 0, sizeof(metrics_shards));
+    metrics_start = metrics_now();
+    metrics_last_dump = 0;
+    return;
+}
+
+
+/**
+ * Current time in nanoseconds.
+ *
+ */
+uint64_t
+metrics_now(void)
+{
+    struct timeval tv;
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+# ifdef CLOCK_MONOTONIC
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+# else
+    if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+# endif
+        return ((uint64_t) ts.tv_sec) * 1000000000 + (uint64_t) ts.tv_nsec;
+    }
+#endif /* HAVE_CLOCK_GETTIME */
+    if (gettimeofday(&tv, NULL) != 0) {
+        return ((uint64_t) time(NULL)) * 1000000000;
+    }
+    return ((uint64_t) tv.tv_sec) * 1000000000 +
+        ((uint64_t) tv.tv_usec) * 1000;
+}
+
+
+#if !defined(HAVE_TLS) && defined(HAVE_PTHREAD)
+/**
+ * Create the key for the shard of a thread.
+ *
+ */
+static void
+metrics_shard_key_create(void)
+{
+    (void) pthread_key_create(&metrics_shard_key, NULL);
+    return;
+}
+#endif
+
+
+/**
+ * Hand out the next shard number.
+ *
+ */
+static unsigned int
+metrics_next(void)
+{
+#ifdef HAVE_SYNC_BUILTINS
+    return __sync_fetch_and_add(&metrics_next_shard, 1);
+#else
+    unsigned int next = 0;
+    lock_basic_lock(&metrics_lock);
+    next = metrics_next_shard++;
+    lock_basic_unlock(&metrics_lock);
+    return next;
+#endif
+}
+
+
+/**
+ * Get the shard of the calling thread.
+ *
+ */
+static metrics_shard_type*
+metrics_get_shard(void)
+{
+    metrics_shard_type* shard = NULL;
+#if !defined(HAVE_TLS) && defined(HAVE_PTHREAD)
+    (void) pthread_once(&metrics_shard_once, metrics_shard_key_create);
+    shard = (metrics_shard_type*) pthread_getspecific(metrics_shard_key);
+#else
+    shard = metrics_shard;
+#endif
+    if (!shard) {
+        shard = &metrics_shards[metrics_next() % METRICS_SHARDS];
+#if !defined(HAVE_TLS) && defined(HAVE_PTHREAD)
+        (void) pthread_setspecific(metrics_shard_key, shard);
+#else
+        metrics_shard = shard;
+#endif
+    }
+    return shard;
+}
+
+
+/**
+ * Bucket for a value.
+ *
+ */
+static size_t
+metrics_bucket(uint64_t v)
+{
+    int e = 0;
+    if (v < 2 * METRICS_SUB_COUNT) {
+        return (size_t) v;
+    }
+    /* e is the position of the most significant bit */
+#ifdef __GNUC__
+    e = 63 - __builtin_clzll(v);
+#else
+    for (e = 63; !(v >> e); e--) {
+        ;
+    }
+#endif
+    return (size_t) (e - METRICS_SUB_BITS + 1) * METRICS_SUB_COUNT +
+        ((v >> (e - METRICS_SUB_BITS)) & (METRICS_SUB_COUNT - 1));
+}
+
+
+/**
+ * Largest value that falls in a bucket.
+ *
+ */
+static uint64_t
+metrics_bucket_max(size_t i)
+{
+    int e = 0;
+    uint64_t sub = 0;
+    if (i < 2 * METRICS_SUB_COUNT) {
+        return (uint64_t) i;
+    }
+    e = (int) (i / METRICS_SUB_COUNT) + METRICS_SUB_BITS - 1;
+    sub = (uint64_t) (i % METRICS_SUB_COUNT);
+    return ((METRICS_SUB_COUNT + sub) << (e - METRICS_SUB_BITS)) +
+        ((((uint64_t) 1) << (e - METRICS_SUB_BITS)) - 1);
+}
+
+
+/**
+ * Record a latency.
+ *
+ */
+void
+metrics_observe(metric_id id, uint64_t ns)
+{
+    histogram_type* h = NULL;
+#ifdef HAVE_SYNC_BUILTINS
+    uint64_t max = 0;
+#endif
+    if (id >= METRIC_MAX) {
+        return;
+    }
+    h = &metrics_get_shard()->histograms[id];
+#ifdef HAVE_SYNC_BUILTINS
+    (void) __sync_fetch_and_add(&h->buckets[metrics_bucket(ns)], 1);
+    (void) __sync_fetch_and_add(&h->count, 1);
+    (void) __sync_fetch_and_add(&h->sum, ns);
+    max = h->max;
+    while (ns > max && !__sync_bool_compare_and_swap(&h->max, max, ns)) {
+        max = h->max;
+    }
+#else
+    lock_basic_lock(&metrics_lock);
+    h->buckets[metrics_bucket(ns)]++;
+    h->count++;
+    h->sum += ns;
+    if (ns > h->max) {
+        h->max = ns;
+    }
+    lock_basic_unlock(&metrics_lock);
+#endif
+    return;
+}
+
+
+/**
+ * Record the latency since start.
+ *
+ */
+void
+metrics_observe_since(metric_id id, uint64_t start)
+{
+    uint64_t now = metrics_now();
+    metrics_observe(id, now > start ? now - start : 0);
+    return;
+}
+
+
+/**
+ * Increase a counter.
+ *
+ */
+void
+metrics_count(counter_id id, uint64_t n)
+{
+    uint64_t* counter = NULL;
+    if (id >= COUNTER_MAX) {
+        return;
+    }
+    counter = &metrics_get_shard()->counters[id];
+#ifdef HAVE_SYNC_BUILTINS
+    (void) __sync_fetch_and_add(counter, n);
+#else
+    lock_basic_lock(&metrics_lock);
+    *counter += n;
+    lock_basic_unlock(&metrics_lock);
+#endif
+    return;
+}
+
+
+/**
+ * Sum the per-thread shards.
+ *
+ */
+void
+metrics_collect(metrics_type* metrics)
+{
+    histogram_type* h = NULL;
+    histogram_type* from = NULL;
+    size_t s = 0;
+    size_t i = 0;
+    size_t b = 0;
+
+    if (!metrics) {
+        return;
+    }
+    memset(metrics, 0, sizeof(metrics_type));
+    metrics->since = metrics_start;
+    for (s=0; s < METRICS_SHARDS; s++) {
+        for (i=0; i < METRIC_MAX; i++) {
+            h = &metrics->histograms[i];
+            from = &metrics_shards[s].histograms[i];
+            if (!from->count) {
+                continue;
+            }
+            for (b=0; b < METRICS_BUCKETS; b++) {
+                h->buckets[b] += from->buckets[b];
+            }
+            h->count += from->count;
+            h->sum += from->sum;
+            if (from->max > h->max) {
+                h->max = from->max;
+            }
+        }
+        for (i=0; i < COUNTER_MAX; i++) {
+            metrics->counters[i] += metrics_shards[s].counters[i];
+        }
+    }
+    return;
+}
+
+
+/**
+ * Estimate a quantile from a histogram.
+ *
+ */
+uint64_t
+metrics_quantile(histogram_type* histogram, double q)
+{
+    uint64_t rank = 0;
+    uint64_t seen = 0;
+    size_t b = 0;
+
+    if (!histogram || !histogram->count) {
+        return 0;
+    }
+    rank = (uint64_t) (q * (double) histogram->count);
+    if (rank >= histogram->count) {
+        rank = histogram->count - 1;
+    }
+    for (b=0; b < METRICS_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen > rank) {
+            break;
+        }
+    }
+    if (b == METRICS_BUCKETS || metrics_bucket_max(b) > histogram->max) {
+        return histogram->max;
+    }
+    return metrics_bucket_max(b);
+}
+
+
+/**
+ * Write a formatted line.
+ *
+ */
+static void
+metrics_write(int fd, const char* format, ...)
+{
+    char buf[METRICS_LINE];
+    va_list args;
+    int len = 0;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t) len >= sizeof(buf)) {
+        len = (int) sizeof(buf) - 1;
+    }
+    (void) ods_writen(fd, buf, (size_t) len);
+    return;
+}
+
+
+/**
+ * Format a duration in nanoseconds with a sensible unit.
+ *
+ */
+static const char*
+metrics_ns2str(uint64_t ns, char* buf, size_t len)
+{
+    if (ns < 1000) {
+        (void) snprintf(buf, len, "%uns", (unsigned) ns);
+    } else if (ns < 1000000) {
+        (void) snprintf(buf, len, "%.1fus", (double) ns / 1000);
+    } else if (ns < 1000000000) {
+        (void) snprintf(buf, len, "%.1fms", (double) ns / 1000000);
+    } else {
+        (void) snprintf(buf, len, "%.2fs", (double) ns / 1000000000);
+    }
+    return buf;
+}
+
+
+/**
+ * Write metrics in human readable form.
+ *
+ */
+void
+metrics_print(int fd)
+{
+    metrics_type metrics;
+    histogram_type* h = NULL;
+    char avg[32], p50[32], p90[32], p99[32], max[32];
+    uint64_t uptime = 0;
+    double xfr_time = 0;
+    size_t i = 0;
+
+    metrics_collect(&metrics);
+    uptime = (metrics_now() - metrics.since) / 1000000000;
+    metrics_write(fd, "Metrics over the last %u seconds.\n",
+        (unsigned) uptime);
+    metrics_write(fd, "\n%-12s %10s %10s %10s %10s %10s %10s\n",
+        "stage", "count", "avg", "p50", "p90", "p99", "max");
+    for (i=0; i < METRIC_MAX; i++) {
+        h = &metrics.histograms[i];
+        metrics_write(fd, "%-12s %10llu %10s %10s %10s %10s %10s\n",
+            metric2str((metric_id) i), (unsigned long long) h->count,
+            metrics_ns2str(h->count ? h->sum / h->count : 0, avg,
+                sizeof(avg)),
+            metrics_ns2str(metrics_quantile(h, 0.5), p50, sizeof(p50)),
+            metrics_ns2str(metrics_quantile(h, 0.9), p90, sizeof(p90)),
+            metrics_ns2str(metrics_quantile(h, 0.99), p99, sizeof(p99)),
+            metrics_ns2str(h->max, max, sizeof(max)));
+    }
+    metrics_write(fd, "\n");
+    for (i=0; i < COUNTER_MAX; i++) {
+        metrics_write(fd, "%-12s %10llu\n", counter2str((counter_id) i),
+            (unsigned long long) metrics.counters[i]);
+    }
+    xfr_time = (double) metrics.histograms[METRIC_XFR].sum / 1000000000;
+    if (xfr_time > 0) {
+        metrics_write(fd, "%-12s %10.0f bytes/sec\n", "xfr_rate",
+            (double) metrics.counters[COUNTER_XFR_BYTES] / xfr_time);
+    }
+    return;
+}
+
+
+/**
+ * Write metrics in Prometheus text exposition format.
+ *
+ */
+void
+metrics_print_prometheus(int fd)
+{
+    metrics_type metrics;
+    histogram_type* h = NULL;
+    const char* name = NULL;
+    uint64_t cumulative = 0;
+    size_t i = 0;
+    size_t b = 0;
+
+    metrics_collect(&metrics);
+    for (i=0; i < METRIC_MAX; i++) {
+        h = &metrics.histograms[i];
+        name = metric2str((metric_id) i);
+        metrics_write(fd, "# TYPE ods_signer_%s_seconds histogram\n", name);
+        /* cumulative buckets, only where the count changes */
+        cumulative = 0;
+        for (b=0; b < METRICS_BUCKETS; b++) {
+            if (!h->buckets[b]) {
+                continue;
+            }
+            cumulative += h->buckets[b];
+            metrics_write(fd, "ods_signer_%s_seconds_bucket{le=\"%.9g\"} "
+                "%llu\n", name, (double) metrics_bucket_max(b) / 1000000000,
+                (unsigned long long) cumulative);
+        }
+        metrics_write(fd, "ods_signer_%s_seconds_bucket{le=\"+Inf\"} %llu\n",
+            name, (unsigned long long) h->count);
+        metrics_write(fd, "ods_signer_%s_seconds_sum %.9f\n", name,
+            (double) h->sum / 1000000000);
+        metrics_write(fd, "ods_signer_%s_seconds_count %llu\n", name,
+            (unsigned long long) h->count);
+    }
+    for (i=0; i < COUNTER_MAX; i++) {
+        name = counter2str((counter_id) i);
+        metrics_write(fd, "# TYPE ods_signer_%s_total counter\n", name);
+        metrics_write(fd, "ods_signer_%s_total %llu\n", name,
+            (unsigned long long) metrics.counters[i]);
+    }
+    return;
+}
+
+
+/**
+ * Dump metrics to a file.
+ *
+ */
+ods_status
+metrics_dump(const char* filename, time_t interval)
+{
+    char tmpname[METRICS_LINE];
+    uint64_t now = 0;
+    uint64_t last = 0;
+    int fd = -1;
+
+    if (!filename) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    now = metrics_now();
+    last = metrics_last_dump;
+    if (last && now - last < ((uint64_t) interval) * 1000000000) {
+        return ODS_STATUS_UNCHANGED;
+    }
+    /* only one thread gets to dump */
+#ifdef HAVE_SYNC_BUILTINS
+    if (!__sync_bool_compare_and_swap(&metrics_last_dump, last, now)) {
+        return ODS_STATUS_UNCHANGED;
+    }
+#else
+    lock_basic_lock(&metrics_lock);
+    if (metrics_last_dump != last) {
+        lock_basic_unlock(&metrics_lock);
+        return ODS_STATUS_UNCHANGED;
+    }
+    metrics_last_dump = now;
+    lock_basic_unlock(&metrics_lock);
+#endif
+    if ((size_t) snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename) >=
+        sizeof(tmpname)) {
+        ods_log_error("[%s] unable to dump metrics to %s: file name too "
+            "long", metrics_str, filename);
+        return ODS_STATUS_ERR;
+    }
+    fd = open(tmpname, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd < 0) {
+        ods_log_error("[%s] unable to dump metrics to %s: open() failed "
+            "(%s)", metrics_str, tmpname, strerror(errno));
+        return ODS_STATUS_FOPEN_ERR;
+    }
+    metrics_print_prometheus(fd);
+    close(fd);
+    if (rename(tmpname, filename) != 0) {
+        ods_log_error("[%s] unable to dump metrics to %s: rename() failed "
+            "(%s)", metrics_str, filename, strerror(errno));
+        (void) unlink(tmpname);
+        return ODS_STATUS_RENAME_ERR;
+    }
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * String-format of histogram.
+ *
+ */
+const char*
+metric2str(metric_id id)
+{
+    switch (id) {
+        case METRIC_HSM_SIGN:
+            return "hsm_sign";
+        case METRIC_SIGNQ_WAIT:
+            return "signq_wait";
+        case METRIC_SIGNCONF:
+            return "signconf";
+        case METRIC_READ:
+            return "read";
+        case METRIC_NSECIFY:
+            return "nsecify";
+        case METRIC_SIGN:
+            return "sign";
+        case METRIC_WRITE:
+            return "write";
+        case METRIC_BACKUP:
+            return "backup";
+        case METRIC_OUTPUT:
+            return "output";
+        case METRIC_XFR:
+            return "xfr";
+        default:
+            break;
+    }
+    return "unknown";
+}
+
+
+/**
+ * String-format of counter.
+ *
+ */
+const char*
+counter2str(counter_id id)
+{
+    switch (id) {
+        case COUNTER_SIGNATURES:
+            return "signatures";
+        case COUNTER_HSM_ERRORS:
+            return "hsm_errors";
+        case COUNTER_TASKS:
+            return "tasks";
+        case COUNTER_TASK_ERRORS:
+            return "task_errors";
+        case COUNTER_XFR_PACKETS:
+            return "xfr_packets";
+        case COUNTER_XFR_BYTES:
+            return "xfr_bytes";
+        case COUNTER_XFR_RRS:
+            return "xfr_rrs";
+        case COUNTER_PUBLISHED:
+            return "published";
+        case COUNTER_PUBLISH_SKIPPED:
+            return "publish_skipped";
+        case COUNTER_SIGS_DEFERRED:
+            return "sigs_deferred";
+        default:
+            break;
+    }
+    return "unknown";
+}
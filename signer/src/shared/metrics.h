@@ -0,0 +1,203 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Signer metrics: latency histograms and counters.
+ *
+ */
+
+#ifndef SHARED_METRICS_H
+#define SHARED_METRICS_H
+
+#include "config.h"
+#include "shared/status.h"
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Histograms are log-linear: values below 2^(METRICS_SUB_BITS+1) have a
+ * bucket of their own, every power of two above that is split in
+ * 2^METRICS_SUB_BITS buckets. With nanosecond values the relative error is
+ * below 25%, and 252 buckets cover the full 64-bit range.
+ *
+ */
+#define METRICS_SUB_BITS 2
+#define METRICS_SUB_COUNT (1 << METRICS_SUB_BITS)
+#define METRICS_BUCKETS ((65 - METRICS_SUB_BITS) * METRICS_SUB_COUNT)
+/* the number of per-thread shards, threads beyond this share shards */
+#define METRICS_SHARDS 16
+/* seconds between two dumps of the metrics file */
+#define METRICS_DUMP_INTERVAL 60
+
+enum metric_id_enum {
+    METRIC_HSM_SIGN = 0, /* one signature by the HSM */
+    METRIC_SIGNQ_WAIT, /* an RRset waiting in the sign queue */
+    METRIC_SIGNCONF, /* task stages */
+    METRIC_READ,
+    METRIC_NSECIFY,
+    METRIC_SIGN,
+    METRIC_WRITE,
+    METRIC_BACKUP,
+    METRIC_OUTPUT, /* an output image flushed by the writer */
+    METRIC_XFR, /* an inbound zone transfer */
+    METRIC_MAX
+};
+typedef enum metric_id_enum metric_id;
+
+enum counter_id_enum {
+    COUNTER_SIGNATURES = 0,
+    COUNTER_HSM_ERRORS,
+    COUNTER_TASKS,
+    COUNTER_TASK_ERRORS,
+    COUNTER_XFR_PACKETS,
+    COUNTER_XFR_BYTES,
+    COUNTER_XFR_RRS,
+    COUNTER_PUBLISHED, /* sign runs that published a new serial */
+    COUNTER_PUBLISH_SKIPPED, /* sign runs without changes to publish */
+    COUNTER_SIGS_DEFERRED, /* stale signatures kept for a later batch */
+    COUNTER_MAX
+};
+typedef enum counter_id_enum counter_id;
+
+/**
+ * Histogram.
+ */
+typedef struct histogram_struct histogram_type;
+struct histogram_struct {
+    uint64_t buckets[METRICS_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+};
+
+/**
+ * Aggregated metrics.
+ */
+typedef struct metrics_struct metrics_type;
+struct metrics_struct {
+    histogram_type histograms[METRIC_MAX];
+    uint64_t counters[COUNTER_MAX];
+    uint64_t since;
+};
+
+/**
+ * Initialize metrics, marks the start of the measurement period.
+ *
+ */
+void metrics_init(void);
+
+/**
+ * Current time in nanoseconds, on a monotonic clock if available.
+ * \return uint64_t nanoseconds
+ *
+ */
+uint64_t metrics_now(void);
+
+/**
+ * Record a latency.
+ * \param[in] id histogram
+ * \param[in] ns latency in nanoseconds
+ *
+ */
+void metrics_observe(metric_id id, uint64_t ns);
+
+/**
+ * Record the latency since start.
+ * \param[in] id histogram
+ * \param[in] start start time, as returned by metrics_now()
+ *
+ */
+void metrics_observe_since(metric_id id, uint64_t start);
+
+/**
+ * Increase a counter.
+ * \param[in] id counter
+ * \param[in] n amount
+ *
+ */
+void metrics_count(counter_id id, uint64_t n);
+
+/**
+ * Sum the per-thread shards.
+ * \param[out] metrics aggregated metrics
+ *
+ */
+void metrics_collect(metrics_type* metrics);
+
+/**
+ * Estimate a quantile from a histogram.
+ * \param[in] histogram histogram
+ * \param[in] q quantile, between 0 and 1
+ * \return uint64_t upper bound of the bucket that holds the quantile
+ *
+ */
+uint64_t metrics_quantile(histogram_type* histogram, double q);
+
+/**
+ * Write metrics in human readable form.
+ * \param[in] fd file descriptor
+ *
+ */
+void metrics_print(int fd);
+
+/**
+ * Write metrics in Prometheus text exposition format.
+ * \param[in] fd file descriptor
+ *
+ */
+void metrics_print_prometheus(int fd);
+
+/**
+ * Dump metrics in Prometheus text exposition format to a file. The file is
+ * replaced atomically, and at most once every interval seconds.
+ * \param[in] filename file name
+ * \param[in] interval minimal number of seconds between dumps
+ * \return ods_status status
+ *
+ */
+ods_status metrics_dump(const char* filename, time_t interval);
+
+/**
+ * String-format of histogram.
+ * \param[in] id histogram
+ * \return const char* name
+ *
+ */
+const char* metric2str(metric_id id);
+
+/**
+ * String-format of counter.
+ * \param[in] id counter
+ * \return const char* name
+ *
+ */
+const char* counter2str(counter_id id);
+
+#endif /* SHARED_METRICS_H */
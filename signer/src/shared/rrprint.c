@@ -0,0 +1,533 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Buffered printing of RRs in presentation format.
+ *
+ */
+
+#include "config.h"
+#include "shared/log.h"
+#include "shared/rrprint.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+static const char* printer_str = "rrprint";
+
+static const char b64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**
+ * Create printer.
+ *
+ */
+rrprint_type*
+rrprint_create(FILE* fd)
+{
+    rrprint_type* printer = NULL;
+    printer = (rrprint_type*) calloc(1, sizeof(rrprint_type));
+    if (!printer) {
+        ods_log_error("[%s] unable to create printer: calloc() failed",
+            printer_str);
+        return NULL;
+    }
+    printer->cap = RRPRINT_BUFSIZE;
+    printer->buf = (char*) malloc(printer->cap);
+    printer->scratch = ldns_buffer_new(LDNS_MAX_PACKETLEN);
+    if (!printer->buf || !printer->scratch) {
+        ods_log_error("[%s] unable to create printer: malloc() failed",
+            printer_str);
+        free(printer->buf);
+        if (printer->scratch) {
+            ldns_buffer_free(printer->scratch);
+        }
+        free(printer);
+        return NULL;
+    }
+    printer->fd = fd;
+    printer->day = (time_t) -1;
+    printer->status = ODS_STATUS_OK;
+    return printer;
+}
+
+
+/**
+ * Write out the output buffer.
+ *
+ */
+ods_status
+rrprint_flush(rrprint_type* printer)
+{
+    if (!printer) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    if (printer->len && printer->fd) {
+        if (fwrite(printer->buf, 1, printer->len, printer->fd) !=
+            printer->len && printer->status == ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to print: fwrite() failed",
+                printer_str);
+            printer->status = ODS_STATUS_FWRITE_ERR;
+        }
+        printer->len = 0;
+    }
+    return printer->status;
+}
+
+
+/**
+ * Make room for len characters. A printer that prints to a file writes
+ * out its buffer, a printer that prints to memory grows it.
+ *
+ */
+static char*
+rrprint_reserve(rrprint_type* printer, size_t len)
+{
+    size_t cap = printer->cap;
+    char* buf = NULL;
+    if (printer->len + len <= printer->cap) {
+        return printer->buf + printer->len;
+    }
+    if (printer->fd) {
+        (void) rrprint_flush(printer);
+    }
+    while (printer->len + len > cap) {
+        cap *= 2;
+    }
+    if (cap > printer->cap) {
+        buf = (char*) realloc(printer->buf, cap);
+        if (buf) {
+            printer->buf = buf;
+            printer->cap = cap;
+        } else {
+            ods_log_error("[%s] unable to print: realloc() failed",
+                printer_str);
+            printer->status = ODS_STATUS_MALLOC_ERR;
+            /* the output is lost anyway, make room */
+            printer->len = 0;
+        }
+    }
+    return printer->buf + printer->len;
+}
+
+
+/**
+ * Append characters.
+ *
+ */
+static void
+rrprint_append(rrprint_type* printer, const char* str, size_t len)
+{
+    char* out = rrprint_reserve(printer, len);
+    if (printer->len + len > printer->cap) {
+        return;
+    }
+    memcpy(out, str, len);
+    printer->len += len;
+    return;
+}
+
+
+/**
+ * Append one character.
+ *
+ */
+static void
+rrprint_char(rrprint_type* printer, char c)
+{
+    *rrprint_reserve(printer, 1) = c;
+    printer->len++;
+    return;
+}
+
+
+/**
+ * Append whatever ldns left in the scratch buffer.
+ *
+ */
+static void
+rrprint_scratch(rrprint_type* printer, ldns_status status)
+{
+    if (status != LDNS_STATUS_OK ||
+        !ldns_buffer_status_ok(printer->scratch)) {
+        if (printer->status == ODS_STATUS_OK) {
+            printer->status = ODS_STATUS_FWRITE_ERR;
+        }
+        return;
+    }
+    rrprint_append(printer, (const char*) ldns_buffer_begin(printer->scratch),
+        ldns_buffer_position(printer->scratch));
+    return;
+}
+
+
+/**
+ * Append unsigned integer.
+ *
+ */
+static void
+rrprint_uint(rrprint_type* printer, uint32_t val)
+{
+    char tmp[10];
+    size_t i = sizeof(tmp);
+    do {
+        tmp[--i] = (char) ('0' + (val % 10));
+        val /= 10;
+    } while (val);
+    rrprint_append(printer, tmp + i, sizeof(tmp) - i);
+    return;
+}
+
+
+/**
+ * Append base64 encoded data.
+ *
+ */
+static void
+rrprint_b64(rrprint_type* printer, const uint8_t* data, size_t size)
+{
+    size_t len = ((size + 2) / 3) * 4;
+    size_t i = 0;
+    char* out = NULL;
+    uint32_t w = 0;
+    out = rrprint_reserve(printer, len);
+    for (i=0; i + 2 < size; i += 3) {
+        w = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        *out++ = b64[(w >> 18) & 0x3f];
+        *out++ = b64[(w >> 12) & 0x3f];
+        *out++ = b64[(w >> 6) & 0x3f];
+        *out++ = b64[w & 0x3f];
+    }
+    if (size - i == 1) {
+        w = data[i] << 16;
+        *out++ = b64[(w >> 18) & 0x3f];
+        *out++ = b64[(w >> 12) & 0x3f];
+        *out++ = '=';
+        *out++ = '=';
+    } else if (size - i == 2) {
+        w = (data[i] << 16) | (data[i+1] << 8);
+        *out++ = b64[(w >> 18) & 0x3f];
+        *out++ = b64[(w >> 12) & 0x3f];
+        *out++ = b64[(w >> 6) & 0x3f];
+        *out++ = '=';
+    }
+    printer->len += len;
+    return;
+}
+
+
+/**
+ * Append two digits.
+ *
+ */
+static void
+rrprint_digits(char* out, int val)
+{
+    out[0] = (char) ('0' + (val / 10) % 10);
+    out[1] = (char) ('0' + val % 10);
+    return;
+}
+
+
+/**
+ * Append time as YYYYMMDDHHmmSS. The date part is cached, signatures
+ * tend to expire on a small number of days.
+ *
+ */
+static int
+rrprint_time(rrprint_type* printer, uint32_t val)
+{
+    time_t t = (time_t) val;
+    time_t day = t / 86400;
+    int secs = (int) (t % 86400);
+    struct tm tm;
+    char* out = NULL;
+    if (day != printer->day) {
+        if (!gmtime_r(&t, &tm)) {
+            return 0;
+        }
+        rrprint_digits(printer->date, (tm.tm_year + 1900) / 100);
+        rrprint_digits(printer->date + 2, (tm.tm_year + 1900) % 100);
+        rrprint_digits(printer->date + 4, tm.tm_mon + 1);
+        rrprint_digits(printer->date + 6, tm.tm_mday);
+        printer->day = day;
+    }
+    out = rrprint_reserve(printer, 14);
+    memcpy(out, printer->date, 8);
+    rrprint_digits(out + 8, secs / 3600);
+    rrprint_digits(out + 10, (secs / 60) % 60);
+    rrprint_digits(out + 12, secs % 60);
+    printer->len += 14;
+    return 1;
+}
+
+
+/**
+ * Append dname, reusing the cached presentation format if it matches.
+ *
+ */
+static void
+rrprint_dname(rrprint_type* printer, rrprint_dname_type* cache,
+    const ldns_rdf* rdf)
+{
+    size_t size = ldns_rdf_size(rdf);
+    ldns_status status = LDNS_STATUS_OK;
+    if (size && size == cache->wire_len &&
+        memcmp(ldns_rdf_data(rdf), cache->wire, size) == 0) {
+        rrprint_append(printer, cache->str, cache->str_len);
+        return;
+    }
+    ldns_buffer_clear(printer->scratch);
+    status = ldns_rdf2buffer_str_dname(printer->scratch, rdf);
+    if (status == LDNS_STATUS_OK && ldns_buffer_status_ok(printer->scratch)
+        && size <= sizeof(cache->wire)
+        && ldns_buffer_position(printer->scratch) <= sizeof(cache->str)) {
+        cache->wire_len = size;
+        memcpy(cache->wire, ldns_rdf_data(rdf), size);
+        cache->str_len = ldns_buffer_position(printer->scratch);
+        memcpy(cache->str, ldns_buffer_begin(printer->scratch),
+            cache->str_len);
+    } else {
+        cache->wire_len = 0;
+    }
+    rrprint_scratch(printer, status);
+    return;
+}
+
+
+/**
+ * Append RR type.
+ *
+ */
+static void
+rrprint_rrtype(rrprint_type* printer, ldns_rr_type type)
+{
+    const ldns_rr_descriptor* descriptor = ldns_rr_descript(type);
+    if (descriptor && descriptor->_name) {
+        rrprint_append(printer, descriptor->_name,
+            strlen(descriptor->_name));
+        return;
+    }
+    ldns_buffer_clear(printer->scratch);
+    rrprint_scratch(printer, ldns_rr_type2buffer_str(printer->scratch, type));
+    return;
+}
+
+
+/**
+ * Append rdata field.
+ *
+ */
+static void
+rrprint_rdf(rrprint_type* printer, const ldns_rdf* rdf)
+{
+    const uint8_t* data = ldns_rdf_data(rdf);
+    size_t size = ldns_rdf_size(rdf);
+    char tmp[INET6_ADDRSTRLEN];
+
+    switch (ldns_rdf_get_type(rdf)) {
+        case LDNS_RDF_TYPE_INT8:
+            if (size == 1) {
+                rrprint_uint(printer, data[0]);
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_INT16:
+            if (size == 2) {
+                rrprint_uint(printer, ldns_read_uint16(data));
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_INT32:
+            if (size == 4) {
+                rrprint_uint(printer, ldns_read_uint32(data));
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_TIME:
+            if (size == 4 && rrprint_time(printer, ldns_read_uint32(data))) {
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_TYPE:
+            if (size == 2) {
+                rrprint_rrtype(printer, (ldns_rr_type) ldns_read_uint16(data));
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_B64:
+            if (size && size <= LDNS_MAX_PACKETLEN) {
+                rrprint_b64(printer, data, size);
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_A:
+            if (size == 4 && inet_ntop(AF_INET, data, tmp, sizeof(tmp))) {
+                rrprint_append(printer, tmp, strlen(tmp));
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_AAAA:
+            if (size == 16 && inet_ntop(AF_INET6, data, tmp, sizeof(tmp))) {
+                rrprint_append(printer, tmp, strlen(tmp));
+                return;
+            }
+            break;
+        case LDNS_RDF_TYPE_DNAME:
+            rrprint_dname(printer, &printer->signer, rdf);
+            return;
+        default:
+            break;
+    }
+    /* let ldns deal with the others */
+    ldns_buffer_clear(printer->scratch);
+    rrprint_scratch(printer, ldns_rdf2buffer_str(printer->scratch, rdf));
+    return;
+}
+
+
+/**
+ * Print RR in presentation format.
+ *
+ */
+ods_status
+rrprint_rr(rrprint_type* printer, const ldns_rr* rr, int newline)
+{
+    size_t i = 0;
+    size_t count = 0;
+    ldns_status status = LDNS_STATUS_OK;
+    if (!printer || !rr) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    count = ldns_rr_rd_count(rr);
+    for (i=0; i < count; i++) {
+        if (!ldns_rr_rdf(rr, i)) {
+            break;
+        }
+    }
+    if (!ldns_rr_owner(rr) || !count || i < count ||
+        ldns_rr_get_type(rr) == LDNS_RR_TYPE_DNSKEY) {
+        /* empty rdata, or ldns adds comments: print the way ldns does */
+        ldns_buffer_clear(printer->scratch);
+        status = ldns_rr2buffer_str_fmt(printer->scratch, NULL, rr);
+        if (status == LDNS_STATUS_OK && !newline &&
+            ldns_buffer_position(printer->scratch) > 0) {
+            ldns_buffer_set_position(printer->scratch,
+                ldns_buffer_position(printer->scratch) - 1);
+        }
+        rrprint_scratch(printer, status);
+        return printer->status;
+    }
+    rrprint_dname(printer, &printer->owner, ldns_rr_owner(rr));
+    rrprint_char(printer, '\t');
+    rrprint_uint(printer, ldns_rr_ttl(rr));
+    rrprint_char(printer, '\t');
+    if (ldns_rr_get_class(rr) == LDNS_RR_CLASS_IN) {
+        rrprint_append(printer, "IN", 2);
+    } else {
+        ldns_buffer_clear(printer->scratch);
+        rrprint_scratch(printer, ldns_rr_class2buffer_str(printer->scratch,
+            ldns_rr_get_class(rr)));
+    }
+    rrprint_char(printer, '\t');
+    rrprint_rrtype(printer, ldns_rr_get_type(rr));
+    rrprint_char(printer, '\t');
+    for (i=0; i < count; i++) {
+        if (i) {
+            rrprint_char(printer, ' ');
+        }
+        rrprint_rdf(printer, ldns_rr_rdf(rr, i));
+    }
+    if (newline) {
+        rrprint_char(printer, '\n');
+    }
+    return printer->status;
+}
+
+
+/**
+ * Print string.
+ *
+ */
+ods_status
+rrprint_str(rrprint_type* printer, const char* str)
+{
+    if (!printer || !str) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    rrprint_append(printer, str, strlen(str));
+    return printer->status;
+}
+
+
+/**
+ * Take the output of a printer that prints to memory.
+ *
+ */
+ods_status
+rrprint_take(rrprint_type* printer, char** buf, size_t* len)
+{
+    ods_status status = ODS_STATUS_OK;
+    if (!printer || !buf || !len || printer->fd) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    status = printer->status;
+    if (status == ODS_STATUS_OK) {
+        *buf = printer->buf;
+        *len = printer->len;
+        printer->buf = NULL;
+    } else {
+        *buf = NULL;
+        *len = 0;
+    }
+    (void) rrprint_cleanup(printer);
+    return status;
+}
+
+
+/**
+ * Clean up printer.
+ *
+ */
+ods_status
+rrprint_cleanup(rrprint_type* printer)
+{
+    ods_status status = ODS_STATUS_OK;
+    if (!printer) {
+        return ODS_STATUS_OK;
+    }
+    status = rrprint_flush(printer);
+    ldns_buffer_free(printer->scratch);
+    free(printer->buf);
+    free(printer);
+    return status;
+}
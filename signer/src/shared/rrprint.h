@@ -0,0 +1,137 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Buffered printing of RRs in presentation format.
+ *
+ */
+
+#ifndef SHARED_RRPRINT_H
+#define SHARED_RRPRINT_H
+
+#include "config.h"
+#include "shared/status.h"
+
+#include <ldns/ldns.h>
+#include <stdio.h>
+
+/** Size of the output buffer. */
+#define RRPRINT_BUFSIZE (1024*1024)
+/** Maximum length of a dname in presentation format. */
+#define RRPRINT_DNAME_MAXLEN (4*255 + 2)
+
+/**
+ * Cached presentation format of a dname.
+ *
+ */
+typedef struct rrprint_dname_struct rrprint_dname_type;
+struct rrprint_dname_struct {
+    uint8_t wire[255];
+    size_t wire_len;
+    char str[RRPRINT_DNAME_MAXLEN];
+    size_t str_len;
+};
+
+/**
+ * RR printer.
+ * RRs are formatted into a large output buffer that is written out when
+ * it is full. Owner names and RRSIG signer names are formatted once and
+ * reused by the RRs that follow, and the common rdata fields are
+ * encoded directly rather than via ldns_buffer_printf().
+ *
+ */
+typedef struct rrprint_struct rrprint_type;
+struct rrprint_struct {
+    FILE* fd;
+    char* buf;
+    size_t len;
+    size_t cap;
+    ldns_buffer* scratch;
+    rrprint_dname_type owner;
+    rrprint_dname_type signer;
+    time_t day;
+    char date[8];
+    ods_status status;
+};
+
+/**
+ * Create printer.
+ * \param[in] fd file to print to, or NULL to print to memory
+ * \return rrprint_type* printer
+ *
+ */
+rrprint_type* rrprint_create(FILE* fd);
+
+/**
+ * Print RR in presentation format.
+ * \param[in] printer printer
+ * \param[in] rr RR
+ * \param[in] newline terminate the line
+ * \return ods_status status
+ *
+ */
+ods_status rrprint_rr(rrprint_type* printer, const ldns_rr* rr, int newline);
+
+/**
+ * Print string.
+ * \param[in] printer printer
+ * \param[in] str string
+ * \return ods_status status
+ *
+ */
+ods_status rrprint_str(rrprint_type* printer, const char* str);
+
+/**
+ * Write out the output buffer.
+ * \param[in] printer printer
+ * \return ods_status status, the first error that occurred while printing
+ *
+ */
+ods_status rrprint_flush(rrprint_type* printer);
+
+/**
+ * Take the output of a printer that prints to memory, and clean up the
+ * printer.
+ * \param[in] printer printer
+ * \param[out] buf the output, to be released with free()
+ * \param[out] len length of the output
+ * \return ods_status status, the first error that occurred while printing
+ *
+ */
+ods_status rrprint_take(rrprint_type* printer, char** buf, size_t* len);
+
+/**
+ * Clean up printer, flushing the output buffer.
+ * \param[in] printer printer
+ * \return ods_status status, the first error that occurred while printing
+ *
+ */
+ods_status rrprint_cleanup(rrprint_type* printer);
+
+#endif /* SHARED_RRPRINT_H */
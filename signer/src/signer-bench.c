@@ -0,0 +1,941 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2011 NLNet Labs. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * Signer benchmark: run the read, nsecify, sign and write stages of the
+ * signer on a synthetic zone, in-process and without a daemon.
+ *
+ */
+
+#include "config.h"
+#include "adapter/adapter.h"
+#include "parser/confparser.h"
+#include "shared/duration.h"
+#include "shared/file.h"
+#include "shared/hsm.h"
+#include "shared/locks.h"
+#include "shared/log.h"
+#include "shared/metrics.h"
+#include "signer/denial.h"
+#include "signer/domain.h"
+#include "signer/signconf.h"
+#include "signer/tools.h"
+#include "signer/zone.h"
+
+#include <dirent.h>
+#include <getopt.h>
+#include <libhsm.h>
+#include <libxml/parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BENCH_ZONEFILE "zone.in"
+#define BENCH_SIGNEDFILE "zone.out"
+#define BENCH_SIGNCONF "signconf.xml"
+#define BENCH_EXPORT_SEQ "export.seq"
+#define BENCH_EXPORT_PAR "export.par"
+#define BENCH_MAX_THREADS 256
+
+static const char* bench_str = "bench";
+
+/**
+ * Benchmark settings.
+ */
+typedef struct bench_struct bench_type;
+struct bench_struct {
+    const char* cfgfile;
+    const char* repository;
+    const char* zone_name;
+    unsigned long keysize;
+    size_t domains;
+    size_t rrset_size;
+    int delegations; /* percentage of delegated domains */
+    int nsec3;
+    int optout;
+    int threads;
+    int parse_iterations;
+    int keep;
+    size_t rr_count;
+    char dir[64];
+    char ksk[128];
+    char zsk[128];
+};
+
+/**
+ * Work for the signer threads.
+ */
+typedef struct bench_sign_struct bench_sign_type;
+struct bench_sign_struct {
+    rrset_type** rrsets;
+    size_t count;
+    size_t next;
+    size_t failed;
+    time_t signtime;
+    lock_basic_type lock;
+};
+
+
+/**
+ * Prints usage.
+ *
+ */
+static void
+usage(FILE* out)
+{
+    fprintf(out, "Usage: %s [OPTIONS] -r <repository>\n", "signer-bench");
+    fprintf(out, "Benchmark the signer on a synthetic zone.\n\n");
+    fprintf(out, "Supported options:\n");
+    fprintf(out, " -c <cfgfile>  Read HSM configuration from file.\n");
+    fprintf(out, " -r <repos>    Repository to create the keys in.\n");
+    fprintf(out, " -z <zone>     Zone name [bench.example].\n");
+    fprintf(out, " -n <count>    Number of domains [25000].\n");
+    fprintf(out, " -d <percent>  Percentage of delegations [10].\n");
+    fprintf(out, " -a <count>    Number of A records per RRset [1].\n");
+    fprintf(out, " -3            Use NSEC3 instead of NSEC.\n");
+    fprintf(out, " -o            Use NSEC3 Opt-Out.\n");
+    fprintf(out, " -s <bits>     RSA key size [1024].\n");
+    fprintf(out, " -t <threads>  Number of signer threads [4].\n");
+    fprintf(out, " -p <count>    Also time parsing the signconf count "
+                 "times,\n");
+    fprintf(out, "               with the old and the new reader.\n");
+    fprintf(out, " -k            Keep the generated files and keys.\n");
+    fprintf(out, " -v            Increase verbosity.\n");
+    fprintf(out, " -h            Show this help and exit.\n");
+}
+
+
+/**
+ * Peak resident memory in kilobytes.
+ *
+ */
+static long
+bench_peak_memory(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+/**
+ * Report a stage.
+ *
+ */
+static void
+bench_report(const char* stage, uint64_t start, size_t count,
+    const char* unit)
+{
+    double secs = (double) (metrics_now() - start) / 1000000000;
+    fprintf(stdout, "%-10s %10.3f s %10lu %-8s %12.0f/s %10ld KB\n", stage,
+        secs, (unsigned long) count, unit,
+        secs > 0 ? (double) count / secs : 0, bench_peak_memory());
+    return;
+}
+
+
+/**
+ * Create the signing keys.
+ *
+ */
+static ods_status
+bench_create_keys(bench_type* bench)
+{
+    hsm_ctx_t* ctx = NULL;
+    hsm_key_t* key = NULL;
+    char* id = NULL;
+    int i = 0;
+
+    ctx = hsm_create_context();
+    if (!ctx) {
+        ods_log_error("[%s] unable to create keys: hsm_create_context() "
+            "failed", bench_str);
+        return ODS_STATUS_HSM_ERR;
+    }
+    for (i=0; i < 2; i++) {
+        key = hsm_generate_rsa_key(ctx, bench->repository, bench->keysize);
+        id = key ? hsm_get_key_id(ctx, key) : NULL;
+        if (!id) {
+            ods_log_error("[%s] unable to create %lu bits key in %s",
+                bench_str, bench->keysize, bench->repository);
+            hsm_key_free(key);
+            hsm_destroy_context(ctx);
+            return ODS_STATUS_HSM_ERR;
+        }
+        (void) snprintf(i ? bench->zsk : bench->ksk, sizeof(bench->ksk),
+            "%s", id);
+        free((void*) id);
+        hsm_key_free(key);
+    }
+    hsm_destroy_context(ctx);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Remove the signing keys.
+ *
+ */
+static void
+bench_remove_keys(bench_type* bench)
+{
+    hsm_ctx_t* ctx = NULL;
+    hsm_key_t* key = NULL;
+    const char* ids[2];
+    int i = 0;
+
+    ids[0] = bench->ksk;
+    ids[1] = bench->zsk;
+    ctx = hsm_create_context();
+    if (!ctx) {
+        return;
+    }
+    for (i=0; i < 2; i++) {
+        if (!ids[i][0]) {
+            continue;
+        }
+        key = hsm_find_key_by_id(ctx, ids[i]);
+        if (key) {
+            (void) hsm_remove_key(ctx, key);
+            hsm_key_free(key);
+        }
+    }
+    hsm_destroy_context(ctx);
+    return;
+}
+
+
+/**
+ * Write the signer configuration.
+ *
+ */
+static ods_status
+bench_write_signconf(bench_type* bench)
+{
+    FILE* fd = ods_fopen(BENCH_SIGNCONF, NULL, "w");
+    if (!fd) {
+        return ODS_STATUS_FOPEN_ERR;
+    }
+    fprintf(fd, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<SignerConfiguration>\n"
+        "\t<Zone name=\"%s\">\n"
+        "\t\t<Signatures>\n"
+        "\t\t\t<Resign>PT2H</Resign>\n"
+        "\t\t\t<Refresh>P3D</Refresh>\n"
+        "\t\t\t<Validity>\n"
+        "\t\t\t\t<Default>P7D</Default>\n"
+        "\t\t\t\t<Denial>P14D</Denial>\n"
+        "\t\t\t</Validity>\n"
+        "\t\t\t<Jitter>PT12H</Jitter>\n"
+        "\t\t\t<InceptionOffset>PT300S</InceptionOffset>\n"
+        "\t\t</Signatures>\n"
+        "\t\t<Denial>\n", bench->zone_name);
+    if (bench->nsec3) {
+        fprintf(fd, "\t\t\t<NSEC3>\n%s"
+            "\t\t\t\t<Hash>\n"
+            "\t\t\t\t\t<Algorithm>1</Algorithm>\n"
+            "\t\t\t\t\t<Iterations>5</Iterations>\n"
+            "\t\t\t\t\t<Salt>aabbccdd</Salt>\n"
+            "\t\t\t\t</Hash>\n"
+            "\t\t\t</NSEC3>\n", bench->optout ? "\t\t\t\t<OptOut/>\n" : "");
+    } else {
+        fprintf(fd, "\t\t\t<NSEC/>\n");
+    }
+    fprintf(fd, "\t\t</Denial>\n"
+        "\t\t<Keys>\n"
+        "\t\t\t<TTL>PT3600S</TTL>\n"
+        "\t\t\t<Key>\n"
+        "\t\t\t\t<Flags>257</Flags>\n"
+        "\t\t\t\t<Algorithm>8</Algorithm>\n"
+        "\t\t\t\t<Locator>%s</Locator>\n"
+        "\t\t\t\t<KSK/>\n"
+        "\t\t\t\t<Publish/>\n"
+        "\t\t\t</Key>\n"
+        "\t\t\t<Key>\n"
+        "\t\t\t\t<Flags>256</Flags>\n"
+        "\t\t\t\t<Algorithm>8</Algorithm>\n"
+        "\t\t\t\t<Locator>%s</Locator>\n"
+        "\t\t\t\t<ZSK/>\n"
+        "\t\t\t\t<Publish/>\n"
+        "\t\t\t</Key>\n"
+        "\t\t</Keys>\n"
+        "\t\t<SOA>\n"
+        "\t\t\t<TTL>PT3600S</TTL>\n"
+        "\t\t\t<Minimum>PT3600S</Minimum>\n"
+        "\t\t\t<Serial>unixtime</Serial>\n"
+        "\t\t</SOA>\n"
+        "\t</Zone>\n"
+        "</SignerConfiguration>\n", bench->ksk, bench->zsk);
+    ods_fclose(fd);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Write the synthetic zone. Every domain is either a delegation, with
+ * glue and for every other delegation a DS, or holds an A RRset of the
+ * requested size and a TXT record.
+ *
+ */
+static ods_status
+bench_write_zone(bench_type* bench)
+{
+    const char* z = bench->zone_name;
+    FILE* fd = NULL;
+    size_t i = 0;
+    size_t j = 0;
+
+    fd = ods_fopen(BENCH_ZONEFILE, NULL, "w");
+    if (!fd) {
+        return ODS_STATUS_FOPEN_ERR;
+    }
+    fprintf(fd, "%s. 3600 IN SOA ns1.%s. hostmaster.%s. 1 7200 3600 "
+        "1209600 3600\n", z, z, z);
+    fprintf(fd, "%s. 3600 IN NS ns1.%s.\n", z, z);
+    fprintf(fd, "%s. 3600 IN NS ns2.%s.\n", z, z);
+    fprintf(fd, "ns1.%s. 3600 IN A 192.0.2.1\n", z);
+    fprintf(fd, "ns2.%s. 3600 IN A 192.0.2.2\n", z);
+    bench->rr_count = 5;
+    for (i=0; i < bench->domains; i++) {
+        if ((int) (i % 100) < bench->delegations) {
+            fprintf(fd, "d%lu.%s. 3600 IN NS ns.d%lu.%s.\n",
+                (unsigned long) i, z, (unsigned long) i, z);
+            fprintf(fd, "ns.d%lu.%s. 3600 IN A 198.51.100.%lu\n",
+                (unsigned long) i, z, (unsigned long) (i % 254) + 1);
+            bench->rr_count += 2;
+            if (i % 2) {
+                fprintf(fd, "d%lu.%s. 3600 IN DS %lu 8 2 "
+                    "2BB183AF5F22588179A53B0A98631FAD1A292118A5D4A2E1"
+                    "D4B6AC3B52D3E6E5\n", (unsigned long) i, z,
+                    (unsigned long) (i % 65535));
+                bench->rr_count++;
+            }
+            continue;
+        }
+        for (j=0; j < bench->rrset_size; j++) {
+            fprintf(fd, "d%lu.%s. 3600 IN A 10.%lu.%lu.%lu\n",
+                (unsigned long) i, z, (unsigned long) (j % 256),
+                (unsigned long) ((i / 256) % 256), (unsigned long) (i % 256));
+        }
+        fprintf(fd, "d%lu.%s. 3600 IN TXT \"signer benchmark %lu\"\n",
+            (unsigned long) i, z, (unsigned long) i);
+        bench->rr_count += bench->rrset_size + 1;
+    }
+    ods_fclose(fd);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Collect the RRsets that need signing.
+ *
+ */
+static rrset_type**
+bench_collect_rrsets(zone_type* zone, size_t* count)
+{
+    ldns_rbnode_t* node = LDNS_RBTREE_NULL;
+    domain_type* domain = NULL;
+    denial_type* denial = NULL;
+    rrset_type** rrsets = NULL;
+    size_t max = 0;
+    size_t i = 0;
+
+    *count = 0;
+    node = ldns_rbtree_first(zone->db->domains);
+    while (node && node != LDNS_RBTREE_NULL) {
+        domain = (domain_type*) node->data;
+        max += domain->rrset_count + 1;
+        node = ldns_rbtree_next(node);
+    }
+    rrsets = (rrset_type**) malloc((max + 1) * sizeof(rrset_type*));
+    if (!rrsets) {
+        return NULL;
+    }
+    node = ldns_rbtree_first(zone->db->domains);
+    while (node && node != LDNS_RBTREE_NULL) {
+        domain = (domain_type*) node->data;
+        for (i=0; i < domain->rrset_count; i++) {
+            rrsets[(*count)++] = domain->rrsets[i];
+        }
+        denial = (denial_type*) domain->denial;
+        if (denial && denial->rrset) {
+            rrsets[(*count)++] = denial->rrset;
+        }
+        node = ldns_rbtree_next(node);
+    }
+    return rrsets;
+}
+
+
+/**
+ * Sign RRsets until there are none left.
+ *
+ */
+static void*
+bench_sign(void* arg)
+{
+    bench_sign_type* work = (bench_sign_type*) arg;
+    hsm_ctx_t* ctx = NULL;
+    rrset_type* rrset = NULL;
+    ods_status status = ODS_STATUS_OK;
+
+    ctx = hsm_create_context();
+    if (!ctx) {
+        ods_log_error("[%s] unable to sign: hsm_create_context() failed",
+            bench_str);
+        return NULL;
+    }
+    while (1) {
+        lock_basic_lock(&work->lock);
+        rrset = work->next < work->count ? work->rrsets[work->next++] : NULL;
+        lock_basic_unlock(&work->lock);
+        if (!rrset) {
+            break;
+        }
+        status = rrset_sign(ctx, rrset, work->signtime);
+        if (status != ODS_STATUS_OK) {
+            lock_basic_lock(&work->lock);
+            work->failed++;
+            lock_basic_unlock(&work->lock);
+        }
+    }
+    hsm_destroy_context(ctx);
+    return NULL;
+}
+
+
+/**
+ * Sign the zone with a number of threads.
+ *
+ */
+static ods_status
+bench_sign_zone(zone_type* zone, int threads)
+{
+    bench_sign_type work;
+#ifdef HAVE_PTHREAD
+    ods_thread_type tid[BENCH_MAX_THREADS];
+    int i = 0;
+#endif
+
+    work.rrsets = bench_collect_rrsets(zone, &work.count);
+    if (!work.rrsets) {
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    work.next = 0;
+    work.failed = 0;
+    work.signtime = time_now();
+    lock_basic_init(&work.lock);
+#ifdef HAVE_PTHREAD
+    for (i=0; i < threads; i++) {
+        ods_thread_create(&tid[i], bench_sign, (void*) &work);
+    }
+    for (i=0; i < threads; i++) {
+        ods_thread_join(tid[i]);
+    }
+#else
+    (void) threads;
+    (void) bench_sign((void*) &work);
+#endif
+    lock_basic_destroy(&work.lock);
+    free((void*) work.rrsets);
+    if (work.failed) {
+        ods_log_error("[%s] unable to sign %lu RRsets", bench_str,
+            (unsigned long) work.failed);
+        return ODS_STATUS_ERR;
+    }
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Export the zone to a file.
+ *
+ */
+static ods_status
+bench_export(zone_type* zone, const char* filename, int threads)
+{
+    ods_status status = ODS_STATUS_OK;
+    FILE* fd = ods_fopen(filename, NULL, "w");
+    if (!fd) {
+        return ODS_STATUS_FOPEN_ERR;
+    }
+    namedb_export(fd, zone->db, threads, &status);
+    ods_fclose(fd);
+    return status;
+}
+
+
+/**
+ * Are two files the same?
+ *
+ */
+static int
+bench_same_file(const char* file1, const char* file2)
+{
+    char buf1[BUFSIZ];
+    char buf2[BUFSIZ];
+    size_t len1 = 0;
+    size_t len2 = 0;
+    int same = 1;
+    FILE* fd1 = ods_fopen(file1, NULL, "r");
+    FILE* fd2 = ods_fopen(file2, NULL, "r");
+    if (!fd1 || !fd2) {
+        same = 0;
+    }
+    while (same) {
+        len1 = fread(buf1, 1, sizeof(buf1), fd1);
+        len2 = fread(buf2, 1, sizeof(buf2), fd2);
+        if (len1 != len2 || memcmp(buf1, buf2, len1) != 0) {
+            same = 0;
+        } else if (len1 == 0) {
+            break;
+        }
+    }
+    if (fd1) {
+        ods_fclose(fd1);
+    }
+    if (fd2) {
+        ods_fclose(fd2);
+    }
+    return same;
+}
+
+
+/**
+ * Check the parallel zone export against the single-threaded one.
+ *
+ */
+static ods_status
+bench_check_export(zone_type* zone, int threads)
+{
+    ods_status status = ODS_STATUS_OK;
+    uint64_t start = 0;
+    size_t domains = (size_t) zone->db->domains->count;
+
+    start = metrics_now();
+    status = bench_export(zone, BENCH_EXPORT_SEQ, 1);
+    if (status != ODS_STATUS_OK) {
+        return status;
+    }
+    bench_report("export 1", start, domains, "domains");
+    start = metrics_now();
+    status = bench_export(zone, BENCH_EXPORT_PAR, threads);
+    if (status != ODS_STATUS_OK) {
+        return status;
+    }
+    bench_report("export n", start, domains, "domains");
+    if (!bench_same_file(BENCH_EXPORT_SEQ, BENCH_EXPORT_PAR)) {
+        ods_log_error("[%s] export with %d threads differs from the "
+            "single-threaded export", bench_str, threads);
+        return ODS_STATUS_ERR;
+    }
+    fprintf(stdout, "%-10s %d threads, same output as 1 thread\n",
+        " export", threads);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Values the signconf reader looks up, one parse each in the old reader.
+ */
+static const char* bench_signconf_exprs[] = {
+    "//SignerConfiguration/Zone/Keys/Key",
+    "//SignerConfiguration/Zone/Signatures/Resign",
+    "//SignerConfiguration/Zone/Signatures/Refresh",
+    "//SignerConfiguration/Zone/Signatures/Validity/Default",
+    "//SignerConfiguration/Zone/Signatures/Validity/Denial",
+    "//SignerConfiguration/Zone/Signatures/Jitter",
+    "//SignerConfiguration/Zone/Signatures/InceptionOffset",
+    "//SignerConfiguration/Zone/Keys/TTL",
+    "//SignerConfiguration/Zone/SOA/TTL",
+    "//SignerConfiguration/Zone/SOA/Minimum",
+    "//SignerConfiguration/Zone/Signatures/MaxZoneTTL",
+    "//SignerConfiguration/Zone/Denial/NSEC3",
+    "//SignerConfiguration/Zone/Denial/NSEC",
+    "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Algorithm",
+    "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Iterations",
+    "//SignerConfiguration/Zone/Denial/NSEC3/OptOut",
+    "//SignerConfiguration/Zone/SOA/Serial",
+    "//SignerConfiguration/Zone/Denial/NSEC3/Hash/Salt",
+    NULL
+};
+
+
+/**
+ * Time parsing the signer configuration the way the signer used to: compile
+ * the schema for every check and parse the file again for every value.
+ *
+ */
+static uint64_t
+bench_parse_signconf_old(int iterations)
+{
+    const char* rngfile = ODS_SE_RNGDIR "/signconf.rng";
+    const char* str = NULL;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    int i = 0;
+    int e = 0;
+
+    /* without the schema cache */
+    parse_rng_cleanup();
+    start = metrics_now();
+    for (i=0; i < iterations; i++) {
+        if (parse_file_check(BENCH_SIGNCONF, rngfile) != ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to check %s", bench_str,
+                BENCH_SIGNCONF);
+            break;
+        }
+        for (e=0; bench_signconf_exprs[e]; e++) {
+            str = parse_conf_string(BENCH_SIGNCONF, bench_signconf_exprs[e],
+                0);
+            free((void*)str);
+        }
+    }
+    elapsed = metrics_now() - start;
+    bench_report("parse old", start, (size_t) i, "signconf");
+    parse_rng_init();
+    return i == iterations ? elapsed : 0;
+}
+
+
+/**
+ * Time parsing the signer configuration, against the old way.
+ *
+ */
+static void
+bench_parse_signconf(int iterations)
+{
+    signconf_type* signconf = NULL;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    uint64_t old = 0;
+    int i = 0;
+
+    old = bench_parse_signconf_old(iterations);
+    start = metrics_now();
+    for (i=0; i < iterations; i++) {
+        signconf = NULL;
+        if (signconf_update(&signconf, BENCH_SIGNCONF, 0) != ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to parse %s", bench_str,
+                BENCH_SIGNCONF);
+            return;
+        }
+        signconf_cleanup(signconf);
+    }
+    elapsed = metrics_now() - start;
+    bench_report("parse new", start, (size_t) iterations, "signconf");
+    if (old && elapsed) {
+        fprintf(stdout, "%-10s %.1fx faster than the old reader\n",
+            " parse", (double) old / elapsed);
+    }
+    return;
+}
+
+
+/**
+ * Run the pipeline.
+ *
+ */
+static ods_status
+bench_run(bench_type* bench)
+{
+    zone_type* zone = NULL;
+    metrics_type metrics;
+    histogram_type* h = NULL;
+    char* name = NULL;
+    uint64_t start = 0;
+    uint64_t nsecify = 0;
+    struct stat st;
+    ods_status status = ODS_STATUS_OK;
+
+    fprintf(stdout, "%-10s %12s %10s %-8s %14s %13s\n", "stage", "time",
+        "count", "", "throughput", "peak memory");
+    start = metrics_now();
+    status = bench_create_keys(bench);
+    if (status != ODS_STATUS_OK) {
+        return status;
+    }
+    bench_report("keygen", start, 2, "keys");
+    start = metrics_now();
+    status = bench_write_signconf(bench);
+    if (status == ODS_STATUS_OK) {
+        status = bench_write_zone(bench);
+    }
+    if (status != ODS_STATUS_OK) {
+        ods_log_error("[%s] unable to write input files: %s", bench_str,
+            ods_status2str(status));
+        return status;
+    }
+    bench_report("generate", start, bench->rr_count, "RRs");
+    if (bench->parse_iterations > 0) {
+        bench_parse_signconf(bench->parse_iterations);
+    }
+    /* set up the zone */
+    name = strdup(bench->zone_name);
+    zone = name ? zone_create(name, LDNS_RR_CLASS_IN) : NULL;
+    free((void*) name);
+    if (!zone) {
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    zone->signconf_filename = strdup(BENCH_SIGNCONF);
+    zone->adinbound = adapter_create(BENCH_ZONEFILE, ADAPTER_FILE, 1);
+    zone->adoutbound = adapter_create(BENCH_SIGNEDFILE, ADAPTER_FILE, 0);
+    if (!zone->signconf_filename || !zone->adinbound || !zone->adoutbound) {
+        zone_cleanup(zone);
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    /* configure */
+    start = metrics_now();
+    status = tools_signconf(zone);
+    if (status != ODS_STATUS_OK) {
+        goto bench_done;
+    }
+    bench_report("signconf", start, 1, "files");
+    /* read, includes nsecify */
+    start = metrics_now();
+    status = tools_input(zone, bench->threads);
+    if (status != ODS_STATUS_OK) {
+        goto bench_done;
+    }
+    bench_report("read", start, bench->rr_count, "RRs");
+    metrics_collect(&metrics);
+    h = &metrics.histograms[METRIC_NSECIFY];
+    nsecify = h->sum;
+    fprintf(stdout, "%-10s %10.3f s %10lu %-8s\n", " nsecify",
+        (double) nsecify / 1000000000, (unsigned long) zone->stats->nsec_count,
+        "denials");
+    /* sign */
+    status = zone_update_serial(zone);
+    if (status != ODS_STATUS_OK) {
+        goto bench_done;
+    }
+    start = metrics_now();
+    status = bench_sign_zone(zone, bench->threads);
+    if (status != ODS_STATUS_OK) {
+        goto bench_done;
+    }
+    metrics_collect(&metrics);
+    bench_report("sign", start,
+        (size_t) metrics.counters[COUNTER_SIGNATURES], "RRSIGs");
+    h = &metrics.histograms[METRIC_HSM_SIGN];
+    fprintf(stdout, "%-10s p50 %.3f ms, p99 %.3f ms per HSM call\n",
+        " hsm", (double) metrics_quantile(h, 0.5) / 1000000,
+        (double) metrics_quantile(h, 0.99) / 1000000);
+    /* write */
+    start = metrics_now();
+    status = adapter_write((void*) zone, bench->threads);
+    if (status != ODS_STATUS_OK) {
+        goto bench_done;
+    }
+    bench_report("write", start, bench->rr_count, "RRs");
+    if (stat(BENCH_SIGNEDFILE, &st) == 0) {
+        fprintf(stdout, "%-10s %10lu bytes signed zone\n", " size",
+            (unsigned long) st.st_size);
+    }
+    /* the parallel export must not change the output */
+    if (bench->threads > 1) {
+        status = bench_check_export(zone, bench->threads);
+    }
+
+bench_done:
+    if (status != ODS_STATUS_OK) {
+        ods_log_error("[%s] benchmark of zone %s failed: %s", bench_str,
+            bench->zone_name, ods_status2str(status));
+    }
+    zone_cleanup(zone);
+    return status;
+}
+
+
+/**
+ * Remove the generated files.
+ *
+ */
+static void
+bench_cleanup_dir(bench_type* bench)
+{
+    DIR* dir = NULL;
+    struct dirent* entry = NULL;
+
+    if (chdir("/") != 0) {
+        return;
+    }
+    dir = opendir(bench->dir);
+    if (dir) {
+        while ((entry = readdir(dir)) != NULL) {
+            char path[sizeof(bench->dir) + 256];
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            (void) snprintf(path, sizeof(path), "%s/%s", bench->dir,
+                entry->d_name);
+            (void) unlink(path);
+        }
+        closedir(dir);
+    }
+    (void) rmdir(bench->dir);
+    return;
+}
+
+
+/**
+ * Main. Generate a zone and run the signer on it.
+ *
+ */
+int
+main(int argc, char* argv[])
+{
+    bench_type bench;
+    ods_status status = ODS_STATUS_OK;
+    int verbosity = 0;
+    int c = 0;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.cfgfile = ODS_SE_CFGFILE;
+    bench.zone_name = "bench.example";
+    bench.keysize = 1024;
+    /* several export ranges, so a default run also covers the parallel
+     * zone export */
+    bench.domains = 25000;
+    bench.rrset_size = 1;
+    bench.delegations = 10;
+    bench.threads = 4;
+    while ((c=getopt(argc, argv, "3a:c:d:hkn:op:r:s:t:vz:")) != -1) {
+        switch (c) {
+            case '3':
+                bench.nsec3 = 1;
+                break;
+            case 'a':
+                bench.rrset_size = (size_t) atol(optarg);
+                break;
+            case 'c':
+                bench.cfgfile = optarg;
+                break;
+            case 'd':
+                bench.delegations = atoi(optarg);
+                break;
+            case 'h':
+                usage(stdout);
+                exit(0);
+                break;
+            case 'k':
+                bench.keep = 1;
+                break;
+            case 'n':
+                bench.domains = (size_t) atol(optarg);
+                break;
+            case 'o':
+                bench.nsec3 = 1;
+                bench.optout = 1;
+                break;
+            case 'p':
+                bench.parse_iterations = atoi(optarg);
+                break;
+            case 'r':
+                bench.repository = optarg;
+                break;
+            case 's':
+                bench.keysize = (unsigned long) atol(optarg);
+                break;
+            case 't':
+                bench.threads = atoi(optarg);
+                break;
+            case 'v':
+                verbosity++;
+                break;
+            case 'z':
+                bench.zone_name = optarg;
+                break;
+            default:
+                usage(stderr);
+                exit(2);
+                break;
+        }
+    }
+    if (!bench.repository || optind != argc || bench.rrset_size < 1 ||
+        bench.delegations < 0 || bench.delegations > 100 ||
+        bench.threads < 1 || bench.threads > BENCH_MAX_THREADS) {
+        usage(stderr);
+        exit(2);
+    }
+    ods_log_init(NULL, 0, verbosity);
+    /* work in a scratch directory, that is where the signer puts files */
+    (void) snprintf(bench.dir, sizeof(bench.dir), "/tmp/signer-bench.XXXXXX");
+    if (!mkdtemp(bench.dir) || chdir(bench.dir) != 0) {
+        fprintf(stderr, "unable to create scratch directory\n");
+        exit(1);
+    }
+    xmlInitGlobals();
+    xmlInitParser();
+    xmlInitThreads();
+    parse_rng_init();
+    metrics_init();
+    if (lhsm_open(bench.cfgfile) != HSM_OK) {
+        fprintf(stderr, "unable to open HSM, see %s\n", bench.cfgfile);
+        status = ODS_STATUS_HSM_ERR;
+    } else {
+        fprintf(stdout, "zone %s: %lu domains, %d%% delegations, %lu A "
+            "records per RRset, %s, %d threads\n", bench.zone_name,
+            (unsigned long) bench.domains, bench.delegations,
+            (unsigned long) bench.rrset_size,
+            bench.nsec3 ? (bench.optout ? "NSEC3 Opt-Out" : "NSEC3") :
+            "NSEC", bench.threads);
+        status = bench_run(&bench);
+        if (bench.keep) {
+            if (bench.ksk[0] || bench.zsk[0]) {
+                fprintf(stdout, "generated keys kept: KSK %s, ZSK %s\n",
+                    bench.ksk[0] ? bench.ksk : "none",
+                    bench.zsk[0] ? bench.zsk : "none");
+            }
+        } else {
+            bench_remove_keys(&bench);
+        }
+        hsm_close();
+    }
+    parse_rng_cleanup();
+    xmlCleanupParser();
+    xmlCleanupGlobals();
+    xmlCleanupThreads();
+    if (bench.keep) {
+        fprintf(stdout, "generated files kept in %s\n", bench.dir);
+    } else {
+        bench_cleanup_dir(&bench);
+    }
+    ods_log_close();
+    return status == ODS_STATUS_OK ? 0 : 1;
+}
@@ -42,6 +42,7 @@
 #include "signer/backup.h"
 #include "signer/zone.h"
 
+#include <ctype.h>
 #include <ldns/ldns.h>
 
 static const char* backup_str = "backup";
@@ -55,12 +56,26 @@ char*
 backup_read_token(FILE* in)
 {
     static char buf[4000];
+    size_t i = 0;
+    int c = 0;
     buf[sizeof(buf)-1]=0;
 
     while (1) {
-        if (fscanf(in, "%3990s", buf) != 1) {
+        /* same as fscanf(in, "%3990s", buf), without the format parsing */
+        while ((c = getc(in)) != EOF && isspace(c)) {
+            /* skip */
+        }
+        if (c == EOF) {
             return 0;
         }
+        i = 0;
+        do {
+            buf[i++] = (char) c;
+        } while (i < 3990 && (c = getc(in)) != EOF && !isspace(c));
+        buf[i] = 0;
+        if (c != EOF && isspace(c)) {
+            ungetc(c, in);
+        }
         if (buf[0] != '#') {
             return buf;
         }
@@ -81,17 +81,15 @@ denial_create_bitmap(denial_type* denial, ldns_rr_type types[],
     size_t* types_count)
 {
     domain_type* domain = NULL;
-    rrset_type* rrset = NULL;
+    size_t i = 0;
 
     ods_log_assert(denial);
     ods_log_assert(denial->domain);
 
     domain = (domain_type*) denial->domain;
-    rrset = domain->rrsets;
-    while (rrset) {
-        types[*types_count] = rrset->rrtype;
+    for (i=0; i < domain->rrset_count; i++) {
+        types[*types_count] = domain->rrsets[i]->rrtype;
         *types_count = *types_count + 1;
-        rrset = rrset->next;
     }
     return;
 }
@@ -206,7 +204,7 @@ denial_create_nsec(denial_type* denial, denial_type* nxt, uint32_t ttl,
         dstatus = domain_is_occluded(domain);
         if (dstatus == LDNS_RR_TYPE_SOA) {
             dstatus = domain_is_delegpt(domain);
-            if (dstatus != LDNS_RR_TYPE_NS && domain->rrsets) {
+            if (dstatus != LDNS_RR_TYPE_NS && domain->rrset_count) {
                  /* Authoritative domain, not empty: add RRSIGs */
                  types[types_count] = LDNS_RR_TYPE_RRSIG;
                  types_count++;
@@ -336,16 +334,16 @@ denial_nsecify(denial_type* denial, denial_type* nxt, uint32_t* num_added)
  *
  */
 void
-denial_print(FILE* fd, denial_type* denial, ods_status* status)
+denial_print(rrprint_type* printer, denial_type* denial, ods_status* status)
 {
-    if (!denial || !fd) {
+    if (!denial || !printer) {
         if (status) {
             *status = ODS_STATUS_ASSERT_ERR;
         }
         return;
     }
     if (denial->rrset) {
-        rrset_print(fd, denial->rrset, 0, status);
+        rrset_print(printer, denial->rrset, 0, status);
     }
     return;
 }
@@ -113,6 +113,9 @@ domain_create(void* zoneptr, ldns_rdf* dname)
     domain->denial = NULL; /* no reference yet */
     domain->node = NULL; /* not in db yet */
     domain->rrsets = NULL;
+    domain->rrset_count = 0;
+    domain->delegpt = LDNS_RR_TYPE_SOA;
+    domain->dstatus = LDNS_RR_TYPE_SOA;
     domain->parent = NULL;
     domain->is_apex = 0;
     domain->is_new = 0;
@@ -127,17 +130,10 @@ domain_create(void* zoneptr, ldns_rdf* dname)
 size_t
 domain_count_rrset(domain_type* domain)
 {
-    rrset_type* rrset = NULL;
-    size_t count = 0;
     if (!domain) {
         return 0;
     }
-    rrset = domain->rrsets;
-    while (rrset) {
-        count++; /* rr_count may be zero */
-        rrset = rrset->next;
-    }
-    return count;
+    return domain->rrset_count; /* rr_count may be zero */
 }
 
 
@@ -148,22 +144,131 @@ domain_count_rrset(domain_type* domain)
 size_t
 domain_count_rrset_is_added(domain_type* domain)
 {
-    rrset_type* rrset = NULL;
+    size_t i = 0;
     size_t count = 0;
     if (!domain) {
         return 0;
     }
-    rrset = domain->rrsets;
-    while (rrset) {
-        if (rrset_count_rr_is_added(rrset)) {
+    for (i=0; i < domain->rrset_count; i++) {
+        if (rrset_count_rr_is_added(domain->rrsets[i])) {
             count++;
         }
-        rrset = rrset->next;
     }
     return count;
 }
 
 
+/**
+ * Search RRset position at this domain.
+ *
+ */
+static int
+domain_search_rrset(domain_type* domain, ldns_rr_type rrtype, size_t* pos)
+{
+    size_t lo = 0;
+    size_t hi = 0;
+    size_t mid = 0;
+    ods_log_assert(domain);
+    ods_log_assert(pos);
+    hi = domain->rrset_count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (domain->rrsets[mid]->rrtype == rrtype) {
+            *pos = mid;
+            return 1;
+        } else if (domain->rrsets[mid]->rrtype < rrtype) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    /* not found, lo is the insert position */
+    *pos = lo;
+    return 0;
+}
+
+
+/**
+ * Update the cached status of the domains below this domain.
+ *
+ */
+static void
+domain_update_descendants(domain_type* domain)
+{
+    ldns_rbnode_t* n = LDNS_RBTREE_NULL;
+    domain_type* d = NULL;
+    ods_log_assert(domain);
+    if (!domain->node) {
+        return; /* not in db yet */
+    }
+    /* canonical order makes sure parents are updated before children */
+    n = ldns_rbtree_next(domain->node);
+    while (n && n != LDNS_RBTREE_NULL) {
+        d = (domain_type*) n->data;
+        if (!ldns_dname_is_subdomain(d->dname, domain->dname)) {
+            break;
+        }
+        domain_update_status(d);
+        n = ldns_rbtree_next(n);
+    }
+    return;
+}
+
+
+/**
+ * An RRset was added to or removed from this domain.
+ *
+ */
+static void
+domain_rrset_changed(domain_type* domain, ldns_rr_type rrtype)
+{
+    if (rrtype == LDNS_RR_TYPE_NS || rrtype == LDNS_RR_TYPE_DS) {
+        domain_update_status(domain);
+    }
+    if (rrtype == LDNS_RR_TYPE_NS || rrtype == LDNS_RR_TYPE_DNAME) {
+        domain_update_descendants(domain);
+    }
+    return;
+}
+
+
+/**
+ * Remove RRset at position from this domain.
+ *
+ */
+static rrset_type*
+domain_remove_rrset(domain_type* domain, size_t pos)
+{
+    rrset_type* rrset = NULL;
+    rrset_type** rrsets_orig = NULL;
+    zone_type* zone = NULL;
+    ods_log_assert(domain);
+    ods_log_assert(pos < domain->rrset_count);
+    zone = (zone_type*) domain->zone;
+    rrset = domain->rrsets[pos];
+    rrsets_orig = domain->rrsets;
+    if (domain->rrset_count == 1) {
+        domain->rrsets = NULL;
+    } else {
+        domain->rrsets = (rrset_type**) allocator_alloc(zone->allocator,
+            (domain->rrset_count - 1) * sizeof(rrset_type*));
+        if (!domain->rrsets) {
+            ods_log_error("[%s] unable to delete RRset: allocator_alloc() "
+                "failed", dname_str);
+            exit(1);
+        }
+        memcpy(domain->rrsets, rrsets_orig, pos * sizeof(rrset_type*));
+        memcpy(domain->rrsets + pos, rrsets_orig + pos + 1,
+            (domain->rrset_count - pos - 1) * sizeof(rrset_type*));
+    }
+    allocator_deallocate(zone->allocator, (void*) rrsets_orig);
+    domain->rrset_count--;
+    rrset->domain = NULL;
+    domain_rrset_changed(domain, rrset->rrtype);
+    return rrset;
+}
+
+
 /**
  * Look up RRset at this domain.
  *
@@ -171,15 +276,14 @@ domain_count_rrset_is_added(domain_type* domain)
 rrset_type*
 domain_lookup_rrset(domain_type* domain, ldns_rr_type rrtype)
 {
-    rrset_type* rrset = NULL;
-    if (!domain || !domain->rrsets || !rrtype) {
+    size_t pos = 0;
+    if (!domain || !domain->rrset_count || !rrtype) {
         return NULL;
     }
-    rrset = domain->rrsets;
-    while (rrset && rrset->rrtype != rrtype) {
-        rrset = rrset->next;
+    if (domain_search_rrset(domain, rrtype, &pos)) {
+        return domain->rrsets[pos];
     }
-    return rrset;
+    return NULL;
 }
 
 
@@ -190,22 +294,37 @@ domain_lookup_rrset(domain_type* domain, ldns_rr_type rrtype)
 void
 domain_add_rrset(domain_type* domain, rrset_type* rrset)
 {
-    rrset_type** p = NULL;
+    rrset_type** rrsets_orig = NULL;
     denial_type* denial = NULL;
+    zone_type* zone = NULL;
+    size_t pos = 0;
     ods_log_assert(domain);
     ods_log_assert(rrset);
-    if (!domain->rrsets) {
-        domain->rrsets = rrset;
-    } else {
-        p = &domain->rrsets;
-        while(*p) {
-            p = &((*p)->next);
-        }
-        *p = rrset;
-        rrset->next = NULL;
+    if (domain_search_rrset(domain, rrset->rrtype, &pos)) {
+        ods_log_error("[%s] unable to add RRset: RRset with RRtype %s "
+            "already exists", dname_str, rrset_type2str(rrset->rrtype));
+        return;
     }
+    zone = (zone_type*) domain->zone;
+    rrsets_orig = domain->rrsets;
+    domain->rrsets = (rrset_type**) allocator_alloc(zone->allocator,
+        (domain->rrset_count + 1) * sizeof(rrset_type*));
+    if (!domain->rrsets) {
+        ods_log_error("[%s] unable to add RRset: allocator_alloc() failed",
+            dname_str);
+        exit(1);
+    }
+    if (rrsets_orig) {
+        memcpy(domain->rrsets, rrsets_orig, pos * sizeof(rrset_type*));
+        memcpy(domain->rrsets + pos + 1, rrsets_orig + pos,
+            (domain->rrset_count - pos) * sizeof(rrset_type*));
+    }
+    allocator_deallocate(zone->allocator, (void*) rrsets_orig);
+    domain->rrsets[pos] = rrset;
+    domain->rrset_count++;
     log_rrset(domain->dname, rrset->rrtype, "+RRSET", LOG_DEBUG);
     rrset->domain = (void*) domain;
+    domain_rrset_changed(domain, rrset->rrtype);
     if (domain->denial) {
         denial = (denial_type*) domain->denial;
         denial->bitmap_changed = 1;
@@ -223,53 +342,22 @@ domain_del_rrset(domain_type* domain, ldns_rr_type rrtype)
 {
     rrset_type* cur = NULL;
     denial_type* denial = NULL;
+    size_t pos = 0;
     if (!domain || !rrtype) {
         return NULL;
     }
-    if (!domain->rrsets) {
+    if (!domain_search_rrset(domain, rrtype, &pos)) {
         ods_log_error("[%s] unable to delete RRset: RRset with RRtype %s "
             "does not exist", dname_str, rrset_type2str(rrtype));
         return NULL;
     }
-    if (domain->rrsets->rrtype == rrtype) {
-        cur = domain->rrsets;
-        domain->rrsets = cur->next;
-        cur->domain = NULL;
-        cur->next = NULL;
-        log_rrset(domain->dname, rrtype, "-RRSET", LOG_DEBUG);
-        if (domain->denial) {
-            denial = (denial_type*) domain->denial;
-            denial->bitmap_changed = 1;
-        }
-        return cur;
-    }
-    cur = domain->rrsets;
-    while (cur) {
-        if (!cur->next) {
-            ods_log_error("[%s] unable to delete RRset: RRset with RRtype %s "
-                "does not exist", dname_str, rrset_type2str(rrtype));
-            return NULL;
-        }
-        ods_log_assert(cur->next);
-        if (cur->next->rrtype != rrtype) {
-            cur = cur->next;
-        } else {
-            ods_log_assert(cur->next->rrtype == rrtype);
-            cur->next = cur->next->next;
-            cur = cur->next;
-            cur->domain = NULL;
-            cur->next = NULL;
-            log_rrset(domain->dname, rrtype, "-RRSET", LOG_DEBUG);
-            if (domain->denial) {
-                denial = (denial_type*) domain->denial;
-                denial->bitmap_changed = 1;
-            }
-            return cur;
-        }
+    cur = domain_remove_rrset(domain, pos);
+    log_rrset(domain->dname, rrtype, "-RRSET", LOG_DEBUG);
+    if (domain->denial) {
+        denial = (denial_type*) domain->denial;
+        denial->bitmap_changed = 1;
     }
-    ods_log_error("[%s] unable to delete RRset: RRset with RRtype %s "
-        "does not exist", dname_str, rrset_type2str(rrtype));
-    return NULL;
+    return cur;
 }
 
 
@@ -282,13 +370,13 @@ domain_diff(domain_type* domain, unsigned is_ixfr)
 {
     denial_type* denial = NULL;
     rrset_type* rrset = NULL;
-    rrset_type* prev_rrset = NULL;
+    size_t i = 0;
 
     if (!domain) {
         return;
     }
-    rrset = domain->rrsets;
-    while (rrset) {
+    while (i < domain->rrset_count) {
+        rrset = domain->rrsets[i];
         if (rrset->rrtype == LDNS_RR_TYPE_NSEC3PARAMS ||
             rrset->rrtype == LDNS_RR_TYPE_DNSKEY) {
             /* always do full diff on NSEC3PARAMS | DNSKEY RRset */
@@ -298,27 +386,16 @@ domain_diff(domain_type* domain, unsigned is_ixfr)
         }
         if (rrset->rr_count <= 0) {
             /* delete entire rrset */
-            if (!prev_rrset) {
-                domain->rrsets = rrset->next;
-            } else {
-                prev_rrset->next = rrset->next;
-            }
-            rrset->next = NULL;
+            rrset = domain_remove_rrset(domain, i);
             log_rrset(domain->dname, rrset->rrtype, "-RRSET", LOG_DEBUG);
             rrset_cleanup(rrset);
-            if (!prev_rrset) {
-                rrset = domain->rrsets;
-            } else {
-                rrset = prev_rrset->next;
-            }
             if (domain->denial) {
                 denial = (denial_type*) domain->denial;
                 denial->bitmap_changed = 1;
             }
         } else {
             /* just go to next rrset */
-            prev_rrset = rrset;
-            rrset = rrset->next;
+            i++;
         }
     }
     return;
@@ -334,15 +411,15 @@ domain_rollback(domain_type* domain)
 {
     denial_type* denial = NULL;
     rrset_type* rrset = NULL;
-    rrset_type* prev_rrset = NULL;
     ldns_rr* del_rr = NULL;
     int del_rrset = 0;
     uint16_t i = 0;
+    size_t j = 0;
     if (!domain) {
         return;
     }
-    rrset = domain->rrsets;
-    while (rrset) {
+    while (j < domain->rrset_count) {
+        rrset = domain->rrsets[j];
         /* walk rrs */
         for (i=0; i < rrset->rr_count; i++) {
             rrset->rrs[i].is_added = 0;
@@ -362,19 +439,9 @@ domain_rollback(domain_type* domain)
         /* next rrset */
         if (del_rrset) {
             /* delete entire rrset */
-            if (!prev_rrset) {
-                domain->rrsets = rrset->next;
-            } else {
-                prev_rrset->next = rrset->next;
-            }
-            rrset->next = NULL;
+            rrset = domain_remove_rrset(domain, j);
             log_rrset(domain->dname, rrset->rrtype, "-RRSET", LOG_DEBUG);
             rrset_cleanup(rrset);
-            if (!prev_rrset) {
-                rrset = domain->rrsets;
-            } else {
-                rrset = prev_rrset->next;
-            }
             if (domain->denial) {
                 denial = (denial_type*) domain->denial;
                 denial->bitmap_changed = 0;
@@ -382,8 +449,7 @@ domain_rollback(domain_type* domain)
             del_rrset = 0;
         } else {
             /* just go to next rrset */
-            prev_rrset = rrset;
-            rrset = rrset->next;
+            j++;
         }
     }
     return;
@@ -401,7 +467,7 @@ domain_ent2unsignedns(domain_type* domain)
     domain_type* d = NULL;
 
     ods_log_assert(domain);
-    if (domain->rrsets) {
+    if (domain->rrset_count) {
         return 0; /* not an empty non-terminal */
     }
     n = ldns_rbtree_next(domain->node);
@@ -410,7 +476,7 @@ domain_ent2unsignedns(domain_type* domain)
         if (!ldns_dname_is_subdomain(d->dname, domain->dname)) {
             break;
         }
-        if (d->rrsets) {
+        if (d->rrset_count) {
             if (domain_is_delegpt(d) == LDNS_RR_TYPE_NS) {
                 /* domain has unsigned delegation */
                 return 1;
@@ -429,27 +495,58 @@ domain_ent2unsignedns(domain_type* domain)
 
 
 /**
- * Check whether the domain is a delegation point.
+ * Update the cached delegation and occlusion status of a domain.
  *
  */
-ldns_rr_type
-domain_is_delegpt(domain_type* domain)
+void
+domain_update_status(domain_type* domain)
 {
+    domain_type* parent = NULL;
     ods_log_assert(domain);
-    if (domain->is_apex) {
-        return LDNS_RR_TYPE_SOA;
-    }
+    /* delegation point? */
     if (domain_lookup_rrset(domain, LDNS_RR_TYPE_NS)) {
         if (domain_lookup_rrset(domain, LDNS_RR_TYPE_DS)) {
             /* Signed delegation */
-            return LDNS_RR_TYPE_DS;
+            domain->delegpt = LDNS_RR_TYPE_DS;
         } else {
             /* Unsigned delegation */
-            return LDNS_RR_TYPE_NS;
+            domain->delegpt = LDNS_RR_TYPE_NS;
         }
+    } else {
+        /* Authoritative */
+        domain->delegpt = LDNS_RR_TYPE_SOA;
+    }
+    /* occluded? */
+    parent = domain->parent;
+    if (!parent || parent->is_apex) {
+        /* Authoritative or delegation */
+        domain->dstatus = LDNS_RR_TYPE_SOA;
+    } else if (domain_lookup_rrset(parent, LDNS_RR_TYPE_NS)) {
+        /* Glue / Empty non-terminal to Glue */
+        domain->dstatus = LDNS_RR_TYPE_A;
+    } else if (domain_lookup_rrset(parent, LDNS_RR_TYPE_DNAME)) {
+        /* Occluded data / Empty non-terminal to Occluded data */
+        domain->dstatus = LDNS_RR_TYPE_DNAME;
+    } else {
+        /* Same as parent */
+        domain->dstatus = parent->dstatus;
     }
-    /* Authoritative */
-    return LDNS_RR_TYPE_SOA;
+    return;
+}
+
+
+/**
+ * Check whether the domain is a delegation point.
+ *
+ */
+ldns_rr_type
+domain_is_delegpt(domain_type* domain)
+{
+    ods_log_assert(domain);
+    if (domain->is_apex) {
+        return LDNS_RR_TYPE_SOA;
+    }
+    return domain->delegpt;
 }
 
 
@@ -460,25 +557,11 @@ domain_is_delegpt(domain_type* domain)
 ldns_rr_type
 domain_is_occluded(domain_type* domain)
 {
-    domain_type* parent = NULL;
     ods_log_assert(domain);
     if (domain->is_apex) {
         return LDNS_RR_TYPE_SOA;
     }
-    parent = domain->parent;
-    while (parent && !parent->is_apex) {
-        if (domain_lookup_rrset(parent, LDNS_RR_TYPE_NS)) {
-            /* Glue / Empty non-terminal to Glue */
-            return LDNS_RR_TYPE_A;
-        }
-        if (domain_lookup_rrset(parent, LDNS_RR_TYPE_DNAME)) {
-            /* Occluded data / Empty non-terminal to Occluded data */
-            return LDNS_RR_TYPE_DNAME;
-        }
-        parent = parent->parent;
-    }
-    /* Authoritative or delegation */
-    return LDNS_RR_TYPE_SOA;
+    return domain->dstatus;
 }
 
 
@@ -487,46 +570,49 @@ domain_is_occluded(domain_type* domain)
  *
  */
 void
-domain_print(FILE* fd, domain_type* domain, ods_status* status)
+domain_print(rrprint_type* printer, domain_type* domain, ods_status* status)
 {
     ldns_rr_type dstatus = LDNS_RR_TYPE_FIRST;
     char* str = NULL;
     rrset_type* rrset = NULL;
     rrset_type* soa_rrset = NULL;
     rrset_type* cname_rrset = NULL;
-    if (!domain || !fd) {
+    size_t i = 0;
+    if (!domain || !printer) {
         if (status) {
             *status = ODS_STATUS_ASSERT_ERR;
         }
         return;
     }
     /* empty non-terminal? */
-    if (!domain->rrsets) {
+    if (!domain->rrset_count) {
         str = ldns_rdf2str(domain->dname);
-        fprintf(fd, ";;Empty non-terminal %s\n", str);
+        (void) rrprint_str(printer, ";;Empty non-terminal ");
+        (void) rrprint_str(printer, str);
+        (void) rrprint_str(printer, "\n");
         free((void*)str);
         /* Denial of Existence */
-        denial_print(fd, (denial_type*) domain->denial, status);
+        denial_print(printer, (denial_type*) domain->denial, status);
         return;
     }
     /* no other data may accompany a CNAME */
     cname_rrset = domain_lookup_rrset(domain, LDNS_RR_TYPE_CNAME);
     if (cname_rrset) {
-        rrset_print(fd, cname_rrset, 0, status);
+        rrset_print(printer, cname_rrset, 0, status);
     } else {
         /* if SOA, print soa first */
         if (domain->is_apex) {
             soa_rrset = domain_lookup_rrset(domain, LDNS_RR_TYPE_SOA);
             if (soa_rrset) {
-                rrset_print(fd, soa_rrset, 0, status);
+                rrset_print(printer, soa_rrset, 0, status);
                 if (status && *status != ODS_STATUS_OK) {
                     return;
                 }
             }
         }
         /* print other RRsets */
-        rrset = domain->rrsets;
-        while (rrset) {
+        for (i=0; i < domain->rrset_count; i++) {
+            rrset = domain->rrsets[i];
             /* skip SOA RRset */
             if (rrset->rrtype != LDNS_RR_TYPE_SOA) {
                 dstatus = domain_is_occluded(domain);
@@ -534,7 +620,7 @@ domain_print(FILE* fd, domain_type* domain, ods_status* status)
                     /* Glue */
                     if (rrset->rrtype == LDNS_RR_TYPE_A ||
                         rrset->rrtype == LDNS_RR_TYPE_AAAA) {
-                        rrset_print(fd, rrset, 0, status);
+                        rrset_print(printer, rrset, 0, status);
                     }
                 } else if (dstatus == LDNS_RR_TYPE_SOA) {
                     /* Authoritative or delegation */
@@ -544,7 +630,7 @@ domain_print(FILE* fd, domain_type* domain, ods_status* status)
                         rrset->rrtype == LDNS_RR_TYPE_AAAA ||
                         rrset->rrtype == LDNS_RR_TYPE_NS ||
                         rrset->rrtype == LDNS_RR_TYPE_DS) {
-                        rrset_print(fd, rrset, 0, status);
+                        rrset_print(printer, rrset, 0, status);
                     }
                 }
                 /* Occluded */
@@ -552,12 +638,10 @@ domain_print(FILE* fd, domain_type* domain, ods_status* status)
             if (status && *status != ODS_STATUS_OK) {
                 return;
             }
-
-            rrset = rrset->next;
         }
     }
     /* Denial of Existence */
-    denial_print(fd, (denial_type*) domain->denial, status);
+    denial_print(printer, (denial_type*) domain->denial, status);
     return;
 }
 
@@ -570,12 +654,16 @@ void
 domain_cleanup(domain_type* domain)
 {
     zone_type* zone = NULL;
+    size_t i = 0;
     if (!domain) {
         return;
     }
     zone = (zone_type*) domain->zone;
     ldns_rdf_deep_free(domain->dname);
-    rrset_cleanup(domain->rrsets);
+    for (i=0; i < domain->rrset_count; i++) {
+        rrset_cleanup(domain->rrsets[i]);
+    }
+    allocator_deallocate(zone->allocator, (void*)domain->rrsets);
     allocator_deallocate(zone->allocator, (void*)domain);
     return;
 }
@@ -586,10 +674,11 @@ domain_cleanup(domain_type* domain)
  *
  */
 void
-domain_backup2(FILE* fd, domain_type* domain, int sigs)
+domain_backup2(rrprint_type* printer, domain_type* domain, int sigs)
 {
     rrset_type* rrset = NULL;
-    if (!domain || !fd) {
+    size_t i = 0;
+    if (!domain || !printer) {
         return;
     }
     /* if SOA, print soa first */
@@ -597,23 +686,22 @@ domain_backup2(FILE* fd, domain_type* domain, int sigs)
         rrset = domain_lookup_rrset(domain, LDNS_RR_TYPE_SOA);
         if (rrset) {
             if (sigs) {
-                rrset_backup2(fd, rrset);
+                rrset_backup2(printer, rrset);
             } else {
-                rrset_print(fd, rrset, 1, NULL);
+                rrset_print(printer, rrset, 1, NULL);
             }
         }
     }
-    rrset = domain->rrsets;
-    while (rrset) {
+    for (i=0; i < domain->rrset_count; i++) {
+        rrset = domain->rrsets[i];
         /* skip SOA RRset */
         if (rrset->rrtype != LDNS_RR_TYPE_SOA) {
             if (sigs) {
-                rrset_backup2(fd, rrset);
+                rrset_backup2(printer, rrset);
             } else {
-                rrset_print(fd, rrset, 1, NULL);
+                rrset_print(printer, rrset, 1, NULL);
             }
         }
-        rrset = rrset->next;
     }
     return;
 }
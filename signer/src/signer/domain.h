@@ -59,7 +59,10 @@ struct domain_struct {
     ldns_rbnode_t* node;
     ldns_rdf* dname;
     domain_type* parent;
-    rrset_type* rrsets;
+    rrset_type** rrsets; /* sorted by RRtype */
+    size_t rrset_count;
+    ldns_rr_type delegpt; /* cached delegation status */
+    ldns_rr_type dstatus; /* cached occlusion status */
     unsigned is_new : 1;
     unsigned is_apex : 1; /* apex */
 };
@@ -139,6 +142,14 @@ void domain_diff(domain_type* domain, unsigned is_ixfr);
  */
 void domain_rollback(domain_type* domain);
 
+/**
+ * Update the cached delegation and occlusion status of a domain.
+ * The status of the parent domain must be up to date.
+ * \param[in] domain domain
+ *
+ */
+void domain_update_status(domain_type* domain);
+
 /**
  * Check whether a domain is an empty non-terminal to an unsigned delegation.
  * \param[in] domain domain
@@ -171,12 +182,13 @@ ldns_rr_type domain_is_occluded(domain_type* domain);
 
 /**
  * Print domain.
- * \param[in] fd file descriptor
+ * \param[in] printer RR printer
  * \param[in] domain domain
  * \param[out] status status
  *
  */
-void domain_print(FILE* fd, domain_type* domain, ods_status* status);
+void domain_print(rrprint_type* printer, domain_type* domain,
+    ods_status* status);
 
 /**
  * Clean up domain.
@@ -187,11 +199,11 @@ void domain_cleanup(domain_type* domain);
 
 /**
  * Backup domain.
- * \param[in] fd file descriptor
+ * \param[in] printer RR printer
  * \param[in] domain domain
  * \param[in] sigs do RRSIGS if true, otherwise do RRset
  *
  */
-void domain_backup2(FILE* fd, domain_type* domain, int sigs);
+void domain_backup2(rrprint_type* printer, domain_type* domain, int sigs);
 
 #endif /* SIGNER_DOMAIN_H */
@@ -187,6 +187,29 @@ ixfr_del_rr(ixfr_type* ixfr, ldns_rr* rr)
 }
 
 
+/**
+ * Does the current part of the ixfr journal hold any changes?
+ *
+ */
+int
+ixfr_changed(ixfr_type* ixfr)
+{
+    zone_type* zone = NULL;
+    if (!ixfr) {
+        return 1;
+    }
+    zone = (zone_type*) ixfr->zone;
+    ods_log_assert(zone);
+    ods_log_assert(zone->db);
+    if (!zone->db->is_initialized || !ixfr->part[0]) {
+        /* no ixfr yet, so everything is new */
+        return 1;
+    }
+    return (ldns_rr_list_rr_count(ixfr->part[0]->plus) > 0 ||
+        ldns_rr_list_rr_count(ixfr->part[0]->min) > 0);
+}
+
+
 /**
  * Print all RRs in list, except SOA RRs.
  *
@@ -86,6 +86,14 @@ void ixfr_add_rr(ixfr_type* ixfr, ldns_rr* rr);
  */
 void ixfr_del_rr(ixfr_type* ixfr, ldns_rr* rr);
 
+/**
+ * Does the current part of the ixfr journal hold any changes?
+ * \param[in] ixfr journal
+ * \return int 1 if there are changes, or if they are not journaled yet
+ *
+ */
+int ixfr_changed(ixfr_type* ixfr);
+
 /**
  * Print the ixfr journal.
  * \param[in] fd file descriptor
@@ -156,9 +156,14 @@ namedb_create(void* zone)
     db->inbserial = 0;
     db->intserial = 0;
     db->outserial = 0;
+    db->sig_expire_min = 0;
+    db->sig_slice = 0;
     db->is_initialized = 0;
     db->is_processed = 0;
     db->serial_updated = 0;
+    db->refresh_due = 1;
+    db->sig_spread = 0;
+    db->force_output = 0;
     return db;
 }
 
@@ -246,6 +251,22 @@ namedb_update_serial(namedb_type* db, const char* format, uint32_t serial)
 }
 
 
+/**
+ * Update the cached status of the domains in a newly entized chain.
+ *
+ */
+static void
+namedb_domain_status(domain_type* domain, domain_type* stop)
+{
+    if (domain->parent && domain->parent != stop) {
+        /* parents first */
+        namedb_domain_status(domain->parent, stop);
+    }
+    domain_update_status(domain);
+    return;
+}
+
+
 /**
  * Add empty non-terminals for domain.
  *
@@ -255,6 +276,7 @@ namedb_domain_entize(namedb_type* db, domain_type* domain, ldns_rdf* apex)
 {
     ldns_rdf* parent_rdf = NULL;
     domain_type* parent_domain = NULL;
+    domain_type* orig_domain = domain;
     ods_log_assert(apex);
     ods_log_assert(domain);
     ods_log_assert(domain->dname);
@@ -298,6 +320,8 @@ namedb_domain_entize(namedb_type* db, domain_type* domain, ldns_rdf* apex)
             domain = NULL;
         }
     }
+    /* new domains inherit the status of the existing parent domain */
+    namedb_domain_status(orig_domain, parent_domain);
     return ODS_STATUS_OK;
 }
 
@@ -363,7 +387,7 @@ namedb_del_domain(namedb_type* db, domain_type* domain)
         log_dname(domain->dname, "ERR -DOMAIN", LOG_ERR);
         return NULL;
     }
-    if (domain->rrsets || domain->denial) {
+    if (domain->rrset_count || domain->denial) {
         ods_log_error("[%s] unable to delete domain: domain in use", db_str);
         log_dname(domain->dname, "ERR -DOMAIN", LOG_ERR);
         return NULL;
@@ -371,7 +395,7 @@ namedb_del_domain(namedb_type* db, domain_type* domain)
     node = ldns_rbtree_delete(db->domains, (const void*)domain->dname);
     if (node) {
         ods_log_assert(domain->node == node);
-        ods_log_assert(!domain->rrsets);
+        ods_log_assert(!domain->rrset_count);
         ods_log_assert(!domain->denial);
         free((void*)node);
         domain->node = NULL;
@@ -411,7 +435,7 @@ domain_is_empty_terminal(domain_type* domain)
     if (domain->is_apex) {
         return 0;
     }
-    if (domain->rrsets) {
+    if (domain->rrset_count) {
         return 0;
     }
     n = ldns_rbtree_next(domain->node);
@@ -454,7 +478,7 @@ namedb_add_nsec_trigger(namedb_type* db, domain_type* domain)
     if (dstatus == LDNS_RR_TYPE_DNAME || dstatus == LDNS_RR_TYPE_A) {
        return; /* don't do occluded/glue domain */
     }
-    if (!domain->rrsets) {
+    if (!domain->rrset_count) {
        return; /* don't do empty domain */
     }
     /* ok, nsecify this domain */
@@ -543,7 +567,7 @@ namedb_del_nsec_trigger(namedb_type* db, domain_type* domain)
     ods_log_assert(domain->denial);
     dstatus = domain_is_occluded(domain);
     if (dstatus == LDNS_RR_TYPE_DNAME || dstatus == LDNS_RR_TYPE_A ||
-        domain_is_empty_terminal(domain) || !domain->rrsets) {
+        domain_is_empty_terminal(domain) || !domain->rrset_count) {
        /* domain has become occluded/glue or empty non-terminal*/
        denial_diff((denial_type*) domain->denial);
        denial = namedb_del_denial(db, domain->denial);
@@ -962,15 +986,210 @@ namedb_wipe_denial(namedb_type* db)
 }
 
 
+/**
+ * Range of domains, formatted by an export thread.
+ *
+ */
+typedef struct namedb_range_struct namedb_range_type;
+struct namedb_range_struct {
+    char* buf;
+    size_t len;
+    ods_status status;
+    int done;
+};
+
+/**
+ * Parallel export state. Threads claim ranges of consecutive domains and
+ * format them into memory, the calling thread writes the ranges out in
+ * order. At most NAMEDB_EXPORT_WINDOW ranges per thread are formatted
+ * ahead of the range being written.
+ *
+ */
+typedef struct namedb_export_struct namedb_export_type;
+struct namedb_export_struct {
+    ldns_rbnode_t* cursor;
+    namedb_range_type* ranges;
+    size_t window;
+    size_t claimed;
+    size_t written;
+    int stop;
+    cond_basic_type cond;
+    lock_basic_type lock;
+};
+
+/** Number of domains in an export range. */
+#define NAMEDB_EXPORT_RANGE 10000
+/** Number of ranges per thread that may wait to be written. */
+#define NAMEDB_EXPORT_WINDOW 2
+
+
+/**
+ * Format domains, starting at node, into memory.
+ *
+ */
+static void
+namedb_export_range(ldns_rbnode_t* node, size_t count,
+    namedb_range_type* range)
+{
+    rrprint_type* printer = rrprint_create(NULL);
+    domain_type* domain = NULL;
+    ods_status status = ODS_STATUS_OK;
+    if (!printer) {
+        range->status = ODS_STATUS_MALLOC_ERR;
+        return;
+    }
+    while (count && node && node != LDNS_RBTREE_NULL &&
+        status == ODS_STATUS_OK) {
+        domain = (domain_type*) node->data;
+        if (domain) {
+            domain_print(printer, domain, &status);
+        }
+        node = ldns_rbtree_next(node);
+        count--;
+    }
+    range->status = rrprint_take(printer, &range->buf, &range->len);
+    if (status != ODS_STATUS_OK) {
+        free(range->buf);
+        range->buf = NULL;
+        range->status = status;
+    }
+    return;
+}
+
+
+/**
+ * Export thread: claim ranges and format them.
+ *
+ */
+static void*
+namedb_export_thread(void* arg)
+{
+    namedb_export_type* exp = (namedb_export_type*) arg;
+    ldns_rbnode_t* first = NULL;
+    size_t count = 0;
+    size_t slot = 0;
+    while (1) {
+        lock_basic_lock(&exp->lock);
+        while (!exp->stop && exp->cursor != LDNS_RBTREE_NULL &&
+            exp->claimed >= exp->written + exp->window) {
+            lock_basic_sleep(&exp->cond, &exp->lock, 0);
+        }
+        if (exp->stop || exp->cursor == LDNS_RBTREE_NULL) {
+            lock_basic_unlock(&exp->lock);
+            break;
+        }
+        first = exp->cursor;
+        for (count = 0; count < NAMEDB_EXPORT_RANGE &&
+            exp->cursor != LDNS_RBTREE_NULL; count++) {
+            exp->cursor = ldns_rbtree_next(exp->cursor);
+        }
+        slot = exp->claimed % exp->window;
+        exp->claimed++;
+        lock_basic_unlock(&exp->lock);
+
+        namedb_export_range(first, count, &exp->ranges[slot]);
+
+        lock_basic_lock(&exp->lock);
+        exp->ranges[slot].done = 1;
+        lock_basic_broadcast(&exp->cond);
+        lock_basic_unlock(&exp->lock);
+    }
+    return NULL;
+}
+
+
+/**
+ * Export db to file, formatting with multiple threads.
+ *
+ */
+static ods_status
+namedb_export_parallel(FILE* fd, namedb_type* db, int threads)
+{
+    namedb_export_type exp;
+    namedb_range_type* range = NULL;
+    ods_thread_type* tids = NULL;
+    ods_status status = ODS_STATUS_OK;
+    size_t i = 0;
+    int t = 0;
+
+    exp.window = (size_t) threads * NAMEDB_EXPORT_WINDOW;
+    exp.ranges = (namedb_range_type*) calloc(exp.window,
+        sizeof(namedb_range_type));
+    tids = (ods_thread_type*) calloc((size_t) threads,
+        sizeof(ods_thread_type));
+    if (!exp.ranges || !tids) {
+        free(exp.ranges);
+        free(tids);
+        return ODS_STATUS_MALLOC_ERR;
+    }
+    exp.cursor = ldns_rbtree_first(db->domains);
+    exp.claimed = 0;
+    exp.written = 0;
+    exp.stop = 0;
+    lock_basic_init(&exp.lock);
+    lock_basic_set(&exp.cond);
+    for (t = 0; t < threads; t++) {
+        ods_thread_create(&tids[t], namedb_export_thread, (void*) &exp);
+    }
+    /* ordered merge */
+    lock_basic_lock(&exp.lock);
+    while (exp.written < exp.claimed || exp.cursor != LDNS_RBTREE_NULL) {
+        range = &exp.ranges[exp.written % exp.window];
+        while (!range->done) {
+            lock_basic_sleep(&exp.cond, &exp.lock, 0);
+        }
+        lock_basic_unlock(&exp.lock);
+        if (status == ODS_STATUS_OK) {
+            status = range->status;
+        }
+        if (status == ODS_STATUS_OK && range->len &&
+            fwrite(range->buf, 1, range->len, fd) != range->len) {
+            ods_log_error("[%s] unable to export: fwrite() failed", db_str);
+            status = ODS_STATUS_FWRITE_ERR;
+        }
+        free(range->buf);
+        range->buf = NULL;
+        range->len = 0;
+        range->status = ODS_STATUS_OK;
+        lock_basic_lock(&exp.lock);
+        range->done = 0;
+        exp.written++;
+        if (status != ODS_STATUS_OK) {
+            exp.stop = 1;
+        }
+        lock_basic_broadcast(&exp.cond);
+        if (exp.stop) {
+            break;
+        }
+    }
+    exp.stop = 1;
+    lock_basic_broadcast(&exp.cond);
+    lock_basic_unlock(&exp.lock);
+    for (t = 0; t < threads; t++) {
+        ods_thread_join(tids[t]);
+    }
+    for (i = 0; i < exp.window; i++) {
+        free(exp.ranges[i].buf);
+    }
+    free(exp.ranges);
+    free(tids);
+    lock_basic_destroy(&exp.lock);
+    lock_basic_off(&exp.cond);
+    return status;
+}
+
+
 /**
  * Export db to file.
  *
  */
 void
-namedb_export(FILE* fd, namedb_type* db, ods_status* status)
+namedb_export(FILE* fd, namedb_type* db, int threads, ods_status* status)
 {
     ldns_rbnode_t* node = LDNS_RBTREE_NULL;
     domain_type* domain = NULL;
+    rrprint_type* printer = NULL;
+    ods_status result = ODS_STATUS_OK;
     if (!fd || !db || !db->domains) {
         if (status) {
             *status = ODS_STATUS_ASSERT_ERR;
@@ -985,13 +1204,31 @@ namedb_export(FILE* fd, namedb_type* db, ods_status* status)
         }
         return;
     }
+    if (threads > 1 && db->domains->count > NAMEDB_EXPORT_RANGE) {
+        result = namedb_export_parallel(fd, db, threads);
+        if (status) {
+            *status = result;
+        }
+        return;
+    }
+    printer = rrprint_create(fd);
+    if (!printer) {
+        if (status) {
+            *status = ODS_STATUS_MALLOC_ERR;
+        }
+        return;
+    }
     while (node && node != LDNS_RBTREE_NULL) {
         domain = (domain_type*) node->data;
         if (domain) {
-            domain_print(fd, domain, status);
+            domain_print(printer, domain, status);
         }
         node = ldns_rbtree_next(node);
     }
+    result = rrprint_cleanup(printer);
+    if (status && *status == ODS_STATUS_OK) {
+        *status = result;
+    }
     return;
 }
 
@@ -1103,40 +1340,46 @@ namedb_backup2(FILE* fd, namedb_type* db)
     ldns_rbnode_t* node = LDNS_RBTREE_NULL;
     domain_type* domain = NULL;
     denial_type* denial = NULL;
+    rrprint_type* printer = NULL;
     if (!fd || !db) {
         return;
     }
+    printer = rrprint_create(fd);
+    if (!printer) {
+        return;
+    }
     node = ldns_rbtree_first(db->domains);
     while (node && node != LDNS_RBTREE_NULL) {
         domain = (domain_type*) node->data;
-        domain_backup2(fd, domain, 0);
+        domain_backup2(printer, domain, 0);
         node = ldns_rbtree_next(node);
     }
-    fprintf(fd, ";\n");
+    (void) rrprint_str(printer, ";\n");
     node = ldns_rbtree_first(db->denials);
     while (node && node != LDNS_RBTREE_NULL) {
         denial = (denial_type*) node->data;
         if (denial->rrset) {
-            rrset_print(fd, denial->rrset, 1, NULL);
+            rrset_print(printer, denial->rrset, 1, NULL);
         }
         node = ldns_rbtree_next(node);
     }
-    fprintf(fd, ";\n");
+    (void) rrprint_str(printer, ";\n");
     /* signatures */
     node = ldns_rbtree_first(db->domains);
     while (node && node != LDNS_RBTREE_NULL) {
         domain = (domain_type*) node->data;
-        domain_backup2(fd, domain, 1);
+        domain_backup2(printer, domain, 1);
         node = ldns_rbtree_next(node);
     }
     node = ldns_rbtree_first(db->denials);
     while (node && node != LDNS_RBTREE_NULL) {
         denial = (denial_type*) node->data;
         if (denial->rrset) {
-            rrset_backup2(fd, denial->rrset);
+            rrset_backup2(printer, denial->rrset);
         }
         node = ldns_rbtree_next(node);
     }
-    fprintf(fd, ";\n");
+    (void) rrprint_str(printer, ";\n");
+    (void) rrprint_cleanup(printer);
     return;
 }
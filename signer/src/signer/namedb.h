@@ -53,9 +53,14 @@ struct namedb_struct {
     uint32_t inbserial;
     uint32_t intserial;
     uint32_t outserial;
+    uint32_t sig_expire_min;
+    uint32_t sig_slice;
     unsigned is_initialized : 1;
     unsigned is_processed : 1;
     unsigned serial_updated : 1;
+    unsigned refresh_due : 1;
+    unsigned sig_spread : 1;
+    unsigned force_output : 1;
 };
 
 /**
@@ -186,10 +191,12 @@ void namedb_nsecify(namedb_type* db, uint32_t* num_added);
  * Export db to file.
  * \param[in] fd file descriptor
  * \param[in] namedb namedb
+ * \param[in] threads number of threads to format the domains with
  * \param[out] status status
  *
  */
-void namedb_export(FILE* fd, namedb_type* db, ods_status* status);
+void namedb_export(FILE* fd, namedb_type* db, int threads,
+    ods_status* status);
 
 /**
  * Wipe out all NSEC(3) RRsets.
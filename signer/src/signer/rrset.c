@@ -191,7 +191,6 @@ rrset_create(void* zoneptr, ldns_rr_type type)
             "failed", rrset_str, (unsigned) type);
         return NULL;
     }
-    rrset->next = NULL;
     rrset->rrs = NULL;
     rrset->rrsigs = NULL;
     rrset->domain = NULL;
@@ -454,18 +453,57 @@ rrset_del_rrsig(rrset_type* rrset, uint16_t rrnum)
 }
 
 
+/**
+ * Is a stale signature in the second half of its refresh window?
+ *
+ */
+static int
+rrset_refresh_urgent(time_t signtime, uint32_t refresh, uint32_t expiration)
+{
+    return (expiration < (uint32_t) signtime +
+        (refresh - (uint32_t) signtime)/2);
+}
+
+
+/**
+ * How many stale signatures of an RRset may be refreshed in this resign?
+ * Urgent signatures always are, others only as long as the resign slice
+ * is not used up. Returns the number of non-urgent ones.
+ *
+ */
+static uint32_t
+rrset_refresh_slice(zone_type* zone, uint32_t urgent, uint32_t stale)
+{
+    uint32_t left = 0;
+    lock_basic_lock(&zone->stats->stats_lock);
+    if (zone->db->sig_slice) {
+        if (zone->stats->sig_refreshed < zone->db->sig_slice) {
+            left = zone->db->sig_slice - zone->stats->sig_refreshed;
+        }
+        if (stale > left) {
+            stale = left;
+        }
+    }
+    zone->stats->sig_refreshed += urgent + stale;
+    lock_basic_unlock(&zone->stats->stats_lock);
+    return stale;
+}
+
+
 /**
  * Recycle signatures from RRset and drop unreusable signatures.
  *
  */
 static uint32_t
 rrset_recycle(rrset_type* rrset, time_t signtime, ldns_rr_type dstatus,
-    ldns_rr_type delegpt)
+    ldns_rr_type delegpt, uint32_t* deferredsigs)
 {
     uint32_t refresh = 0;
     uint32_t expiration = 0;
     uint32_t inception = 0;
     uint32_t reusedsigs = 0;
+    uint32_t urgent = 0;
+    uint32_t stale = 0;
     unsigned drop_sig = 0;
     size_t i = 0;
     key_type* key = NULL;
@@ -480,6 +518,26 @@ rrset_recycle(rrset_type* rrset, time_t signtime, ldns_rr_type dstatus,
         refresh = (uint32_t) (signtime +
             duration2time(zone->signconf->sig_refresh_interval));
     }
+    /* Take the resign slice for the stale signatures once per RRset */
+    if (zone->db->refresh_due && !rrset->needs_signing &&
+        refresh > (uint32_t) signtime && (dstatus == LDNS_RR_TYPE_SOA ||
+        delegpt == LDNS_RR_TYPE_SOA || rrset->rrtype == LDNS_RR_TYPE_DS)) {
+        for (i=0; i < rrset->rrsig_count; i++) {
+            expiration = ldns_rdf2native_int32(
+                ldns_rr_rrsig_expiration(rrset->rrsigs[i].rr));
+            if (expiration >= refresh) {
+                continue;
+            }
+            if (rrset_refresh_urgent(signtime, refresh, expiration)) {
+                urgent++;
+            } else {
+                stale++;
+            }
+        }
+        if (urgent || stale) {
+            stale = rrset_refresh_slice(zone, urgent, stale);
+        }
+    }
     /* Check every signature if it matches the recycling logic. */
     for (i=0; i < rrset->rrsig_count; i++) {
         drop_sig = 0;
@@ -497,12 +555,23 @@ rrset_recycle(rrset_type* rrset, time_t signtime, ldns_rr_type dstatus,
             drop_sig = 1;
             goto recycle_drop_sig;
         }
-        /* 3. Expiration - Refresh has passed */
+        /* 3. Expiration - Refresh has passed, unless the zone batches
+              refreshes and the batch is not due yet, or the resign
+              slice is used up */
         expiration = ldns_rdf2native_int32(
             ldns_rr_rrsig_expiration(rrset->rrsigs[i].rr));
         if (expiration < refresh) {
-            drop_sig = 1;
-            goto recycle_drop_sig;
+            if (zone->db->refresh_due &&
+                rrset_refresh_urgent(signtime, refresh, expiration)) {
+                drop_sig = 1;
+                goto recycle_drop_sig;
+            }
+            if (stale) {
+                stale--;
+                drop_sig = 1;
+                goto recycle_drop_sig;
+            }
+            *deferredsigs += 1;
         }
         /* 4. Inception has not yet passed */
         inception = ldns_rdf2native_int32(
@@ -620,25 +689,48 @@ rrset2rrlist(rrset_type* rrset)
 }
 
 
+/**
+ * Hash owner name and type, to spread signature expirations.
+ *
+ */
+static uint32_t
+rrset_spread_hash(ldns_rdf* owner, ldns_rr_type rrtype)
+{
+    uint32_t hash = 2166136261U; /* FNV-1a */
+    uint8_t* data = NULL;
+    size_t i = 0;
+    if (owner) {
+        data = ldns_rdf_data(owner);
+        for (i=0; i < ldns_rdf_size(owner); i++) {
+            hash = (hash ^ data[i]) * 16777619U;
+        }
+    }
+    hash = (hash ^ (rrtype >> 8)) * 16777619U;
+    hash = (hash ^ (rrtype & 0xff)) * 16777619U;
+    return hash;
+}
+
+
 /**
  * Calculate the signature validation period.
+ * With spreading, the expiration is moved back by a fixed part of the
+ * refresh interval per RRset instead of by random jitter, so that the
+ * refreshes of a zone signed in one pass come back spread out.
  *
  */
 static void
-rrset_sigvalid_period(signconf_type* sc, ldns_rr_type rrtype, time_t signtime,
-    time_t* inception, time_t* expiration)
+rrset_sigvalid_period(signconf_type* sc, ldns_rr_type rrtype, ldns_rdf* owner,
+    time_t signtime, int spread, time_t* inception, time_t* expiration)
 {
     time_t jitter = 0;
     time_t offset = 0;
     time_t validity = 0;
     time_t random_jitter = 0;
+    time_t refresh = 0;
+    time_t window = 0;
     if (!sc || !rrtype || !signtime) {
         return;
     }
-    jitter = duration2time(sc->sig_jitter);
-    if (jitter) {
-        random_jitter = ods_rand(jitter*2);
-    }
     offset = duration2time(sc->sig_inception_offset);
     if (rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
         validity = duration2time(sc->sig_validity_denial);
@@ -646,6 +738,26 @@ rrset_sigvalid_period(signconf_type* sc, ldns_rr_type rrtype, time_t signtime,
         validity = duration2time(sc->sig_validity_default);
     }
     *inception = signtime - offset;
+    if (spread) {
+        /* keep the signature well clear of its own refresh time */
+        refresh = duration2time(sc->sig_refresh_interval);
+        if (validity > refresh) {
+            window = refresh;
+            if (window > (validity - refresh)/2) {
+                window = (validity - refresh)/2;
+            }
+        }
+        *expiration = signtime + validity;
+        if (window > 0) {
+            *expiration -= (time_t) (rrset_spread_hash(owner, rrtype) %
+                (uint32_t) window);
+        }
+        return;
+    }
+    jitter = duration2time(sc->sig_jitter);
+    if (jitter) {
+        random_jitter = ods_rand(jitter*2);
+    }
     *expiration = (signtime + validity + random_jitter) - jitter;
     return;
 }
@@ -661,6 +773,9 @@ rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime)
     zone_type* zone = NULL;
     uint32_t newsigs = 0;
     uint32_t reusedsigs = 0;
+    uint32_t deferredsigs = 0;
+    uint32_t expire_min = 0;
+    uint32_t expire = 0;
     ldns_rr* rrsig = NULL;
     ldns_rr_list* rr_list = NULL;
     rrsig_type* signature = NULL;
@@ -687,7 +802,8 @@ rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime)
         dstatus = domain_is_occluded(domain);
         delegpt = domain_is_delegpt(domain);
     }
-    reusedsigs = rrset_recycle(rrset, signtime, dstatus, delegpt);
+    reusedsigs = rrset_recycle(rrset, signtime, dstatus, delegpt,
+        &deferredsigs);
     rrset->needs_signing = 0;
     /* Skip delegation, glue and occluded RRsets */
     if (dstatus != LDNS_RR_TYPE_SOA) {
@@ -715,8 +831,9 @@ rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime)
         return ODS_STATUS_OK;
     }
     /* Calculate signature validity */
-    rrset_sigvalid_period(zone->signconf, rrset->rrtype, signtime,
-         &inception, &expiration);
+    rrset_sigvalid_period(zone->signconf, rrset->rrtype,
+        ldns_rr_owner(ldns_rr_list_rr(rr_list, 0)), signtime,
+        zone->db->sig_spread, &inception, &expiration);
     /* Walk keys */
     for (i=0; i < zone->signconf->keys->count; i++) {
         /* ZSKs don't sign DNSKEY RRset */
@@ -756,12 +873,25 @@ rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime)
     }
     /* RRset signing completed */
     ldns_rr_list_free(rr_list);
+    /* Earliest expiration, for batching the next refresh */
+    for (i=0; i < rrset->rrsig_count; i++) {
+        expire = ldns_rdf2native_int32(
+            ldns_rr_rrsig_expiration(rrset->rrsigs[i].rr));
+        if (!expire_min || expire < expire_min) {
+            expire_min = expire;
+        }
+    }
     lock_basic_lock(&zone->stats->stats_lock);
     if (rrset->rrtype == LDNS_RR_TYPE_SOA) {
         zone->stats->sig_soa_count += newsigs;
     }
     zone->stats->sig_count += newsigs;
     zone->stats->sig_reuse += reusedsigs;
+    zone->stats->sig_deferred += deferredsigs;
+    if (expire_min && (!zone->stats->sig_expire_min ||
+        expire_min < zone->stats->sig_expire_min)) {
+        zone->stats->sig_expire_min = expire_min;
+    }
     lock_basic_unlock(&zone->stats->stats_lock);
     return ODS_STATUS_OK;
 }
@@ -772,13 +902,13 @@ rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime)
  *
  */
 void
-rrset_print(FILE* fd, rrset_type* rrset, int skip_rrsigs,
+rrset_print(rrprint_type* printer, rrset_type* rrset, int skip_rrsigs,
     ods_status* status)
 {
     uint16_t i = 0;
     ods_status result = ODS_STATUS_OK;
 
-    if (!rrset || !fd) {
+    if (!rrset || !printer) {
         if (status) {
             *status = ODS_STATUS_ASSERT_ERR;
         }
@@ -786,7 +916,7 @@ rrset_print(FILE* fd, rrset_type* rrset, int skip_rrsigs,
     }
     for (i=0; i < rrset->rr_count; i++) {
         if (rrset->rrs[i].exists) {
-            result = util_rr_print(fd, rrset->rrs[i].rr);
+            result = rrprint_rr(printer, rrset->rrs[i].rr, 1);
             if (rrset->rrtype == LDNS_RR_TYPE_CNAME ||
                 rrset->rrtype == LDNS_RR_TYPE_DNAME) {
                 /* singleton types */
@@ -799,7 +929,7 @@ rrset_print(FILE* fd, rrset_type* rrset, int skip_rrsigs,
     }
     if (! (skip_rrsigs || !rrset->rrsig_count)) {
         for (i=0; i < rrset->rrsig_count; i++) {
-            result = util_rr_print(fd, rrset->rrsigs[i].rr);
+            result = rrprint_rr(printer, rrset->rrsigs[i].rr, 1);
             if (result != ODS_STATUS_OK) {
                 break;
             }
@@ -824,8 +954,6 @@ rrset_cleanup(rrset_type* rrset)
     if (!rrset) {
        return;
     }
-    rrset_cleanup(rrset->next);
-    rrset->next = NULL;
     rrset->domain = NULL;
     zone = (zone_type*) rrset->zone;
     for (i=0; i < rrset->rr_count; i++) {
@@ -850,22 +978,22 @@ rrset_cleanup(rrset_type* rrset)
  *
  */
 void
-rrset_backup2(FILE* fd, rrset_type* rrset)
+rrset_backup2(rrprint_type* printer, rrset_type* rrset)
 {
-    char* str = NULL;
+    char str[32];
     uint16_t i = 0;
-    if (!rrset || !fd) {
+    if (!rrset || !printer) {
         return;
     }
     for (i=0; i < rrset->rrsig_count; i++) {
-        str = ldns_rr2str(rrset->rrsigs[i].rr);
-        if (!str) {
+        if (rrprint_rr(printer, rrset->rrsigs[i].rr, 0) != ODS_STATUS_OK) {
             continue;
         }
-        str[(strlen(str))-1] = '\0';
-        fprintf(fd, "%s; {locator %s flags %u}\n", str,
-            rrset->rrsigs[i].key_locator, rrset->rrsigs[i].key_flags);
-        free((void*)str);
+        (void) rrprint_str(printer, "; {locator ");
+        (void) rrprint_str(printer, rrset->rrsigs[i].key_locator);
+        snprintf(str, sizeof(str), " flags %u}\n",
+            (unsigned) rrset->rrsigs[i].key_flags);
+        (void) rrprint_str(printer, str);
     }
     return;
 }
@@ -35,6 +35,7 @@
 #define SIGNER_RRSET_H
 
 #include "config.h"
+#include "shared/rrprint.h"
 #include "shared/status.h"
 #include "signer/stats.h"
 
@@ -72,7 +73,6 @@ struct rr_struct {
  */
 typedef struct rrset_struct rrset_type;
 struct rrset_struct {
-    rrset_type* next;
     void* zone;
     void* domain;
     ldns_rr_type rrtype;
@@ -193,13 +193,13 @@ ods_status rrset_sign(hsm_ctx_t* ctx, rrset_type* rrset, time_t signtime);
 
 /**
  * Print RRset.
- * \param[in] fd file descriptor
+ * \param[in] printer RR printer
  * \param[in] rrset RRset to be printed
  * \param[in] skip_rrsigs if true, don't print RRSIG records
  * \param[out] status status
  *
  */
-void rrset_print(FILE* fd, rrset_type* rrset, int skip_rrsigs,
+void rrset_print(rrprint_type* printer, rrset_type* rrset, int skip_rrsigs,
     ods_status* status);
 
 /**
@@ -211,10 +211,10 @@ void rrset_cleanup(rrset_type* rrset);
 
 /**
  * Backup RRset.
- * \param[in] fd file descriptor
+ * \param[in] printer RR printer
  * \param[in] rrset RRset
  *
  */
-void rrset_backup2(FILE* fd, rrset_type* rrset);
+void rrset_backup2(rrprint_type* printer, rrset_type* rrset);
 
 #endif /* SIGNER_RRSET_H */
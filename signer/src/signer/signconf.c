@@ -39,6 +39,9 @@
 #include "shared/status.h"
 #include "signer/signconf.h"
 
+#include <libxml/parser.h>
+#include <libxml/xpath.h>
+
 static const char* sc_str = "signconf";
 
 
@@ -102,56 +105,69 @@ signconf_read(signconf_type* signconf, const char* scfile)
 {
     const char* rngfile = ODS_SE_RNGDIR "/signconf.rng";
     ods_status status = ODS_STATUS_OK;
-    FILE* fd = NULL;
+    xmlDocPtr doc = NULL;
+    xmlXPathContextPtr xpathCtx = NULL;
 
     if (!scfile || !signconf) {
         return ODS_STATUS_ASSERT_ERR;
     }
     ods_log_debug("[%s] read signconf file %s", sc_str, scfile);
-    status = parse_file_check(scfile, rngfile);
+    /* parse once, then validate and read all values from the same tree */
+    doc = xmlParseFile(scfile);
+    if (!doc) {
+        ods_log_error("[%s] unable to read signconf: failed to parse file %s",
+            sc_str, scfile);
+        return ODS_STATUS_XML_ERR;
+    }
+    status = parse_doc_check(doc, rngfile);
     if (status != ODS_STATUS_OK) {
         ods_log_error("[%s] unable to read signconf: parse error in "
             "file %s (%s)", sc_str, scfile, ods_status2str(status));
+        xmlFreeDoc(doc);
         return status;
     }
-    fd = ods_fopen(scfile, NULL, "r");
-    if (fd) {
-        signconf->filename = allocator_strdup(signconf->allocator, scfile);
-        signconf->sig_resign_interval = parse_sc_sig_resign_interval(scfile);
-        signconf->sig_refresh_interval = parse_sc_sig_refresh_interval(scfile);
-        signconf->sig_validity_default = parse_sc_sig_validity_default(scfile);
-        signconf->sig_validity_denial = parse_sc_sig_validity_denial(scfile);
-        signconf->sig_jitter = parse_sc_sig_jitter(scfile);
-        signconf->sig_inception_offset = parse_sc_sig_inception_offset(scfile);
-        signconf->nsec_type = parse_sc_nsec_type(scfile);
-        if (signconf->nsec_type == LDNS_RR_TYPE_NSEC3) {
-            signconf->nsec3_optout = parse_sc_nsec3_optout(scfile);
-            signconf->nsec3_algo = parse_sc_nsec3_algorithm(scfile);
-            signconf->nsec3_iterations = parse_sc_nsec3_iterations(scfile);
-            signconf->nsec3_salt = parse_sc_nsec3_salt(signconf->allocator,
-                scfile);
-            signconf->nsec3params = nsec3params_create((void*) signconf,
-            (uint8_t) signconf->nsec3_algo, (uint8_t) signconf->nsec3_optout,
-            (uint16_t)signconf->nsec3_iterations, signconf->nsec3_salt);
-            if (!signconf->nsec3params) {
-                ods_log_error("[%s] unable to read signconf %s: "
-                    "nsec3params_create() failed", sc_str, scfile);
-                return ODS_STATUS_MALLOC_ERR;
-            }
+    xpathCtx = xmlXPathNewContext(doc);
+    if (!xpathCtx) {
+        ods_log_error("[%s] unable to read signconf %s: "
+            "xmlXPathNewContext() failed", sc_str, scfile);
+        xmlFreeDoc(doc);
+        return ODS_STATUS_XML_ERR;
+    }
+    signconf->filename = allocator_strdup(signconf->allocator, scfile);
+    signconf->sig_resign_interval = parse_sc_sig_resign_interval(xpathCtx);
+    signconf->sig_refresh_interval = parse_sc_sig_refresh_interval(xpathCtx);
+    signconf->sig_validity_default = parse_sc_sig_validity_default(xpathCtx);
+    signconf->sig_validity_denial = parse_sc_sig_validity_denial(xpathCtx);
+    signconf->sig_jitter = parse_sc_sig_jitter(xpathCtx);
+    signconf->sig_inception_offset = parse_sc_sig_inception_offset(xpathCtx);
+    signconf->nsec_type = parse_sc_nsec_type(xpathCtx);
+    if (signconf->nsec_type == LDNS_RR_TYPE_NSEC3) {
+        signconf->nsec3_optout = parse_sc_nsec3_optout(xpathCtx);
+        signconf->nsec3_algo = parse_sc_nsec3_algorithm(xpathCtx);
+        signconf->nsec3_iterations = parse_sc_nsec3_iterations(xpathCtx);
+        signconf->nsec3_salt = parse_sc_nsec3_salt(signconf->allocator,
+            xpathCtx);
+        signconf->nsec3params = nsec3params_create((void*) signconf,
+        (uint8_t) signconf->nsec3_algo, (uint8_t) signconf->nsec3_optout,
+        (uint16_t)signconf->nsec3_iterations, signconf->nsec3_salt);
+        if (!signconf->nsec3params) {
+            ods_log_error("[%s] unable to read signconf %s: "
+                "nsec3params_create() failed", sc_str, scfile);
+            xmlXPathFreeContext(xpathCtx);
+            xmlFreeDoc(doc);
+            return ODS_STATUS_MALLOC_ERR;
         }
-        signconf->keys = parse_sc_keys((void*) signconf, scfile);
-        signconf->dnskey_ttl = parse_sc_dnskey_ttl(scfile);
-        signconf->soa_ttl = parse_sc_soa_ttl(scfile);
-        signconf->soa_min = parse_sc_soa_min(scfile);
-        signconf->soa_serial = parse_sc_soa_serial(signconf->allocator,
-            scfile);
-        signconf->max_zone_ttl = parse_sc_max_zone_ttl(scfile);
-        ods_fclose(fd);
-        return ODS_STATUS_OK;
-    }
-    ods_log_error("[%s] unable to read signconf: failed to open file %s",
-        sc_str, scfile);
-    return ODS_STATUS_ERR;
+    }
+    signconf->keys = parse_sc_keys((void*) signconf, xpathCtx);
+    signconf->dnskey_ttl = parse_sc_dnskey_ttl(xpathCtx);
+    signconf->soa_ttl = parse_sc_soa_ttl(xpathCtx);
+    signconf->soa_min = parse_sc_soa_min(xpathCtx);
+    signconf->soa_serial = parse_sc_soa_serial(signconf->allocator,
+        xpathCtx);
+    signconf->max_zone_ttl = parse_sc_max_zone_ttl(xpathCtx);
+    xmlXPathFreeContext(xpathCtx);
+    xmlFreeDoc(doc);
+    return ODS_STATUS_OK;
 }
 
 
@@ -64,7 +64,11 @@ stats_clear(stats_type* stats)
     stats->sig_count = 0;
     stats->sig_soa_count = 0;
     stats->sig_reuse = 0;
+    stats->sig_deferred = 0;
+    stats->sig_refreshed = 0;
+    stats->sig_expire_min = 0;
     stats->sig_time = 0;
+    stats->publish = 0;
     stats->start_time = 0;
     stats->end_time = 0;
 }
@@ -88,12 +92,13 @@ stats_log(stats_type* stats, const char* name, ldns_rr_type nsec_type)
     }
     ods_log_info("[STATS] %s RR[count=%u time=%u(sec)] "
         "NSEC%s[count=%u time=%u(sec)] "
-        "RRSIG[new=%u reused=%u time=%u(sec) avg=%u(sig/sec)] "
-        "TOTAL[time=%u(sec)] ",
+        "RRSIG[new=%u reused=%u deferred=%u time=%u(sec) avg=%u(sig/sec)] "
+        "PUBLISH[%s] TOTAL[time=%u(sec)] ",
         name?name:"(null)", stats->sort_count, stats->sort_time,
         nsec_type==LDNS_RR_TYPE_NSEC3?"3":"", stats->nsec_count,
         stats->nsec_time, stats->sig_count, stats->sig_reuse,
-        stats->sig_time, avsign,
+        stats->sig_deferred, stats->sig_time, avsign,
+        stats->publish?"yes":"skipped",
         (uint32_t) (stats->end_time - stats->start_time));
     return;
 }
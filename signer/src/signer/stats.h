@@ -62,7 +62,11 @@ struct stats_struct {
     uint32_t    sig_count;
     uint32_t    sig_soa_count;
     uint32_t    sig_reuse;
+    uint32_t    sig_deferred;
+    uint32_t    sig_refreshed;
+    uint32_t    sig_expire_min;
     time_t      sig_time;
+    int         publish;
     time_t      audit_time;
     time_t      start_time;
     time_t      end_time;
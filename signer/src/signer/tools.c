@@ -34,6 +34,7 @@
 #include "config.h"
 #include "daemon/dnshandler.h"
 #include "adapter/adapter.h"
+#include "adapter/adfile.h"
 #include "shared/file.h"
 #include "shared/log.h"
 #include "signer/tools.h"
@@ -73,6 +74,11 @@ tools_signconf(zone_type* zone)
         zone->signconf = new_signconf;
         signconf_log(zone->signconf, zone->name);
         zone->default_ttl = (uint32_t) duration2time(zone->signconf->soa_min);
+        /* SOA values, serial policy and MaxZoneTTL are applied while
+         * reading the input, so an unchanged input must be read again */
+        if (zone->adinbound) {
+            zone->adinbound->digest_ok = 0;
+        }
     } else if (status != ODS_STATUS_UNCHANGED) {
         ods_log_error("[%s] unable to load signconf for zone %s: %s",
             tools_str, zone->name, ods_status2str(status));
@@ -86,7 +92,7 @@ tools_signconf(zone_type* zone)
  *
  */
 ods_status
-tools_input(zone_type* zone)
+tools_input(zone_type* zone, int threads)
 {
     ods_status status = ODS_STATUS_OK;
     time_t start = 0;
@@ -128,7 +134,7 @@ tools_input(zone_type* zone)
     }
     /* Input Adapter */
     start = time(NULL);
-    status = adapter_read((void*)zone);
+    status = adapter_read((void*)zone, threads);
     if (status != ODS_STATUS_OK) {
         ods_log_error("[%s] unable to read zone %s: adapter failed (%s)",
             tools_str, zone->name, ods_status2str(status));
@@ -157,6 +163,9 @@ tools_output(zone_type* zone, engine_type* engine)
 {
     ods_status status = ODS_STATUS_OK;
     char str[SYSTEM_MAXLEN];
+    char* image = NULL;
+    size_t size = 0;
+    int queued = 0;
     int error = 0;
     ods_log_assert(engine);
     ods_log_assert(engine->config);
@@ -165,34 +174,39 @@ tools_output(zone_type* zone, engine_type* engine)
     ods_log_assert(zone->name);
     ods_log_assert(zone->signconf);
     ods_log_assert(zone->adoutbound);
-    /* prepare */
-    if (zone->stats) {
-        lock_basic_lock(&zone->stats->stats_lock);
-        if (zone->stats->sort_done == 0 &&
-            (zone->stats->sig_count <= zone->stats->sig_soa_count)) {
-            ods_log_verbose("[%s] skip write zone %s serial %u (zone not "
-                "changed)", tools_str, zone->name?zone->name:"(null)",
-                zone->db->intserial);
-            stats_clear(zone->stats);
-            lock_basic_unlock(&zone->stats->stats_lock);
-            zone->db->intserial =
-                zone->db->outserial;
-            return ODS_STATUS_OK;
+    /* Output Adapter: hand an image to the writer, if we can */
+    if (engine->writer && engine->writer->started &&
+        zone->adoutbound->type == ADAPTER_FILE &&
+        adfile_image((void*)zone, &image, &size,
+        engine->config->num_signer_threads) == ODS_STATUS_OK) {
+        ods_log_verbose("[%s] queue zone %s serial %u for output file "
+            "adapter %s", tools_str, zone->name, zone->db->intserial,
+            zone->adoutbound->configstr);
+        status = writer_queue(engine->writer, (void*)zone,
+            zone->adoutbound->configstr, zone->notify_ns,
+            zone->db->intserial, image, size);
+        if (status != ODS_STATUS_OK) {
+            free(image);
+            ods_log_error("[%s] unable to write zone %s: queue failed (%s)",
+                tools_str, zone->name, ods_status2str(status));
+            return status;
+        }
+        queued = 1;
+    } else {
+        status = adapter_write((void*)zone,
+            engine->config->num_signer_threads);
+        if (status != ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to write zone %s: adapter failed (%s)",
+                tools_str, zone->name, ods_status2str(status));
+            return status;
         }
-        lock_basic_unlock(&zone->stats->stats_lock);
-    }
-    /* Output Adapter */
-    status = adapter_write((void*)zone);
-    if (status != ODS_STATUS_OK) {
-        ods_log_error("[%s] unable to write zone %s: adapter failed (%s)",
-            tools_str, zone->name, ods_status2str(status));
-        return status;
     }
     zone->db->outserial = zone->db->intserial;
     zone->db->is_initialized = 1;
+    zone->db->force_output = 0;
     ixfr_purge(zone->ixfr);
-    /* kick the nameserver */
-    if (zone->notify_ns) {
+    /* kick the nameserver, the writer does so after writing */
+    if (zone->notify_ns && !queued) {
         ods_log_verbose("[%s] notify nameserver: %s", tools_str,
             zone->notify_ns);
         snprintf(str, SYSTEM_MAXLEN, "%s > /dev/null",
@@ -203,7 +217,7 @@ tools_output(zone_type* zone, engine_type* engine)
            status = ODS_STATUS_ERR;
         }
     }
-    if (engine->dnshandler) {
+    if (engine->dnshandler && !queued) {
         dnshandler_fwd_notify(engine->dnshandler, (uint8_t*) ODS_SE_NOTIFY_CMD,
             strlen(ODS_SE_NOTIFY_CMD));
     }
@@ -211,6 +225,7 @@ tools_output(zone_type* zone, engine_type* engine)
     if (zone->stats) {
         lock_basic_lock(&zone->stats->stats_lock);
         zone->stats->end_time = time(NULL);
+        zone->stats->publish = 1;
         ods_log_debug("[%s] log stats for zone %s", tools_str,
             zone->name?zone->name:"(null)");
         stats_log(zone->stats, zone->name, zone->signconf->nsec_type);
@@ -219,3 +234,29 @@ tools_output(zone_type* zone, engine_type* engine)
     }
     return status;
 }
+
+
+/**
+ * Keep the current output.
+ *
+ */
+void
+tools_skip_output(zone_type* zone)
+{
+    ods_log_assert(zone);
+    ods_log_assert(zone->db);
+    ods_log_verbose("[%s] skip write zone %s serial %u (zone not changed)",
+        tools_str, zone->name?zone->name:"(null)", zone->db->outserial);
+    zone->db->intserial = zone->db->outserial;
+    zone->db->serial_updated = 0;
+    if (zone->stats) {
+        lock_basic_lock(&zone->stats->stats_lock);
+        zone->stats->end_time = time(NULL);
+        zone->stats->publish = 0;
+        stats_log(zone->stats, zone->name, zone->signconf?
+            zone->signconf->nsec_type:LDNS_RR_TYPE_NSEC);
+        stats_clear(zone->stats);
+        lock_basic_unlock(&zone->stats->stats_lock);
+    }
+    return;
+}
@@ -50,10 +50,11 @@ ods_status tools_signconf(zone_type* zone);
 /**
  * Read zone from input adapter.
  * \param[in] zone zone
+ * \param[in] threads number of threads available for parsing the input
  * \return ods_status status
  *
  */
-ods_status tools_input(zone_type* zone);
+ods_status tools_input(zone_type* zone, int threads);
 
 /**
  * Write zone to output adapter.
@@ -64,4 +65,11 @@ ods_status tools_input(zone_type* zone);
  */
 ods_status tools_output(zone_type* zone, engine_type* engine);
 
+/**
+ * Keep the current output, the zone has nothing new to publish.
+ * \param[in] zone zone
+ *
+ */
+void tools_skip_output(zone_type* zone);
+
 #endif /* SIGNER_TOOLS_H */
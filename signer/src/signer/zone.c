@@ -44,6 +44,7 @@
 #include "wire/netio.h"
 
 #include <ldns/ldns.h>
+#include <unistd.h>
 
 static const char* zone_str = "zone";
 
@@ -690,12 +691,14 @@ zone_merge(zone_type* z1, zone_type* z2)
         z2->adinbound = z1->adinbound;
         z1->adinbound = adtmp;
         adtmp = NULL;
+        z1->zl_status = ZONE_ZL_UPDATED;
     }
     if (adapter_compare(z2->adoutbound, z1->adoutbound) != 0) {
         adtmp = z2->adoutbound;
         z2->adoutbound = z1->adoutbound;
         z1->adoutbound = adtmp;
         adtmp = NULL;
+        z1->zl_status = ZONE_ZL_UPDATED;
     }
     return;
 }
@@ -927,8 +930,14 @@ zone_recover2(zone_type* zone)
         zone->task = (void*) task;
         free((void*)filename);
         ods_fclose(fd);
+        /* input digest */
+        filename = ods_build_path(zone->name, ".digest", 0, 1);
+        adapter_recover_digest(zone->adinbound, filename);
+        free((void*)filename);
         /* journal */
         zone->db->is_initialized = 1;
+        /* the backup may be ahead of an output that was never written */
+        zone->db->force_output = 1;
 
         filename = ods_build_path(zone->name, ".ixfr", 0, 1);
         fd = ods_fopen(filename, NULL, "r");
@@ -1042,8 +1051,15 @@ zone_backup2(zone_type* zone)
     } else {
         status = ODS_STATUS_FOPEN_ERR;
     }
-
     free((void*) tmpfile);
     free((void*) filename);
+    /* input digest, only valid together with the backup */
+    filename = ods_build_path(zone->name, ".digest", 0, 1);
+    if (status == ODS_STATUS_OK) {
+        adapter_backup_digest(zone->adinbound, filename);
+    } else {
+        (void) unlink(filename);
+    }
+    free((void*) filename);
     return status;
 }
@@ -275,6 +275,7 @@ zonelist_merge(zonelist_type* zl1, zonelist_type* zl2)
     zone_type* z2 = NULL;
     ldns_rbnode_t* n1 = LDNS_RBTREE_NULL;
     ldns_rbnode_t* n2 = LDNS_RBTREE_NULL;
+    zone_zl_status status = ZONE_ZL_OK;
     int ret = 0;
 
     ods_log_assert(zl1);
@@ -320,15 +321,23 @@ zonelist_merge(zonelist_type* zl1, zonelist_type* zl2)
                 }
                 n2 = ldns_rbtree_next(n2);
             } else {
-                /* just update zone z1 */
+                /* just update zone z1, if anything changed */
                 n1 = ldns_rbtree_next(n1);
                 n2 = ldns_rbtree_next(n2);
+                status = z1->zl_status;
+                z1->zl_status = ZONE_ZL_OK;
                 zone_merge(z1, z2);
                 zone_cleanup(z2);
-                if (z1->zl_status == ZONE_ZL_UPDATED) {
+                if (z1->zl_status == ZONE_ZL_UPDATED &&
+                    status != ZONE_ZL_UPDATED && status != ZONE_ZL_ADDED) {
                     zl1->just_updated++;
                 }
-                z1->zl_status = ZONE_ZL_UPDATED;
+                if (status == ZONE_ZL_ADDED ||
+                    (status == ZONE_ZL_UPDATED &&
+                     z1->zl_status == ZONE_ZL_OK)) {
+                    /* not yet committed */
+                    z1->zl_status = status;
+                }
             }
         }
     }
@@ -356,6 +365,7 @@ zonelist_update(zonelist_type* zl, const char* zlfile)
     time_t st_mtime = 0;
     ods_status status = ODS_STATUS_OK;
     char* datestamp = NULL;
+    uint64_t start = 0;
 
     ods_log_debug("[%s] update zone list", zl_str);
     if (!zl|| !zl->zones || !zlfile) {
@@ -389,7 +399,11 @@ zonelist_update(zonelist_type* zl, const char* zlfile)
         zl->just_added = 0;
         zl->just_updated = 0;
         new_zlist->last_modified = st_mtime;
+        start = time_now_ms();
         zonelist_merge(zl, new_zlist);
+        ods_log_info("[%s] merged zonelist in %u ms: %i added, %i removed, "
+            "%i updated", zl_str, (unsigned) (time_now_ms() - start),
+            zl->just_added, zl->just_removed, zl->just_updated);
         (void)time_datestamp(zl->last_modified, "%Y-%m-%d %T", &datestamp);
         ods_log_debug("[%s] file %s is modified since %s", zl_str, zlfile,
             datestamp?datestamp:"Unknown");
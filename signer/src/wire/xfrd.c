@@ -37,6 +37,7 @@
 #include "shared/duration.h"
 #include "shared/file.h"
 #include "shared/log.h"
+#include "shared/metrics.h"
 #include "shared/util.h"
 #include "signer/zone.h"
 #include "wire/tcpset.h"
@@ -131,6 +132,7 @@ xfrd_create(void* xfrhandler, void* zone)
     xfrd->serial_notify_acquired = 0;
     xfrd->query_id = 0;
     xfrd->msg_seq_nr = 0;
+    xfrd->msg_start = 0;
     xfrd->msg_rr_count = 0;
     xfrd->msg_old_serial = 0;
     xfrd->msg_new_serial = 0;
@@ -942,6 +944,11 @@ xfrd_handle_packet(xfrd_type* xfrd, buffer_type* buffer)
             return res;
             break;
     }
+    if (xfrd->msg_seq_nr == 0) {
+        xfrd->msg_start = metrics_now();
+    }
+    metrics_count(COUNTER_XFR_PACKETS, 1);
+    metrics_count(COUNTER_XFR_BYTES, buffer_limit(buffer));
     /* dump reply on disk to diff file */
     xfrd_dump_packet(xfrd, buffer);
     /* more? */
@@ -954,6 +961,8 @@ xfrd_handle_packet(xfrd_type* xfrd, buffer_type* buffer)
     buffer_clear(buffer);
     buffer_flip(buffer);
     /* commit packet */
+    metrics_observe_since(METRIC_XFR, xfrd->msg_start);
+    metrics_count(COUNTER_XFR_RRS, xfrd->msg_rr_count);
     xfrd_commit_packet(xfrd);
     /* next time */
     lock_basic_lock(&xfrd->serial_lock);
@@ -121,6 +121,7 @@ struct xfrd_struct
     /* packet handling */
     uint16_t query_id;
     uint32_t msg_seq_nr;
+    uint64_t msg_start; /* when the first packet of the xfr came in */
     uint32_t msg_old_serial;
     uint32_t msg_new_serial;
     size_t msg_rr_count;